@@ -88,6 +88,9 @@
            `(;; alloc.c
 	     (gc-cons-threshold alloc integer)
 	     (gc-cons-percentage alloc float)
+	     (gc-cons-idle-fraction alloc
+				    (choice (const :tag "Off" nil) float)
+				    "28.1")
 	     (garbage-collection-messages alloc boolean)
 	     ;; buffer.c
 	     (cursor-type display ,cursor-type-types)
@@ -166,6 +166,34 @@ if `confirm-kill-processes' is non-nil."
   :type 'boolean
   :version "28.1")
 
+(defcustom native-comp-async-persistent-workers nil
+  "Non-nil means compile asynchronously in long-lived Emacs subprocesses.
+Each of these workers compiles one file after another, instead of a
+new Emacs starting and loading the compiler for every file.  A worker
+exits after compiling `comp-async-worker-max-jobs' files, and once it
+has been idle for `comp-async-worker-idle-time' seconds.
+
+Unlike a subprocess started for a single file, a worker does not
+compile each file in a pristine environment: the features loaded to
+compile the previous files stay loaded, so the warnings about missing
+`require's described in `native-comp-async-report-warnings-errors'
+may not appear."
+  :type 'boolean
+  :version "28.1")
+
+(defcustom native-comp-eln-cache-directory nil
+  "Directory of a cache of .eln files shared by Emacs sessions, or nil.
+The .eln files in the cache are named after the contents of their
+source file, the compilation options and, through the subdirectory
+`comp-native-version-dir', the Emacs build; not after the location of
+the source file.  So the cache can be shared by Emacs installations
+that have the same build, even on different machines.  Before
+compiling a file, the native compiler copies its .eln file from the
+cache if it is there, unless `native-comp-always-compile' is non-nil,
+and after compiling the file, it adds the .eln file to the cache."
+  :type '(choice (const :tag "None" nil) directory)
+  :version "28.1")
+
 (defcustom native-comp-compiler-options nil
   "Command line options passed verbatim to GCC compiler.
 Note that not all options are meaningful and some options might even
@@ -186,6 +214,34 @@ and above."
   :type '(repeat string)                ; FIXME is this right?
   :version "28.1")
 
+(defcustom native-comp-profile-file nil
+  "File of the profile guiding native compilation, or nil for none.
+The profile records the functions Emacs spent its time in; write it
+with `native-comp-write-profile'.  Functions that the profile finds
+hot are compiled at `native-comp-hot-speed'.  Functions that never
+ran while others of their compilation unit did are marked cold,
+so that GCC optimizes them for size and keeps them away from the hot
+code.  Marking functions cold needs libgccjit version 14 or later."
+  :type '(choice (const :tag "None" nil) file)
+  :version "28.1")
+
+(defcustom native-comp-hot-speed nil
+  "Optimization level for the functions that the profile finds hot.
+If nil, compile them like the other functions.  At 3, hot functions
+call the other functions of their compilation unit directly; see
+`native-comp-speed' for the drawbacks.  A function's own `speed'
+declaration takes precedence, and this never lowers the speed."
+  :type '(choice (const :tag "Same as other functions" nil) integer)
+  :version "28.1")
+
+(defcustom native-comp-hot-threshold 0.001
+  "Share of the profile's samples that makes a function hot.
+A function is hot if it was running, rather than one of its
+callees, in at least this share of the samples of
+`native-comp-profile-file'."
+  :type 'number
+  :version "28.1")
+
 (defcustom comp-libgccjit-reproducer nil
   "When non-nil produce a libgccjit reproducer.
 The reproducer is a file ELNFILENAME_libgccjit_repro.c deposed in
@@ -920,6 +976,8 @@ CFG is mutated by a pass.")
                  :documentation "t if non local jumps are present.")
   (speed nil :type number
          :documentation "Optimization level (see `native-comp-speed').")
+  (cold nil :type boolean
+        :documentation "t if the profile found the function cold.")
   (pure nil :type boolean
         :documentation "t if pure nil otherwise.")
   (type nil :type (or null comp-mvar)
@@ -1391,7 +1449,128 @@ If INPUT is a string, it is the filename to be compiled."
         (byte-to-native-lambdas-h (make-hash-table :test #'eq))
         (byte-to-native-top-level-forms ())
         (byte-to-native-plist-environment ()))
-    (comp-spill-lap-function input)))
+    (comp-spill-lap-function input)
+    (when native-comp-profile-file
+      (comp-apply-profile))))
+
+
+;;; Profile guided optimization.
+
+(defvar comp-profile nil
+  "Cache of the profile in `native-comp-profile-file'.
+A list (FILE MODIFICATION-TIME . PROFILE), with PROFILE as returned
+by `comp-read-profile'.")
+
+(defun comp-read-profile (file)
+  "Return the profile in FILE, or an empty one if FILE doesn't exist.
+The value is a cons (SAMPLES . TABLE), where TABLE maps the name of
+each function in the profile to a cons (SELF . TOTAL).  SAMPLES is
+the number of samples taken, SELF the number of those in which the
+function was running and TOTAL the number in which it was called."
+  (let ((table (make-hash-table :test #'eq))
+        (samples 0))
+    (when (file-exists-p file)
+      (let ((profile (with-temp-buffer
+                       (insert-file-contents file)
+                       (read (current-buffer)))))
+        (unless (eq (car-safe profile) 'native-comp-profile)
+          (error "%s is not a native compilation profile" file))
+        (setq samples (plist-get (cdr profile) :samples))
+        (pcase-dolist (`(,name ,self ,total)
+                       (plist-get (cdr profile) :functions))
+          (puthash name (cons self total) table))))
+    (cons samples table)))
+
+(defun comp-profile ()
+  "Return the profile in `native-comp-profile-file'.
+See `comp-read-profile' for its form."
+  (let* ((file (expand-file-name native-comp-profile-file))
+         (time (file-attribute-modification-time (file-attributes file))))
+    (unless (and (equal (car comp-profile) file)
+                 (equal (cadr comp-profile) time))
+      (setq comp-profile (cons file (cons time (comp-read-profile file)))))
+    (cddr comp-profile)))
+
+;;;###autoload
+(defun native-comp-write-profile (file &optional log)
+  "Add the samples of the CPU profiler to the profile in FILE.
+LOG is a log of the CPU profiler, as returned by `profiler-cpu-log';
+if it is nil, take the log of the running profiler, which then starts
+a new one.  Set `native-comp-profile-file' to FILE to have the native
+compiler use the profile.
+
+Profile the work that should get faster, and write the profile after
+each run: the samples add up."
+  (interactive
+   (list (read-file-name "Add the profiler samples to profile: "
+                         nil native-comp-profile-file nil
+                         native-comp-profile-file)))
+  (let* ((log (or log
+                  (and (fboundp 'profiler-cpu-log) (profiler-cpu-log))
+                  (user-error "The CPU profiler has no samples")))
+         (profile (comp-read-profile file))
+         (samples (car profile))
+         (table (cdr profile))
+         functions)
+    (maphash
+     (lambda (backtrace count)
+       (let ((leaf t)
+             (seen ()))
+         (cl-incf samples count)
+         ;; The innermost frame comes first.
+         (cl-loop
+          for f across backtrace
+          when f
+          do (when (and (symbolp f) (not (memq f seen)))
+               (push f seen)
+               (let ((counts (or (gethash f table)
+                                 (puthash f (cons 0 0) table))))
+                 (when leaf
+                   (cl-incf (car counts) count))
+                 (cl-incf (cdr counts) count)))
+             (setq leaf nil))))
+     log)
+    (maphash (lambda (name counts)
+               (push (list name (car counts) (cdr counts)) functions))
+             table)
+    (setq functions (sort functions (lambda (a b) (> (nth 1 a) (nth 1 b)))))
+    (with-temp-file file
+      (let ((print-length nil)
+            (print-level nil))
+        (insert ";; -*- mode: lisp-data -*-\n"
+                ";; Profile for `native-comp-profile-file'.\n")
+        (prin1 `(native-comp-profile :samples ,samples :functions ,functions)
+               (current-buffer))
+        (insert "\n")))
+    (setq comp-profile nil)
+    (message "Profile of %d samples written to %s" samples file)))
+
+(defun comp-apply-profile ()
+  "Mark the functions of `comp-ctxt' hot or cold as the profile says.
+Hot functions get the speed `native-comp-hot-speed'; cold functions
+have their `cold' slot set.  A function is only marked cold if some
+other function of the compilation unit appears in the profile, so
+that profiles of unrelated work don't make a whole unit cold."
+  (pcase-let* ((`(,samples . ,table) (comp-profile))
+               (funcs (hash-table-values (comp-ctxt-funcs-h comp-ctxt)))
+               (ran (cl-some (lambda (f)
+                               (and (comp-func-name f)
+                                    (gethash (comp-func-name f) table)))
+                             funcs)))
+    (when ran
+      (dolist (f funcs)
+        (let* ((name (comp-func-name f))
+               (counts (and name (gethash name table))))
+          (cond
+           ((null name))
+           ((null counts)
+            (setf (comp-func-cold f) t))
+           ((and native-comp-hot-speed
+                 (>= (car counts) (* native-comp-hot-threshold samples))
+                 (> (comp-func-speed f) 0)
+                 (null (comp-spill-decl-spec name 'speed)))
+            (setf (comp-func-speed f)
+                  (max (comp-func-speed f) native-comp-hot-speed)))))))))
 
 
 ;;; Limplification pass specific code.
@@ -3892,22 +4071,285 @@ processes from `comp-async-compilations'"
 
 (defvar comp-last-scanned-async-output nil)
 (make-variable-buffer-local 'comp-last-scanned-async-output)
+(defun comp-process-async-output (process)
+  "Check the output of PROCESS for diagnostic messages."
+  (when native-comp-async-report-warnings-errors
+    (let ((warning-suppress-types
+           (if (eq native-comp-async-report-warnings-errors 'silent)
+               (cons '(comp) warning-suppress-types)
+             warning-suppress-types)))
+      (with-current-buffer (process-buffer process)
+        (save-excursion
+          (goto-char (or comp-last-scanned-async-output (point-min)))
+          (while (re-search-forward "^.*?\\(?:Error\\|Warning\\): .*$"
+                                    nil t)
+            (display-warning 'comp (match-string 0)))
+          (setq comp-last-scanned-async-output (point-max)))))))
+
 (defun comp-accept-and-process-async-output (process)
   "Accept PROCESS output and check for diagnostic messages."
-  (if native-comp-async-report-warnings-errors
-      (let ((warning-suppress-types
-             (if (eq native-comp-async-report-warnings-errors 'silent)
-                 (cons '(comp) warning-suppress-types)
-               warning-suppress-types)))
-        (with-current-buffer (process-buffer process)
-          (save-excursion
-            (accept-process-output process)
-            (goto-char (or comp-last-scanned-async-output (point-min)))
-            (while (re-search-forward "^.*?\\(?:Error\\|Warning\\): .*$"
-                                      nil t)
-              (display-warning 'comp (match-string 0)))
-            (setq comp-last-scanned-async-output (point-max)))))
-    (accept-process-output process)))
+  (accept-process-output process)
+  (comp-process-async-output process))
+
+;;; Persistent asynchronous compilation workers.
+
+(defvar comp-async-worker-max-jobs 32
+  "Number of files a persistent worker compiles before exiting.
+GCC leaks memory, so workers are replaced from time to time.")
+
+(defvar comp-async-worker-idle-time 30
+  "Seconds after which idle persistent workers are stopped.")
+
+(defconst comp-async-worker-done-marker "comp-async-worker: job done"
+  "Line a persistent worker outputs after each compilation.")
+
+(defvar comp-async-workers ()
+  "List of the live persistent asynchronous compilation workers.")
+
+(defvar comp-async-worker-timer nil
+  "Timer stopping the idle persistent workers.")
+
+(defun comp-async-worker-loop ()
+  "Compile files as a persistent asynchronous compilation worker.
+Read from the standard input the names of the files describing the
+compilations, one per line, and load each of them.  Exit at the end
+of the input or after `comp-async-worker-max-jobs' compilations."
+  (cl-loop
+   repeat comp-async-worker-max-jobs
+   for file = (condition-case nil
+                  (read-from-minibuffer "")
+                ;; End of input.
+                (error nil))
+   while (and file (not (string-empty-p file)))
+   do (load file nil t t)
+      (message "%s" comp-async-worker-done-marker)))
+
+(defun comp-async-start-worker ()
+  "Start a persistent asynchronous compilation worker and return it."
+  (let ((worker (make-process
+                 :name "Native compilation worker"
+                 :buffer (with-current-buffer
+                             (get-buffer-create comp-async-buffer-name)
+                           (setf buffer-read-only t)
+                           (current-buffer))
+                 :command (list (expand-file-name invocation-name
+                                                  invocation-directory)
+                                "--batch" "-l" "comp"
+                                "-f" "comp-async-worker-loop")
+                 :connection-type 'pipe
+                 :filter #'comp-async-worker-filter
+                 :sentinel #'comp-async-worker-sentinel
+                 :noquery (not native-comp-async-query-on-exit))))
+    (process-put worker 'comp-jobs 0)
+    (push worker comp-async-workers)
+    worker))
+
+(defun comp-async-worker-filter (worker string)
+  "Insert STRING, output by WORKER, and notice its finished jobs."
+  (internal-default-process-filter worker string)
+  (let ((output (concat (process-get worker 'comp-output) string))
+        (start 0))
+    (while (string-match (concat "^" (regexp-quote
+                                      comp-async-worker-done-marker)
+                                 "\n")
+                         output start)
+      (setq start (match-end 0))
+      (comp-async-worker-job-done worker t))
+    ;; Keep the last line, which may be the beginning of a marker.
+    (process-put worker 'comp-output
+                 (substring output (string-match "[^\n]*\\'" output start)))))
+
+(defun comp-async-worker-sentinel (worker _event)
+  "Forget WORKER when it exits, failing the job it was running."
+  (unless (process-live-p worker)
+    (setq comp-async-workers (delq worker comp-async-workers))
+    (comp-async-worker-job-done worker nil)))
+
+(defun comp-async-worker-job-done (worker success)
+  "Finish the job WORKER is running, if any.
+If SUCCESS is non-nil, the compilation succeeded."
+  (when-let ((job (process-get worker 'comp-job)))
+    (process-put worker 'comp-job nil)
+    (when (and (process-live-p worker)
+               (>= (process-get worker 'comp-jobs) comp-async-worker-max-jobs))
+      (process-send-eof worker))
+    (pcase-let ((`(,source-file ,load ,temp-file) job))
+      (remhash source-file comp-async-compilations)
+      (run-hook-with-args 'native-comp-async-cu-done-functions source-file)
+      (comp-process-async-output worker)
+      (ignore-errors (delete-file temp-file))
+      (let ((eln-file (comp-el-to-eln-filename source-file)))
+        (when (and load success (file-exists-p eln-file))
+          (native-elisp-load eln-file (eq load 'late))))
+      (comp-run-async-workers))))
+
+(defun comp-async-worker-idle-p (worker)
+  "Return non-nil if WORKER can be given a new job."
+  (and (process-live-p worker)
+       (null (process-get worker 'comp-job))
+       (< (process-get worker 'comp-jobs) comp-async-worker-max-jobs)))
+
+(defun comp-async-dispatch (source-file load temp-file)
+  "Have a persistent worker compile SOURCE-FILE, as TEMP-FILE describes.
+LOAD is as in `native--compile-async'."
+  (let ((worker (or (cl-find-if #'comp-async-worker-idle-p comp-async-workers)
+                    (comp-async-start-worker))))
+    (process-put worker 'comp-job (list source-file load temp-file))
+    (process-put worker 'comp-jobs (1+ (process-get worker 'comp-jobs)))
+    (puthash source-file worker comp-async-compilations)
+    (process-send-string worker (concat temp-file "\n"))))
+
+(defun comp-async-stop-idle-workers ()
+  "Stop the persistent workers not compiling any file."
+  (setq comp-async-worker-timer nil)
+  (dolist (worker comp-async-workers)
+    (unless (process-get worker 'comp-job)
+      (process-send-eof worker))))
+
+;;; Dependency ordering of asynchronous compilations.
+
+(defvar comp-file-features-h (make-hash-table :test #'equal)
+  "Hash table source file -> (PROVIDES . REQUIRES).
+Cache for `comp-file-features', cleared when all the asynchronous
+compilations are finished.")
+
+(defun comp-file-features (file)
+  "Return the features FILE provides and requires as (PROVIDES . REQUIRES).
+Only `provide' and `require' forms with a quoted feature name, outside
+of comments and strings, are taken into account."
+  (or (gethash file comp-file-features-h)
+      (puthash
+       file
+       (let (provides requires)
+         (with-temp-buffer
+           (ignore-errors (insert-file-contents file))
+           (set-syntax-table emacs-lisp-mode-syntax-table)
+           (while (re-search-forward
+                   "(\\(provide\\|require\\)[ \t\n]+'\\([^ \t\n()]+\\)"
+                   nil t)
+             (let ((kind (match-string 1))
+                   (feature (intern (match-string 2))))
+               ;; `syntax-ppss' moves point to its argument.
+               (unless (save-excursion
+                         (nth 8 (syntax-ppss (match-beginning 0))))
+                 (if (equal kind "provide")
+                     (push feature provides)
+                   (push feature requires))))))
+         (cons provides requires))
+       comp-file-features-h)))
+
+(defun comp-async-next-file ()
+  "Remove the next entry to compile from `comp-files-queue' and return it.
+Prefer the first entry none of whose required features is provided
+by another file queued or being compiled, so that files are compiled
+after the files they depend on.  Return nil if every queued file waits
+for a compilation in progress."
+  (if (and comp-files-queue
+           (null (cdr comp-files-queue))
+           (zerop (hash-table-count comp-async-compilations)))
+      (pop comp-files-queue)
+    (let ((providers (make-hash-table :test #'eq)))
+      (dolist (file (append (mapcar #'car comp-files-queue)
+                            (hash-table-keys comp-async-compilations)))
+        (dolist (feature (car (comp-file-features file)))
+          (puthash feature (1+ (gethash feature providers 0)) providers)))
+      (when-let ((entry
+                  (or (cl-find-if
+                       (lambda (entry)
+                         (let ((features (comp-file-features (car entry))))
+                           (cl-notany (lambda (feature)
+                                        (> (gethash feature providers 0)
+                                           (if (memq feature (car features))
+                                               1
+                                             0)))
+                                      (cdr features))))
+                       comp-files-queue)
+                      ;; Break dependency cycles.
+                      (and (zerop (hash-table-count comp-async-compilations))
+                           (car comp-files-queue)))))
+        (setq comp-files-queue (delq entry comp-files-queue))
+        entry))))
+
+;;; Shared cache of .eln files.
+
+(defun comp-file-sha1 (file)
+  "Return the SHA-1 of the contents of FILE, or nil if it is unreadable."
+  (ignore-error file-error
+    (with-temp-buffer
+      (set-buffer-multibyte nil)
+      (insert-file-contents-literally file)
+      (secure-hash 'sha1 (current-buffer)))))
+
+(defun comp-eln-cache-file (file with-late-load)
+  "Return the name of FILE compiled with WITH-LATE-LOAD in the .eln cache.
+See `native-comp-eln-cache-directory'."
+  (let ((key (secure-hash
+              'sha1
+              (let ((print-length nil)
+                    (print-level nil))
+                (prin1-to-string
+                 (list (comp-file-sha1 file)
+                       (file-name-nondirectory file)
+                       with-late-load
+                       native-comp-speed
+                       native-comp-debug
+                       native-comp-compiler-options
+                       native-comp-driver-options
+                       native-comp-hot-speed
+                       native-comp-hot-threshold
+                       (and native-comp-profile-file
+                            (comp-file-sha1 native-comp-profile-file))))))))
+    (expand-file-name (concat (file-name-base
+                               (string-remove-suffix ".gz" file))
+                              "-" (substring key 0 16) ".eln")
+                      (expand-file-name comp-native-version-dir
+                                        native-comp-eln-cache-directory))))
+
+(defun comp-eln-cache-fetch (file with-late-load output)
+  "Copy FILE compiled with WITH-LATE-LOAD from the .eln cache to OUTPUT.
+Return OUTPUT if the cache has it, nil otherwise.
+Always return nil if `native-comp-always-compile' is non-nil."
+  (when (and native-comp-eln-cache-directory
+             (not native-comp-always-compile))
+    (let ((cached (comp-eln-cache-file file with-late-load)))
+      (when (file-exists-p cached)
+        (ignore-error file-error
+          (make-directory (file-name-directory output) t)
+          (let ((tmp-file (make-temp-file-internal
+                           (substring output 0 -4) nil ".eln.tmp" nil)))
+            (copy-file cached tmp-file t)
+            (comp-clean-up-stale-eln output)
+            (comp-delete-or-replace-file output tmp-file))
+          output)))))
+
+(defun comp-eln-cache-store (file with-late-load eln-file)
+  "Add ELN-FILE, FILE compiled with WITH-LATE-LOAD, to the .eln cache."
+  (when native-comp-eln-cache-directory
+    (ignore-error file-error
+      (let* ((cached (comp-eln-cache-file file with-late-load))
+             (tmp-file (progn
+                         (make-directory (file-name-directory cached) t)
+                         (make-temp-file-internal
+                          (substring cached 0 -4) nil ".eln.tmp" nil))))
+        (unwind-protect
+            (progn
+              (copy-file eln-file tmp-file t)
+              ;; Renaming is atomic, so concurrent sessions never see
+              ;; a partial file.
+              (rename-file tmp-file cached t))
+          (ignore-errors (delete-file tmp-file)))))))
+
+(defun comp-async-fetch-cached (source-file load)
+  "Fetch SOURCE-FILE compiled from the .eln cache, if it is there.
+If so, load it as LOAD requests, see `native--compile-async', and
+return non-nil."
+  (when (comp-eln-cache-fetch source-file (and load t)
+                              (comp-el-to-eln-filename source-file))
+    (run-hook-with-args 'native-comp-async-cu-done-functions source-file)
+    (when load
+      (native-elisp-load (comp-el-to-eln-filename source-file)
+                         (eq load 'late)))
+    t))
 
 (defun comp-run-async-workers ()
   "Start compiling files from `comp-files-queue' asynchronously.
@@ -3917,16 +4359,17 @@ display a message."
           (> (comp-async-runnings) 0))
       (unless (>= (comp-async-runnings) (comp-effective-async-max-jobs))
         (cl-loop
-         for (source-file . load) = (pop comp-files-queue)
+         for (source-file . load) = (comp-async-next-file)
          while source-file
          do (cl-assert (string-match-p comp-valid-source-re source-file) nil
                        "`comp-files-queue' should be \".el\" files: %s"
                        source-file)
-         when (or native-comp-always-compile
-                  load ; Always compile when the compilation is
-                       ; commanded for late load.
-                  (file-newer-than-file-p
-                   source-file (comp-el-to-eln-filename source-file)))
+         when (and (or native-comp-always-compile
+                       load ; Always compile when the compilation is
+                            ; commanded for late load.
+                       (file-newer-than-file-p
+                        source-file (comp-el-to-eln-filename source-file)))
+                   (not (comp-async-fetch-cached source-file load)))
          do (let* ((expr `((require 'comp)
                            ,(when (boundp 'backtrace-line-length)
                               `(setf backtrace-line-length ,backtrace-line-length))
@@ -3942,6 +4385,15 @@ display a message."
                                  ',native-comp-compiler-options
                                  native-comp-driver-options
                                  ',native-comp-driver-options
+                                 native-comp-profile-file
+                                 ,native-comp-profile-file
+                                 native-comp-hot-speed ,native-comp-hot-speed
+                                 native-comp-hot-threshold
+                                 ,native-comp-hot-threshold
+                                 native-comp-eln-cache-directory
+                                 ,native-comp-eln-cache-directory
+                                 native-comp-always-compile
+                                 ,native-comp-always-compile
                                  load-path ',load-path
                                  warning-fill-column most-positive-fixnum)
                            ,native-comp-async-env-modifier-form
@@ -3961,38 +4413,48 @@ display a message."
                         (comp-log "\n")
                         (mapc #'comp-log expr-strings)))
                    (load1 load)
-                   (process (make-process
-                             :name (concat "Compiling: " source-file)
-                             :buffer (with-current-buffer
-                                         (get-buffer-create
-                                          comp-async-buffer-name)
-                                       (setf buffer-read-only t)
-			               (current-buffer))
-                             :command (list
-                                       (expand-file-name invocation-name
-                                                         invocation-directory)
-                                       "--batch" "-l" temp-file)
-                             :sentinel
-                             (lambda (process _event)
-                               (run-hook-with-args
-                                'native-comp-async-cu-done-functions
-                                source-file)
-                               (comp-accept-and-process-async-output process)
-                               (ignore-errors (delete-file temp-file))
-                               (let ((eln-file (comp-el-to-eln-filename
-                                                source-file1)))
-                                 (when (and load1
-                                            (zerop (process-exit-status
-                                                    process))
-                                            (file-exists-p eln-file))
-                                   (native-elisp-load eln-file
-                                                      (eq load1 'late))))
-                               (comp-run-async-workers))
-                             :noquery (not native-comp-async-query-on-exit))))
-              (puthash source-file process comp-async-compilations))
+                   (process (unless native-comp-async-persistent-workers
+                              (make-process
+                               :name (concat "Compiling: " source-file)
+                               :buffer (with-current-buffer
+                                           (get-buffer-create
+                                            comp-async-buffer-name)
+                                         (setf buffer-read-only t)
+			                 (current-buffer))
+                               :command (list
+                                         (expand-file-name invocation-name
+                                                           invocation-directory)
+                                         "--batch" "-l" temp-file)
+                               :sentinel
+                               (lambda (process _event)
+                                 (run-hook-with-args
+                                  'native-comp-async-cu-done-functions
+                                  source-file)
+                                 (comp-accept-and-process-async-output process)
+                                 (ignore-errors (delete-file temp-file))
+                                 (let ((eln-file (comp-el-to-eln-filename
+                                                  source-file1)))
+                                   (when (and load1
+                                              (zerop (process-exit-status
+                                                      process))
+                                              (file-exists-p eln-file))
+                                     (native-elisp-load eln-file
+                                                        (eq load1 'late))))
+                                 (comp-run-async-workers))
+                               :noquery (not native-comp-async-query-on-exit)))))
+              (if process
+                  (puthash source-file process comp-async-compilations)
+                (comp-async-dispatch source-file load temp-file)))
          when (>= (comp-async-runnings) (comp-effective-async-max-jobs))
            do (cl-return)))
     ;; No files left to compile and all processes finished.
+    (clrhash comp-file-features-h)
+    (when comp-async-workers
+      (when comp-async-worker-timer
+        (cancel-timer comp-async-worker-timer))
+      (setq comp-async-worker-timer
+            (run-with-timer comp-async-worker-idle-time nil
+                            #'comp-async-stop-idle-workers)))
     (run-hooks 'native-comp-async-all-done-hook)
     (with-current-buffer (get-buffer-create comp-async-buffer-name)
       (save-excursion
@@ -4016,6 +4478,16 @@ the deferred compilation mechanism."
     (signal 'native-compiler-error
             (list "Not a function symbol or file" function-or-file)))
   (catch 'no-native-compile
+    (when-let ((cached (and (stringp function-or-file)
+                            (not byte+native-compile)
+                            (not comp-dry-run)
+                            (comp-eln-cache-fetch
+                             function-or-file with-late-load
+                             (or output
+                                 (comp-el-to-eln-filename
+                                  function-or-file
+                                  native-compile-target-directory))))))
+      (throw 'no-native-compile cached))
     (let* ((data function-or-file)
            (comp-native-compiling t)
            (byte-native-qualities nil)
@@ -4063,7 +4535,10 @@ the deferred compilation mechanism."
 			           (cons function-or-file err-val)
 			         (list function-or-file err-val)))))))
       (if (stringp function-or-file)
-          data
+          (progn
+            (when (and (stringp data) (not comp-dry-run))
+              (comp-eln-cache-store function-or-file with-late-load data))
+            data)
         ;; So we return the compiled function.
         (native-elisp-load data)))))
 
@@ -320,8 +320,28 @@ static struct gcstat
   object_ct total_floats, total_free_floats;
   object_ct total_intervals, total_free_intervals;
   object_ct total_buffers;
+  /* Objects allocated since the previous GC that survived it, and
+     those that did not.  */
+  object_ct young_conses, young_dead_conses;
+  object_ct young_floats, young_dead_floats;
+  /* Blocks of each kind kept, and bytes of live data in those blocks
+     whose objects vary in size.  */
+  object_ct cons_blocks, float_blocks, interval_blocks, symbol_blocks;
+  object_ct string_blocks, sblocks, vector_blocks;
+  byte_ct sblock_bytes, vector_block_bytes;
 } gcstat;
 
+/* Values of cons_cells_consed and floats_consed at the previous GC,
+   to count the objects allocated since.  */
+
+static EMACS_INT conses_consed_at_gc, floats_consed_at_gc;
+
+/* Number of garbage collections whose duration fell into each bucket
+   of `garbage-collect-pause-histogram'.  */
+
+enum { GC_PAUSE_BUCKETS = 12 };
+static intmax_t gc_pause_counts[GC_PAUSE_BUCKETS];
+
 /* Points to memory space allocated as "spare", to be freed if we run
    out of memory.  We keep one large block, four cons-blocks, and
    two string blocks.  */
@@ -434,6 +454,7 @@ no_sanitize_memcpy (void *dest, void const *src, size_t size)
 static void unchain_finalizer (struct Lisp_Finalizer *);
 static void mark_terminals (void);
 static void gc_sweep (void);
+static void finish_lazy_sweep (void);
 static Lisp_Object make_pure_vector (ptrdiff_t);
 static void mark_buffer (struct buffer *);
 
@@ -554,6 +575,50 @@ static void *min_heap_address, *max_heap_address;
 static struct mem_node mem_z;
 #define MEM_NIL &mem_z
 
+/* In front of the tree sits a hash table indexed by page number,
+   where a page is a BLOCK_ALIGN-sized piece of the address space.
+   For each page that overlaps one or more nodes of the tree, it
+   records how many nodes do, and which one if there is only one.
+   This lets mem_find dismiss most pointers that are not into Lisp
+   data, and find the node of most that are, in constant time.  Cons,
+   float and interval blocks are aligned on BLOCK_ALIGN, so each of
+   them has a page of its own.  */
+
+struct mem_page
+{
+  /* Page number, i.e., address divided by BLOCK_ALIGN.  Zero if this
+     slot of the table is unused.  */
+  uintptr_t page;
+
+  /* The only node overlapping this page, or NULL if the tree must be
+     searched.  */
+  struct mem_node *node;
+
+  /* Number of nodes overlapping this page.  */
+  ptrdiff_t nodes;
+};
+
+/* The page table, its size, which is zero or a power of 2, the base 2
+   logarithm of that size, and the number of slots in use.  */
+
+static struct mem_page *mem_pages;
+static ptrdiff_t mem_pages_size;
+static int mem_pages_bits;
+static ptrdiff_t mem_pages_used;
+
+/* Nodes overlapping more than this many pages are not entered in the
+   page table, which would need an entry for each of their pages.
+   They are kept once each in mem_large instead, sorted by address,
+   and looked up by binary search.  */
+
+enum { MEM_PAGES_MAX_NODE_PAGES = 16 };
+
+/* The nodes too large for the page table, their number, and the
+   allocated size of mem_large.  */
+
+static struct mem_node **mem_large;
+static ptrdiff_t mem_large_count, mem_large_size;
+
 static struct mem_node *mem_insert (void *, void *, enum mem_type);
 static void mem_insert_fixup (struct mem_node *);
 static void mem_rotate_left (struct mem_node *);
@@ -1989,6 +2054,7 @@ sweep_strings (void)
   string_free_list = NULL;
   gcstat.total_strings = gcstat.total_free_strings = 0;
   gcstat.total_string_bytes = 0;
+  gcstat.string_blocks = 0;
 
   /* Scan strings_blocks, free Lisp_Strings that aren't marked.  */
   for (b = string_blocks; b; b = next)
@@ -2062,6 +2128,7 @@ sweep_strings (void)
       else
 	{
 	  gcstat.total_free_strings += nfree;
+	  gcstat.string_blocks++;
 	  b->next = live_blocks;
 	  live_blocks = b;
 	}
@@ -2073,6 +2140,14 @@ sweep_strings (void)
   free_large_strings ();
   compact_small_strings ();
 
+  gcstat.sblocks = 0;
+  gcstat.sblock_bytes = 0;
+  for (struct sblock *b = oldest_sblock; b; b = b->next)
+    {
+      gcstat.sblocks++;
+      gcstat.sblock_bytes += (char *) b->next_free - (char *) b;
+    }
+
   check_string_free_list ();
 }
 
@@ -2517,8 +2592,8 @@ make_formatted_string (char *buf, const char *format, ...)
 #define FLOAT_BLOCK_SIZE					\
   (((BLOCK_BYTES - sizeof (struct float_block *)		\
      /* The compiler might add padding at the end.  */		\
-     - (sizeof (struct Lisp_Float) - sizeof (bits_word))) * CHAR_BIT) \
-   / (sizeof (struct Lisp_Float) * CHAR_BIT + 1))
+     - 2 * (sizeof (struct Lisp_Float) - sizeof (bits_word))) * CHAR_BIT) \
+   / (sizeof (struct Lisp_Float) * CHAR_BIT + 2))
 
 #define GETMARKBIT(block,n)				\
   (((block)->gcmarkbits[(n) / BITS_PER_BITS_WORD]	\
@@ -2533,6 +2608,12 @@ make_formatted_string (char *buf, const char *format, ...)
   ((block)->gcmarkbits[(n) / BITS_PER_BITS_WORD]	\
    &= ~((bits_word) 1 << ((n) % BITS_PER_BITS_WORD)))
 
+/* Each cons_block and float_block also has a bitmap recording which
+   of its objects were free at the end of the previous GC.  An object
+   that is marked now and was free then has been allocated since, so
+   the sweep phase can tell young objects from old ones without the
+   allocators doing any work, see `garbage-collect-generation-statistics'.  */
+
 #define FLOAT_BLOCK(fptr) \
   (eassert (!pdumper_object_p (fptr)),                                  \
    ((struct float_block *) (((uintptr_t) (fptr)) & ~(BLOCK_ALIGN - 1))))
@@ -2545,6 +2626,7 @@ struct float_block
   /* Place `floats' at the beginning, to ease up FLOAT_INDEX's job.  */
   struct Lisp_Float floats[FLOAT_BLOCK_SIZE];
   bits_word gcmarkbits[1 + FLOAT_BLOCK_SIZE / BITS_PER_BITS_WORD];
+  bits_word gcfreebits[1 + FLOAT_BLOCK_SIZE / BITS_PER_BITS_WORD];
   struct float_block *next;
 };
 
@@ -2569,6 +2651,36 @@ static int float_block_index = FLOAT_BLOCK_SIZE;
 
 static struct Lisp_Float *float_free_list;
 
+/* The float_block whose unmarked floats are to be put on the free
+   list next, see sweep_floats.  NULL if all blocks have been swept
+   since the last GC.  */
+
+static struct float_block **float_sweep_cursor;
+
+/* Sweep the next float_block that has not been swept since the last
+   GC: put its unmarked floats on the free list, and unmark the
+   others.  */
+
+static void
+sweep_next_float_block (void)
+{
+  struct float_block *fblk = *float_sweep_cursor;
+  int lim = fblk == float_block ? float_block_index : FLOAT_BLOCK_SIZE;
+
+  for (int i = 0; i < lim; i++)
+    {
+      struct Lisp_Float *afloat = &fblk->floats[i];
+      if (!XFLOAT_MARKED_P (afloat))
+	{
+	  afloat->u.chain = float_free_list;
+	  float_free_list = afloat;
+	}
+      else
+	XFLOAT_UNMARK (afloat);
+    }
+  float_sweep_cursor = fblk->next ? &fblk->next : NULL;
+}
+
 /* Return a new float object with value FLOAT_VALUE.  */
 
 Lisp_Object
@@ -2578,6 +2690,9 @@ make_float (double float_value)
 
   MALLOC_BLOCK_INPUT;
 
+  while (!float_free_list && float_sweep_cursor)
+    sweep_next_float_block ();
+
   if (float_free_list)
     {
       XSETFLOAT (val, float_free_list);
@@ -2591,6 +2706,7 @@ make_float (double float_value)
 	    = lisp_align_malloc (sizeof *new, MEM_TYPE_FLOAT);
 	  new->next = float_block;
 	  memset (new->gcmarkbits, 0, sizeof new->gcmarkbits);
+	  memset (new->gcfreebits, -1, sizeof new->gcfreebits);
 	  float_block = new;
 	  float_block_index = 0;
 	}
@@ -2621,8 +2737,8 @@ make_float (double float_value)
 #define CONS_BLOCK_SIZE						\
   (((BLOCK_BYTES - sizeof (struct cons_block *)			\
      /* The compiler might add padding at the end.  */		\
-     - (sizeof (struct Lisp_Cons) - sizeof (bits_word))) * CHAR_BIT)	\
-   / (sizeof (struct Lisp_Cons) * CHAR_BIT + 1))
+     - 2 * (sizeof (struct Lisp_Cons) - sizeof (bits_word))) * CHAR_BIT) \
+   / (sizeof (struct Lisp_Cons) * CHAR_BIT + 2))
 
 #define CONS_BLOCK(fptr) \
   (eassert (!pdumper_object_p (fptr)),                                  \
@@ -2636,6 +2752,7 @@ struct cons_block
   /* Place `conses' at the beginning, to ease up CONS_INDEX's job.  */
   struct Lisp_Cons conses[CONS_BLOCK_SIZE];
   bits_word gcmarkbits[1 + CONS_BLOCK_SIZE / BITS_PER_BITS_WORD];
+  bits_word gcfreebits[1 + CONS_BLOCK_SIZE / BITS_PER_BITS_WORD];
   struct cons_block *next;
 };
 
@@ -2665,11 +2782,63 @@ static int cons_block_index = CONS_BLOCK_SIZE;
 
 static struct Lisp_Cons *cons_free_list;
 
+/* The cons_block whose unmarked conses are to be put on the free
+   list next, see sweep_conses.  NULL if all blocks have been swept
+   since the last GC.  */
+
+static struct cons_block **cons_sweep_cursor;
+
+/* Sweep the next cons_block that has not been swept since the last
+   GC: put its unmarked conses on the free list, and unmark the
+   others.  */
+
+static void
+sweep_next_cons_block (void)
+{
+  struct cons_block *cblk = *cons_sweep_cursor;
+  int lim = cblk == cons_block ? cons_block_index : CONS_BLOCK_SIZE;
+  int ilim = (lim + BITS_PER_BITS_WORD - 1) / BITS_PER_BITS_WORD;
+
+  /* Scan the mark bits an int at a time.  */
+  for (int i = 0; i < ilim; i++)
+    {
+      if (cblk->gcmarkbits[i] == BITS_WORD_MAX)
+	/* Fast path - all cons cells for this int are marked.  */
+	cblk->gcmarkbits[i] = 0;
+      else
+	{
+	  /* Some cons cells for this int are not marked.
+	     Find which ones, and free them.  */
+	  int start = i * BITS_PER_BITS_WORD;
+	  int stop = start + min (lim - start, BITS_PER_BITS_WORD);
+
+	  for (int pos = start; pos < stop; pos++)
+	    {
+	      struct Lisp_Cons *acons = &cblk->conses[pos];
+	      if (!XCONS_MARKED_P (acons))
+		{
+		  acons->u.s.u.chain = cons_free_list;
+		  acons->u.s.car = dead_object ();
+		  cons_free_list = acons;
+		}
+	      else
+		XUNMARK_CONS (acons);
+	    }
+	}
+    }
+  cons_sweep_cursor = cblk->next ? &cblk->next : NULL;
+}
+
 /* Explicitly free a cons cell by putting it on the free-list.  */
 
 void
 free_cons (struct Lisp_Cons *ptr)
 {
+  /* A cons that is still marked is in a block that has not been swept
+     since the last GC.  Sweeping will unmark it and keep it, so
+     leave it alone until the next GC.  */
+  if (XCONS_MARKED_P (ptr))
+    return;
   ptr->u.s.u.chain = cons_free_list;
   ptr->u.s.car = dead_object ();
   cons_free_list = ptr;
@@ -2685,6 +2854,9 @@ DEFUN ("cons", Fcons, Scons, 2, 2, 0,
 
   MALLOC_BLOCK_INPUT;
 
+  while (!cons_free_list && cons_sweep_cursor)
+    sweep_next_cons_block ();
+
   if (cons_free_list)
     {
       XSETCONS (val, cons_free_list);
@@ -2697,6 +2869,7 @@ DEFUN ("cons", Fcons, Scons, 2, 2, 0,
 	  struct cons_block *new
 	    = lisp_align_malloc (sizeof *new, MEM_TYPE_CONS);
 	  memset (new->gcmarkbits, 0, sizeof new->gcmarkbits);
+	  memset (new->gcfreebits, -1, sizeof new->gcfreebits);
 	  new->next = cons_block;
 	  cons_block = new;
 	  cons_block_index = 0;
@@ -2947,6 +3120,57 @@ static struct vector_block *vector_blocks;
 
 static struct Lisp_Vector *vector_free_lists[VECTOR_MAX_FREE_LIST_INDEX];
 
+/* Bitmap of the vector free lists that may be nonempty, so that
+   finding a free vector to split does not need to look at every
+   larger free list.  A bit is set whenever a vector is put on its
+   list, and only cleared by next_vector_free_list when the list turns
+   out to be empty.  */
+
+enum { VECTOR_FREE_LIST_WORDS = ((VECTOR_MAX_FREE_LIST_INDEX
+				  + BITS_PER_BITS_WORD - 1)
+				 / BITS_PER_BITS_WORD) };
+static bits_word vector_free_list_bits[VECTOR_FREE_LIST_WORDS];
+
+static void
+set_vector_free_list_bit (ptrdiff_t index)
+{
+  vector_free_list_bits[index / BITS_PER_BITS_WORD]
+    |= (bits_word) 1 << (index % BITS_PER_BITS_WORD);
+}
+
+static void
+unset_vector_free_list_bit (ptrdiff_t index)
+{
+  vector_free_list_bits[index / BITS_PER_BITS_WORD]
+    &= ~((bits_word) 1 << (index % BITS_PER_BITS_WORD));
+}
+
+/* Return the index of the first nonempty vector free list at INDEX or
+   after it, or VECTOR_MAX_FREE_LIST_INDEX if there is none.  */
+
+static ptrdiff_t
+next_vector_free_list (ptrdiff_t index)
+{
+  ptrdiff_t w = index / BITS_PER_BITS_WORD;
+  bits_word bits = (vector_free_list_bits[w]
+		    & (BITS_WORD_MAX << (index % BITS_PER_BITS_WORD)));
+
+  while (true)
+    {
+      while (!bits)
+	{
+	  if (++w == VECTOR_FREE_LIST_WORDS)
+	    return VECTOR_MAX_FREE_LIST_INDEX;
+	  bits = vector_free_list_bits[w];
+	}
+      ptrdiff_t i = w * BITS_PER_BITS_WORD + count_trailing_zero_bits (bits);
+      if (vector_free_lists[i])
+	return i;
+      unset_vector_free_list_bit (i);
+      bits &= bits - 1;
+    }
+}
+
 /* Singly-linked list of large vectors.  */
 
 static struct large_vector *large_vectors;
@@ -2968,6 +3192,7 @@ setup_on_free_list (struct Lisp_Vector *v, ptrdiff_t nbytes)
   eassert (vindex < VECTOR_MAX_FREE_LIST_INDEX);
   set_next_vector (v, vector_free_lists[vindex]);
   vector_free_lists[vindex] = v;
+  set_vector_free_list_bit (vindex);
 }
 
 /* Get a new vector block.  */
@@ -3021,21 +3246,20 @@ allocate_vector_from_block (ptrdiff_t nbytes)
   /* Next, check free lists containing larger vectors.  Since
      we will split the result, we should have remaining space
      large enough to use for one-slot vector at least.  */
-  for (index = VINDEX (nbytes + VBLOCK_BYTES_MIN);
-       index < VECTOR_MAX_FREE_LIST_INDEX; index++)
-    if (vector_free_lists[index])
-      {
-	/* This vector is larger than requested.  */
-	vector = vector_free_lists[index];
-	vector_free_lists[index] = next_vector (vector);
-
-	/* Excess bytes are used for the smaller vector,
-	   which should be set on an appropriate free list.  */
-	restbytes = index * roundup_size + VBLOCK_BYTES_MIN - nbytes;
-	eassert (restbytes % roundup_size == 0);
-	setup_on_free_list (ADVANCE (vector, nbytes), restbytes);
-	return vector;
-      }
+  index = next_vector_free_list (VINDEX (nbytes + VBLOCK_BYTES_MIN));
+  if (index < VECTOR_MAX_FREE_LIST_INDEX)
+    {
+      /* This vector is larger than requested.  */
+      vector = vector_free_lists[index];
+      vector_free_lists[index] = next_vector (vector);
+
+      /* Excess bytes are used for the smaller vector,
+	 which should be set on an appropriate free list.  */
+      restbytes = index * roundup_size + VBLOCK_BYTES_MIN - nbytes;
+      eassert (restbytes % roundup_size == 0);
+      setup_on_free_list (ADVANCE (vector, nbytes), restbytes);
+      return vector;
+    }
 
   /* Finally, need a new vector block.  */
   block = allocate_vector_block ();
@@ -3186,13 +3410,17 @@ sweep_vectors (void)
 
   gcstat.total_vectors = 0;
   gcstat.total_vector_slots = gcstat.total_free_vector_slots = 0;
+  gcstat.vector_blocks = 0;
+  gcstat.vector_block_bytes = 0;
   memset (vector_free_lists, 0, sizeof (vector_free_lists));
+  memset (vector_free_list_bits, 0, sizeof (vector_free_list_bits));
 
   /* Looking through vector blocks.  */
 
   for (block = vector_blocks; block; block = *bprev)
     {
       bool free_this_block = false;
+      byte_ct live_bytes = 0;
 
       for (vector = (struct Lisp_Vector *) block->data;
 	   VECTOR_IN_BLOCK (vector, block); vector = next)
@@ -3203,6 +3431,7 @@ sweep_vectors (void)
 	      gcstat.total_vectors++;
 	      ptrdiff_t nbytes = vector_nbytes (vector);
 	      gcstat.total_vector_slots += nbytes / word_size;
+	      live_bytes += nbytes;
 	      next = ADVANCE (vector, nbytes);
 	    }
 	  else
@@ -3246,7 +3475,11 @@ sweep_vectors (void)
 	  xfree (block);
 	}
       else
-	bprev = &block->next;
+	{
+	  gcstat.vector_blocks++;
+	  gcstat.vector_block_bytes += live_bytes;
+	  bprev = &block->next;
+	}
     }
 
   /* Sweep large vectors.  */
@@ -4117,6 +4350,239 @@ refill_memory_reserve (void)
    tree, and use that to determine if the pointer points into a Lisp
    object or not.  */
 
+/* Return the index of the slot of the page table where PAGE would
+   first be looked for.  Scatter consecutive pages, so that pointers
+   that are not into Lisp data are quickly found to be missing even
+   when the heap is contiguous.  */
+
+static ptrdiff_t
+mem_page_home (uintptr_t page)
+{
+  return ((uint64_t) page * 0x9e3779b97f4a7c15u) >> (64 - mem_pages_bits);
+}
+
+/* Return the index of the slot of the page table that holds PAGE, or
+   of the unused slot where PAGE would go.  */
+
+static ptrdiff_t
+mem_page_slot (uintptr_t page)
+{
+  ptrdiff_t mask = mem_pages_size - 1;
+  ptrdiff_t i = mem_page_home (page);
+
+  while (mem_pages[i].page != page && mem_pages[i].page != 0)
+    i = (i + 1) & mask;
+  return i;
+}
+
+/* Double the size of the page table.  */
+
+static void
+mem_pages_grow (void)
+{
+  struct mem_page *old = mem_pages;
+  ptrdiff_t old_size = mem_pages_size;
+  ptrdiff_t size = old_size ? 2 * old_size : 1 << 10;
+
+#ifdef GC_MALLOC_CHECK
+  mem_pages = calloc (size, sizeof *mem_pages);
+  if (mem_pages == NULL)
+    emacs_abort ();
+#else
+  mem_pages = xzalloc (size * sizeof *mem_pages);
+#endif
+  mem_pages_size = size;
+  mem_pages_bits = old_size ? mem_pages_bits + 1 : 10;
+
+  for (ptrdiff_t i = 0; i < old_size; i++)
+    if (old[i].page)
+      mem_pages[mem_page_slot (old[i].page)] = old[i];
+
+#ifdef GC_MALLOC_CHECK
+  free (old);
+#else
+  xfree (old);
+#endif
+}
+
+/* Return true if a node from START to END is kept in mem_large
+   rather than in the page table.  */
+
+static bool
+mem_large_node_p (void *start, void *end)
+{
+  uintptr_t first = (uintptr_t) start / BLOCK_ALIGN;
+  uintptr_t last = ((uintptr_t) end - 1) / BLOCK_ALIGN;
+  return last - first >= MEM_PAGES_MAX_NODE_PAGES;
+}
+
+/* Return the number of nodes in mem_large that start at or before P.  */
+
+static ptrdiff_t
+mem_large_index (void *p)
+{
+  ptrdiff_t lo = 0, hi = mem_large_count;
+  while (lo < hi)
+    {
+      ptrdiff_t mid = lo + (hi - lo) / 2;
+      if (mem_large[mid]->start <= p)
+	lo = mid + 1;
+      else
+	hi = mid;
+    }
+  return lo;
+}
+
+/* Return the node of mem_large containing P, or MEM_NIL.  */
+
+static struct mem_node *
+mem_large_find (void *p)
+{
+  ptrdiff_t i = mem_large_index (p);
+  return i > 0 && p < mem_large[i - 1]->end ? mem_large[i - 1] : MEM_NIL;
+}
+
+/* Add node X to mem_large.  */
+
+static void
+mem_large_add (struct mem_node *x)
+{
+  if (mem_large_count == mem_large_size)
+    {
+      ptrdiff_t size = mem_large_size ? 2 * mem_large_size : 64;
+#ifdef GC_MALLOC_CHECK
+      mem_large = realloc (mem_large, size * sizeof *mem_large);
+      if (mem_large == NULL)
+	emacs_abort ();
+#else
+      mem_large = xrealloc (mem_large, size * sizeof *mem_large);
+#endif
+      mem_large_size = size;
+    }
+  ptrdiff_t i = mem_large_index (x->start);
+  memmove (&mem_large[i + 1], &mem_large[i],
+	   (mem_large_count - i) * sizeof *mem_large);
+  mem_large[i] = x;
+  mem_large_count++;
+}
+
+/* Return the index in mem_large of the node starting at START.  */
+
+static ptrdiff_t
+mem_large_position (void *start)
+{
+  ptrdiff_t i = mem_large_index (start) - 1;
+  eassert (0 <= i && mem_large[i]->start == start);
+  return i;
+}
+
+/* Record in the page table that node X overlaps all pages from the
+   one containing START to the one containing END - 1.  */
+
+static void
+mem_pages_add (void *start, void *end, struct mem_node *x)
+{
+  uintptr_t first = (uintptr_t) start / BLOCK_ALIGN;
+  uintptr_t last = ((uintptr_t) end - 1) / BLOCK_ALIGN;
+
+  if (mem_large_node_p (start, end))
+    {
+      mem_large_add (x);
+      return;
+    }
+
+  for (uintptr_t page = first; page <= last; page++)
+    {
+      if (2 * (mem_pages_used + 1) > mem_pages_size)
+	mem_pages_grow ();
+
+      struct mem_page *p = &mem_pages[mem_page_slot (page)];
+      if (p->page == 0)
+	{
+	  p->page = page;
+	  p->node = x;
+	  p->nodes = 1;
+	  mem_pages_used++;
+	}
+      else
+	{
+	  p->node = NULL;
+	  p->nodes++;
+	}
+    }
+}
+
+/* Record in the page table that a node from START to END is gone.  */
+
+static void
+mem_pages_remove (void *start, void *end)
+{
+  uintptr_t first = (uintptr_t) start / BLOCK_ALIGN;
+  uintptr_t last = ((uintptr_t) end - 1) / BLOCK_ALIGN;
+  ptrdiff_t mask = mem_pages_size - 1;
+
+  if (mem_large_node_p (start, end))
+    {
+      ptrdiff_t i = mem_large_position (start);
+      memmove (&mem_large[i], &mem_large[i + 1],
+	       (mem_large_count - i - 1) * sizeof *mem_large);
+      mem_large_count--;
+      return;
+    }
+
+  for (uintptr_t page = first; page <= last; page++)
+    {
+      ptrdiff_t i = mem_page_slot (page);
+      eassert (mem_pages[i].page == page);
+
+      if (--mem_pages[i].nodes != 0)
+	{
+	  mem_pages[i].node = NULL;
+	  continue;
+	}
+
+      /* Free the slot, moving back any later entries of the same
+	 probe sequence, so that the table needs no tombstones.  */
+      for (ptrdiff_t j = i; ; )
+	{
+	  j = (j + 1) & mask;
+	  if (mem_pages[j].page == 0)
+	    break;
+	  ptrdiff_t k = mem_page_home (mem_pages[j].page);
+	  if (i <= j ? i < k && k <= j : i < k || k <= j)
+	    continue;
+	  mem_pages[i] = mem_pages[j];
+	  i = j;
+	}
+      mem_pages[i].page = 0;
+      mem_pages_used--;
+    }
+}
+
+/* Make the page table entries from START to END that refer to node
+   FROM refer to node TO instead.  */
+
+static void
+mem_pages_move (void *start, void *end,
+		struct mem_node *from, struct mem_node *to)
+{
+  uintptr_t first = (uintptr_t) start / BLOCK_ALIGN;
+  uintptr_t last = ((uintptr_t) end - 1) / BLOCK_ALIGN;
+
+  if (mem_large_node_p (start, end))
+    {
+      mem_large[mem_large_position (start)] = to;
+      return;
+    }
+
+  for (uintptr_t page = first; page <= last; page++)
+    {
+      struct mem_page *p = &mem_pages[mem_page_slot (page)];
+      if (p->node == from)
+	p->node = to;
+    }
+}
+
 /* Initialize this part of alloc.c.  */
 
 static void
@@ -4141,6 +4607,17 @@ mem_find (void *start)
   if (start < min_heap_address || start > max_heap_address)
     return MEM_NIL;
 
+  /* A page without any entry, or whose only entry does not contain
+     START, can still be part of a node in mem_large.  */
+  struct mem_page *page
+    = (mem_pages_size == 0 ? NULL
+       : &mem_pages[mem_page_slot ((uintptr_t) start / BLOCK_ALIGN)]);
+  if (!page || page->page == 0)
+    return mem_large_find (start);
+  if (page->node)
+    return (page->node->start <= start && start < page->node->end
+	    ? page->node : mem_large_find (start));
+
   /* Make the search always successful to speed up the loop below.  */
   mem_z.start = start;
   mem_z.end = (char *) start + 1;
@@ -4207,6 +4684,7 @@ mem_insert (void *start, void *end, enum mem_type type)
   /* Re-establish red-black tree properties.  */
   mem_insert_fixup (x);
 
+  mem_pages_add (start, end, x);
   return x;
 }
 
@@ -4368,6 +4846,8 @@ mem_delete (struct mem_node *z)
   if (!z || z == MEM_NIL)
     return;
 
+  mem_pages_remove (z->start, z->end);
+
   if (z->left == MEM_NIL || z->right == MEM_NIL)
     y = z;
   else
@@ -4398,6 +4878,7 @@ mem_delete (struct mem_node *z)
       z->start = y->start;
       z->end = y->end;
       z->type = y->type;
+      mem_pages_move (z->start, z->end, y, z);
     }
 
   if (y->color == MEM_BLACK)
@@ -6045,6 +6526,32 @@ maybe_garbage_collect (void)
     garbage_collect ();
 }
 
+/* Return true if enough has been allocated since the last GC to
+   collect garbage while Emacs waits for input, according to
+   `gc-cons-idle-fraction'.  Collecting then keeps the collection from
+   interrupting the next command.  */
+bool
+gc_idle_collection_due_p (void)
+{
+  if (!NUMBERP (Vgc_cons_idle_fraction))
+    return false;
+  double fraction = XFLOATINT (Vgc_cons_idle_fraction);
+  EMACS_INT since_gc = gc_threshold - consing_until_gc;
+  return 0 < fraction && fraction < 1 && since_gc > fraction * gc_threshold;
+}
+
+/* Return the index of the `garbage-collect-pause-histogram' bucket
+   for a collection that took PAUSE.  */
+static int
+gc_pause_bucket (struct timespec pause)
+{
+  double msecs = timespectod (pause) * 1000;
+  int i = 0;
+  while (i < GC_PAUSE_BUCKETS - 1 && msecs >= 1 << i)
+    i++;
+  return i;
+}
+
 /* Subroutine of Fgarbage_collect that does most of the work.  */
 void
 garbage_collect (void)
@@ -6124,7 +6631,11 @@ garbage_collect (void)
 
   shrink_regexp_cache ();
 
+  /* All mark bits must be clear before marking starts.  */
+  finish_lazy_sweep ();
+
   gc_in_progress = 1;
+  struct timespec mark_start = current_timespec ();
 
   /* Mark all the special slots that serve as the roots of accessibility.  */
 
@@ -6136,6 +6647,7 @@ garbage_collect (void)
   mark_terminals ();
   mark_kboards ();
   mark_threads ();
+  mark_regexp_cache ();
 #ifdef HAVE_PGTK
   mark_pgtkterm();
 #endif
@@ -6177,6 +6689,7 @@ garbage_collect (void)
   /* Must happen after all other marking and before gc_sweep.  */
   mark_and_sweep_weak_table_contents ();
   eassert (weak_hash_tables == NULL);
+  struct timespec mark_time = timespec_sub (current_timespec (), mark_start);
 
   gc_sweep ();
 
@@ -6212,14 +6725,21 @@ garbage_collect (void)
     }
 
   /* Accumulate statistics.  */
+  struct timespec pause = timespec_sub (current_timespec (), start);
   if (FLOATP (Vgc_elapsed))
     {
       static struct timespec gc_elapsed;
-      gc_elapsed = timespec_add (gc_elapsed,
-				 timespec_sub (current_timespec (), start));
+      gc_elapsed = timespec_add (gc_elapsed, pause);
       Vgc_elapsed = make_float (timespectod (gc_elapsed));
     }
+  if (FLOATP (Vgc_mark_elapsed))
+    {
+      static struct timespec gc_mark_elapsed;
+      gc_mark_elapsed = timespec_add (gc_mark_elapsed, mark_time);
+      Vgc_mark_elapsed = make_float (timespectod (gc_mark_elapsed));
+    }
 
+  gc_pause_counts[gc_pause_bucket (pause)]++;
   gcs_done++;
 
   /* Collect profiling data.  */
@@ -6298,6 +6818,145 @@ For further details, see Info node `(elisp)Garbage Collection'.  */)
   return CALLMANY (Flist, total);
 }
 
+DEFUN ("garbage-collect-generation-statistics",
+       Fgarbage_collect_generation_statistics,
+       Sgarbage_collect_generation_statistics, 0, 0, 0,
+       doc: /* Return object survival statistics of the most recent GC.
+The value is a list with an entry for each kind of object whose age is
+tracked.  Each entry has the form (NAME SIZE YOUNG-USED YOUNG-FREED
+OLD-USED), where:
+- NAME is a symbol describing the kind of objects this entry represents,
+- SIZE is the number of bytes used by each one,
+- YOUNG-USED is the number of objects allocated since the GC before
+  that were found live,
+- YOUNG-FREED is the number of objects allocated since the GC before
+  that were found dead and reclaimed,
+- OLD-USED is the number of objects that were live before the GC
+  before and are still live.
+
+A high ratio of YOUNG-FREED to YOUNG-USED means that most of the
+allocated data is short-lived.  This function does not itself
+collect garbage; call `garbage-collect' first to get fresh data.  */)
+  (void)
+{
+  struct gcstat gcst = gcstat;
+
+  return list2 (list5 (Qconses, make_fixnum (sizeof (struct Lisp_Cons)),
+		       make_int (gcst.young_conses),
+		       make_int (gcst.young_dead_conses),
+		       make_int (gcst.total_conses - gcst.young_conses)),
+		list5 (Qfloats, make_fixnum (sizeof (struct Lisp_Float)),
+		       make_int (gcst.young_floats),
+		       make_int (gcst.young_dead_floats),
+		       make_int (gcst.total_floats - gcst.young_floats)));
+}
+
+static Lisp_Object
+fragmentation_entry (Lisp_Object name, object_ct blocks,
+		     byte_ct bytes, byte_ct live_bytes)
+{
+  return list4 (name, make_int (blocks), make_uint (bytes),
+		make_uint (live_bytes));
+}
+
+DEFUN ("memory-fragmentation-report", Fmemory_fragmentation_report,
+       Smemory_fragmentation_report, 0, 0, 0,
+       doc: /* Return how full the blocks of Lisp data were after the last GC.
+The value is a list with an entry for each kind of block from which
+Lisp objects are allocated.  Each entry has the form (NAME BLOCKS
+BYTES LIVE-BYTES), where:
+- NAME is a symbol describing the kind of blocks this entry represents,
+- BLOCKS is the number of such blocks the GC kept,
+- BYTES is the number of bytes they occupy,
+- LIVE-BYTES is how many of those bytes hold live objects.
+
+The difference between BYTES and LIVE-BYTES is memory that can only be
+reused for objects of the same kind.  The kinds are `conses',
+`floats', `intervals', `symbols' and `strings', whose blocks hold
+objects of a fixed size, `string-data', the blocks that hold the
+contents of small strings, and `vectors', the blocks that hold small
+vectors and other vector-like objects.  Large strings and vectors,
+which each have a block of their own, and objects loaded from the dump
+file and pure storage are not counted.
+
+This function does not itself collect garbage; call `garbage-collect'
+first to get fresh data.  */)
+  (void)
+{
+  struct gcstat gcst = gcstat;
+  object_ct block_symbols = gcst.total_symbols - ARRAYELTS (lispsym);
+
+  Lisp_Object report[] = {
+    fragmentation_entry (Qconses, gcst.cons_blocks,
+			 gcst.cons_blocks * sizeof (struct cons_block),
+			 gcst.total_conses * sizeof (struct Lisp_Cons)),
+    fragmentation_entry (Qfloats, gcst.float_blocks,
+			 gcst.float_blocks * sizeof (struct float_block),
+			 gcst.total_floats * sizeof (struct Lisp_Float)),
+    fragmentation_entry (Qintervals, gcst.interval_blocks,
+			 gcst.interval_blocks * sizeof (struct interval_block),
+			 gcst.total_intervals * sizeof (struct interval)),
+    fragmentation_entry (Qsymbols, gcst.symbol_blocks,
+			 gcst.symbol_blocks * sizeof (struct symbol_block),
+			 block_symbols * sizeof (struct Lisp_Symbol)),
+    fragmentation_entry (Qstrings, gcst.string_blocks,
+			 gcst.string_blocks * sizeof (struct string_block),
+			 gcst.total_strings * sizeof (struct Lisp_String)),
+    fragmentation_entry (Qstring_data, gcst.sblocks,
+			 gcst.sblocks * SBLOCK_SIZE, gcst.sblock_bytes),
+    fragmentation_entry (Qvectors, gcst.vector_blocks,
+			 gcst.vector_blocks * sizeof (struct vector_block),
+			 gcst.vector_block_bytes),
+  };
+  return CALLMANY (Flist, report);
+}
+
+#ifdef HAVE_MALLOC_TRIM
+DEFUN ("malloc-trim", Fmalloc_trim, Smalloc_trim, 0, 1, "",
+       doc: /* Release free heap memory to the operating system.
+Memory freed by the garbage collector normally stays in the heap of the
+Emacs process, to be reused by later allocations.  This function asks
+the C library to return as much of it as possible to the system, which
+reduces the resident size of a long-running Emacs whose heap is
+fragmented.  It is not guaranteed to do anything, and is best called
+right after `garbage-collect', for instance from `post-gc-hook'.
+
+If LEAVE-PADDING is non-nil, it is the number of bytes to leave free
+at the top of the heap; the default is 0.
+
+Return non-nil if some memory was released, nil otherwise.  */)
+  (Lisp_Object leave_padding)
+{
+  size_t pad = 0;
+  if (!NILP (leave_padding))
+    {
+      CHECK_FIXNAT (leave_padding);
+      pad = XFIXNAT (leave_padding);
+    }
+  return malloc_trim (pad) ? Qt : Qnil;
+}
+#endif
+
+DEFUN ("garbage-collect-pause-histogram", Fgarbage_collect_pause_histogram,
+       Sgarbage_collect_pause_histogram, 0, 1, 0,
+       doc: /* Return a histogram of the time spent in each garbage collection.
+The value is a vector of counts.  Element 0 counts the collections that
+took less than 1 millisecond, and element N, for N between 1 and 10,
+counts those that took at least 2**(N-1) and less than 2**N
+milliseconds.  The last element, 11, counts the collections that took
+1024 milliseconds or longer.
+
+If RESET is non-nil, clear the counts after returning them.  */)
+  (Lisp_Object reset)
+{
+  Lisp_Object counts = make_nil_vector (GC_PAUSE_BUCKETS);
+  for (int i = 0; i < GC_PAUSE_BUCKETS; i++)
+    ASET (counts, i, make_int (gc_pause_counts[i]));
+  if (!NILP (reset))
+    memset (gc_pause_counts, 0, sizeof gc_pause_counts);
+  return counts;
+}
+
 DEFUN ("garbage-collect-maybe", Fgarbage_collect_maybe,
 Sgarbage_collect_maybe, 1, 1, 0,
        doc: /* Call `garbage-collect' if enough allocation happened.
@@ -6461,6 +7120,8 @@ mark_buffer (struct buffer *buffer)
 
   mark_overlay (buffer->overlays_before);
   mark_overlay (buffer->overlays_after);
+  mark_syntax_checkpoints (buffer);
+  mark_bracket_index (buffer);
 
   /* If this is an indirect buffer, mark its base buffer.  */
   if (buffer->base_buffer &&
@@ -6598,48 +7259,144 @@ mark_hash_table (struct Lisp_Vector *ptr)
     }
 }
 
+/* An entry on the mark stack: either a single object, or a range of
+   N consecutive objects that still have to be marked.  */
+struct mark_entry
+{
+  ptrdiff_t n;			/* Number of values, or 0 for one.  */
+  union
+  {
+    Lisp_Object value;		/* When N is 0.  */
+    Lisp_Object *values;	/* When N is positive.  */
+  } u;
+};
+
+/* The stack of objects that have been found reachable but whose
+   contents have not been traversed yet ("gray" objects).  Using it
+   instead of C recursion keeps mark_object from overflowing the C
+   stack on deeply nested data.  It keeps its storage between
+   collections.  */
+static struct
+{
+  struct mark_entry *stack;
+  ptrdiff_t size;		/* Allocated number of entries.  */
+  ptrdiff_t sp;			/* Number of entries in use.  */
+} mark_stk;
+
+NO_INLINE static void
+grow_mark_stack (void)
+{
+  eassert (mark_stk.sp == mark_stk.size);
+  mark_stk.stack = xpalloc (mark_stk.stack, &mark_stk.size,
+			    mark_stk.size == 0 ? 8192 : 1, -1,
+			    sizeof *mark_stk.stack);
+}
+
+/* Push OBJ onto the mark stack.  */
+
+static void
+mark_stack_push_value (Lisp_Object obj)
+{
+  if (mark_stk.sp == mark_stk.size)
+    grow_mark_stack ();
+  mark_stk.stack[mark_stk.sp++] = (struct mark_entry) { .n = 0,
+							.u.value = obj };
+}
+
+/* Push the N objects starting at OBJS onto the mark stack.  The
+   objects are read only when they are popped, so OBJS must stay
+   valid until the stack has been processed down to its current
+   depth.  */
+
+static void
+mark_stack_push_values (Lisp_Object *objs, ptrdiff_t n)
+{
+  if (n <= 0)
+    return;
+  if (mark_stk.sp == mark_stk.size)
+    grow_mark_stack ();
+  mark_stk.stack[mark_stk.sp++] = (struct mark_entry) { .n = n,
+							.u.values = objs };
+}
+
+/* Pop an object from the (nonempty) mark stack.  */
+
+static Lisp_Object
+mark_stack_pop (void)
+{
+  eassume (mark_stk.sp > 0);
+  struct mark_entry *e = &mark_stk.stack[mark_stk.sp - 1];
+  if (e->n == 0)
+    {
+      mark_stk.sp--;
+      return e->u.value;
+    }
+  if (--e->n == 0)
+    mark_stk.sp--;
+  return *e->u.values++;
+}
+
+static void process_mark_stack (ptrdiff_t);
+
 void
 mark_objects (Lisp_Object *obj, ptrdiff_t n)
 {
-  for (ptrdiff_t i = 0; i < n; i++)
-    mark_object (obj[i]);
+  ptrdiff_t sp = mark_stk.sp;
+  mark_stack_push_values (obj, n);
+  process_mark_stack (sp);
 }
 
-/* Determine type of generic Lisp_Object and mark it accordingly.
-
-   This function implements a straightforward depth-first marking
-   algorithm and so the recursion depth may be very high (a few
-   tens of thousands is not uncommon).  To minimize stack usage,
-   a few cold paths are moved out to NO_INLINE functions above.
-   In general, inlining them doesn't help you to gain more speed.  */
+/* Determine type of generic Lisp_Object and mark it accordingly.  */
 
 void
 mark_object (Lisp_Object arg)
 {
-  register Lisp_Object obj;
+  ptrdiff_t sp = mark_stk.sp;
+  mark_stack_push_value (arg);
+  process_mark_stack (sp);
+}
+
+/* Mark the objects on the mark stack, and everything reachable from
+   them, until the stack is back to depth BASE_SP.
+
+   Objects that refer to others push them on the mark stack instead
+   of marking them recursively, so the C stack depth does not depend
+   on the shape of the data.  Some pseudovectors with special layouts
+   are still handled by helper functions, which call mark_object and
+   thus start a nested traversal above the current stack depth.  */
+
+static void
+process_mark_stack (ptrdiff_t base_sp)
+{
+  Lisp_Object obj;
   void *po;
 #if GC_CHECK_MARKED_OBJECTS
   struct mem_node *m = NULL;
 #endif
-  ptrdiff_t cdr_count = 0;
-
-  obj = arg;
- loop:
+  ptrdiff_t cdr_count;
 
-  po = XPNTR (obj);
-  if (PURE_P (po))
-    return;
+  while (mark_stk.sp > base_sp)
+    {
+      obj = mark_stack_pop ();
+      /* Count the conses of each list walked from a popped entry
+	 separately, as the recursive marker did.  */
+      cdr_count = 0;
+     loop:
+
+      po = XPNTR (obj);
+      if (PURE_P (po))
+	continue;
 
-  last_marked[last_marked_index++] = obj;
-  last_marked_index &= LAST_MARKED_SIZE - 1;
+      last_marked[last_marked_index++] = obj;
+      last_marked_index &= LAST_MARKED_SIZE - 1;
 
-  /* Perform some sanity checks on the objects marked here.  Abort if
-     we encounter an object we know is bogus.  This increases GC time
-     by ~80%.  */
+      /* Perform some sanity checks on the objects marked here.  Abort if
+	 we encounter an object we know is bogus.  This increases GC time
+	 by ~80%.  */
 #if GC_CHECK_MARKED_OBJECTS
 
-  /* Check that the object pointed to by PO is known to be a Lisp
-     structure allocated from the heap.  */
+      /* Check that the object pointed to by PO is known to be a Lisp
+	 structure allocated from the heap.  */
 #define CHECK_ALLOCATED()			\
   do {						\
     if (pdumper_object_p (po))			\
@@ -6653,8 +7410,8 @@ mark_object (Lisp_Object arg)
       emacs_abort ();				\
   } while (0)
 
-  /* Check that the object pointed to by PO is live, using predicate
-     function LIVEP.  */
+      /* Check that the object pointed to by PO is live, using predicate
+	 function LIVEP.  */
 #define CHECK_LIVE(LIVEP, MEM_TYPE)		\
   do {						\
     if (pdumper_object_p (po))			\
@@ -6663,14 +7420,14 @@ mark_object (Lisp_Object arg)
       emacs_abort ();				\
   } while (0)
 
-  /* Check both of the above conditions, for non-symbols.  */
+      /* Check both of the above conditions, for non-symbols.  */
 #define CHECK_ALLOCATED_AND_LIVE(LIVEP, MEM_TYPE) \
   do {						\
     CHECK_ALLOCATED ();				\
     CHECK_LIVE (LIVEP, MEM_TYPE);		\
   } while (false)
 
-  /* Check both of the above conditions, for symbols.  */
+      /* Check both of the above conditions, for symbols.  */
 #define CHECK_ALLOCATED_AND_LIVE_SYMBOL()	\
   do {						\
     if (!c_symbol_p (ptr))			\
@@ -6687,199 +7444,211 @@ mark_object (Lisp_Object arg)
 
 #endif /* not GC_CHECK_MARKED_OBJECTS */
 
-  switch (XTYPE (obj))
-    {
-    case Lisp_String:
-      {
-	register struct Lisp_String *ptr = XSTRING (obj);
-        if (string_marked_p (ptr))
-          break;
-	CHECK_ALLOCATED_AND_LIVE (live_string_p, MEM_TYPE_STRING);
-        set_string_marked (ptr);
-        mark_interval_tree (ptr->u.s.intervals);
+      switch (XTYPE (obj))
+	{
+	case Lisp_String:
+	  {
+	    register struct Lisp_String *ptr = XSTRING (obj);
+	    if (string_marked_p (ptr))
+	      break;
+	    CHECK_ALLOCATED_AND_LIVE (live_string_p, MEM_TYPE_STRING);
+	    set_string_marked (ptr);
+	    mark_interval_tree (ptr->u.s.intervals);
 #ifdef GC_CHECK_STRING_BYTES
-	/* Check that the string size recorded in the string is the
-	   same as the one recorded in the sdata structure.  */
-	string_bytes (ptr);
+	    /* Check that the string size recorded in the string is the
+	       same as the one recorded in the sdata structure.  */
+	    string_bytes (ptr);
 #endif /* GC_CHECK_STRING_BYTES */
-      }
-      break;
+	  }
+	  break;
 
-    case Lisp_Vectorlike:
-      {
-	register struct Lisp_Vector *ptr = XVECTOR (obj);
+	case Lisp_Vectorlike:
+	  {
+	    register struct Lisp_Vector *ptr = XVECTOR (obj);
 
-	if (vector_marked_p (ptr))
-	  break;
+	    if (vector_marked_p (ptr))
+	      break;
 
-        enum pvec_type pvectype
-          = PSEUDOVECTOR_TYPE (ptr);
+	    enum pvec_type pvectype
+	      = PSEUDOVECTOR_TYPE (ptr);
 
 #ifdef GC_CHECK_MARKED_OBJECTS
-        if (!pdumper_object_p (po) && !SUBRP (obj) && !main_thread_p (po))
-          {
-	    m = mem_find (po);
-	    if (m == MEM_NIL)
-	      emacs_abort ();
-	    if (m->type == MEM_TYPE_VECTORLIKE)
-	      CHECK_LIVE (live_large_vector_p, MEM_TYPE_VECTORLIKE);
-	    else
-	      CHECK_LIVE (live_small_vector_p, MEM_TYPE_VECTOR_BLOCK);
-          }
+	    if (!pdumper_object_p (po) && !SUBRP (obj) && !main_thread_p (po))
+	      {
+		m = mem_find (po);
+		if (m == MEM_NIL)
+		  emacs_abort ();
+		if (m->type == MEM_TYPE_VECTORLIKE)
+		  CHECK_LIVE (live_large_vector_p, MEM_TYPE_VECTORLIKE);
+		else
+		  CHECK_LIVE (live_small_vector_p, MEM_TYPE_VECTOR_BLOCK);
+	      }
 #endif
 
-	switch (pvectype)
-	  {
-	  case PVEC_BUFFER:
-	    mark_buffer ((struct buffer *) ptr);
-            break;
-
-          case PVEC_COMPILED:
-            /* Although we could treat this just like a vector, mark_compiled
-               returns the COMPILED_CONSTANTS element, which is marked at the
-               next iteration of goto-loop here.  This is done to avoid a few
-               recursive calls to mark_object.  */
-            obj = mark_compiled (ptr);
-            if (!NILP (obj))
-              goto loop;
-            break;
-
-          case PVEC_FRAME:
-            mark_frame (ptr);
-            break;
-
-          case PVEC_WINDOW:
-            mark_window (ptr);
-            break;
-
-	  case PVEC_HASH_TABLE:
-            mark_hash_table (ptr);
-	    break;
-
-	  case PVEC_CHAR_TABLE:
-	  case PVEC_SUB_CHAR_TABLE:
-	    mark_char_table (ptr, (enum pvec_type) pvectype);
-	    break;
+	    switch (pvectype)
+	      {
+	      case PVEC_BUFFER:
+		mark_buffer ((struct buffer *) ptr);
+		break;
+
+	      case PVEC_COMPILED:
+		/* Although we could treat this just like a vector,
+		   mark_compiled returns the COMPILED_CONSTANTS element,
+		   which is marked at the next iteration of goto-loop
+		   here.  This is done to avoid a few recursive calls to
+		   mark_object.  */
+		obj = mark_compiled (ptr);
+		if (!NILP (obj))
+		  goto loop;
+		break;
+
+	      case PVEC_FRAME:
+		mark_frame (ptr);
+		break;
+
+	      case PVEC_WINDOW:
+		mark_window (ptr);
+		break;
+
+	      case PVEC_HASH_TABLE:
+		mark_hash_table (ptr);
+		break;
+
+	      case PVEC_CHAR_TABLE:
+	      case PVEC_SUB_CHAR_TABLE:
+		mark_char_table (ptr, (enum pvec_type) pvectype);
+		break;
+
+	      case PVEC_BOOL_VECTOR:
+		/* bool vectors in a dump are permanently "marked", since
+		   they're in the old section and don't have mark bits.
+		   If we're looking at a dumped bool vector, we should
+		   have aborted above when we called vector_marked_p, so
+		   we should never get here.  */
+		eassert (!pdumper_object_p (ptr));
+		set_vector_marked (ptr);
+		break;
 
-          case PVEC_BOOL_VECTOR:
-            /* bool vectors in a dump are permanently "marked", since
-               they're in the old section and don't have mark bits.
-               If we're looking at a dumped bool vector, we should
-               have aborted above when we called vector_marked_p, so
-               we should never get here.  */
-            eassert (!pdumper_object_p (ptr));
-            set_vector_marked (ptr);
-            break;
-
-          case PVEC_OVERLAY:
-	    mark_overlay (XOVERLAY (obj));
-	    break;
+	      case PVEC_OVERLAY:
+		mark_overlay (XOVERLAY (obj));
+		break;
 
-	  case PVEC_SUBR:
+	      case PVEC_SUBR:
 #ifdef HAVE_NATIVE_COMP
-	    if (SUBR_NATIVE_COMPILEDP (obj))
-	      {
-		set_vector_marked (ptr);
-		struct Lisp_Subr *subr = XSUBR (obj);
-		mark_object (subr->native_intspec);
-		mark_object (subr->native_comp_u);
-		mark_object (subr->lambda_list);
-		mark_object (subr->type);
-	      }
+		if (SUBR_NATIVE_COMPILEDP (obj))
+		  {
+		    set_vector_marked (ptr);
+		    struct Lisp_Subr *subr = XSUBR (obj);
+		    mark_object (subr->native_intspec);
+		    mark_object (subr->native_comp_u);
+		    mark_object (subr->lambda_list);
+		    mark_object (subr->type);
+		  }
 #endif
-	    break;
+		break;
 
-	  case PVEC_FREE:
-	    emacs_abort ();
+	      case PVEC_FREE:
+		emacs_abort ();
 
-	  default:
-	    /* A regular vector, or a pseudovector needing no special
-	       treatment.  */
-	    mark_vectorlike (&ptr->header);
+	      default:
+		/* A regular vector, or a pseudovector needing no special
+		   treatment.  */
+		{
+		  ptrdiff_t size = ptr->header.size;
+		  if (size & PSEUDOVECTOR_FLAG)
+		    size &= PSEUDOVECTOR_SIZE_MASK;
+		  set_vector_marked (ptr);
+		  mark_stack_push_values (ptr->contents, size);
+		}
+	      }
 	  }
-      }
-      break;
+	  break;
 
-    case Lisp_Symbol:
-      {
-	struct Lisp_Symbol *ptr = XSYMBOL (obj);
-      nextsym:
-        if (symbol_marked_p (ptr))
-          break;
-        CHECK_ALLOCATED_AND_LIVE_SYMBOL ();
-        set_symbol_marked (ptr);
-	/* Attempt to catch bogus objects.  */
-	eassert (valid_lisp_object_p (ptr->u.s.function));
-	mark_object (ptr->u.s.function);
-	mark_object (ptr->u.s.plist);
-	switch (ptr->u.s.redirect)
+	case Lisp_Symbol:
 	  {
-	  case SYMBOL_PLAINVAL: mark_object (SYMBOL_VAL (ptr)); break;
-	  case SYMBOL_VARALIAS:
-	    {
-	      Lisp_Object tem;
-	      XSETSYMBOL (tem, SYMBOL_ALIAS (ptr));
-	      mark_object (tem);
+	    struct Lisp_Symbol *ptr = XSYMBOL (obj);
+	  nextsym:
+	    if (symbol_marked_p (ptr))
 	      break;
-	    }
-	  case SYMBOL_LOCALIZED:
-	    mark_localized_symbol (ptr);
-	    break;
-	  case SYMBOL_FORWARDED:
-	    /* If the value is forwarded to a buffer or keyboard field,
-	       these are marked when we see the corresponding object.
-	       And if it's forwarded to a C variable, either it's not
-	       a Lisp_Object var, or it's staticpro'd already.  */
-	    break;
-	  default: emacs_abort ();
+	    CHECK_ALLOCATED_AND_LIVE_SYMBOL ();
+	    set_symbol_marked (ptr);
+	    /* Attempt to catch bogus objects.  */
+	    eassert (valid_lisp_object_p (ptr->u.s.function));
+	    mark_stack_push_value (ptr->u.s.function);
+	    mark_stack_push_value (ptr->u.s.plist);
+	    switch (ptr->u.s.redirect)
+	      {
+	      case SYMBOL_PLAINVAL:
+		mark_stack_push_value (SYMBOL_VAL (ptr));
+		break;
+	      case SYMBOL_VARALIAS:
+		{
+		  Lisp_Object tem;
+		  XSETSYMBOL (tem, SYMBOL_ALIAS (ptr));
+		  mark_stack_push_value (tem);
+		  break;
+		}
+	      case SYMBOL_LOCALIZED:
+		mark_localized_symbol (ptr);
+		break;
+	      case SYMBOL_FORWARDED:
+		/* If the value is forwarded to a buffer or keyboard field,
+		   these are marked when we see the corresponding object.
+		   And if it's forwarded to a C variable, either it's not
+		   a Lisp_Object var, or it's staticpro'd already.  */
+		break;
+	      default: emacs_abort ();
+	      }
+	    if (!PURE_P (XSTRING (ptr->u.s.name)))
+	      set_string_marked (XSTRING (ptr->u.s.name));
+	    mark_interval_tree (string_intervals (ptr->u.s.name));
+	    /* Inner loop to mark next symbol in this bucket, if any.  */
+	    po = ptr = ptr->u.s.next;
+	    if (ptr)
+	      goto nextsym;
 	  }
-	if (!PURE_P (XSTRING (ptr->u.s.name)))
-          set_string_marked (XSTRING (ptr->u.s.name));
-        mark_interval_tree (string_intervals (ptr->u.s.name));
-	/* Inner loop to mark next symbol in this bucket, if any.  */
-	po = ptr = ptr->u.s.next;
-	if (ptr)
-	  goto nextsym;
-      }
-      break;
-
-    case Lisp_Cons:
-      {
-	struct Lisp_Cons *ptr = XCONS (obj);
-	if (cons_marked_p (ptr))
 	  break;
-	CHECK_ALLOCATED_AND_LIVE (live_cons_p, MEM_TYPE_CONS);
-        set_cons_marked (ptr);
-	/* If the cdr is nil, avoid recursion for the car.  */
-	if (NILP (ptr->u.s.u.cdr))
+
+	case Lisp_Cons:
 	  {
-	    obj = ptr->u.s.car;
-	    cdr_count = 0;
+	    struct Lisp_Cons *ptr = XCONS (obj);
+	    if (cons_marked_p (ptr))
+	      break;
+	    CHECK_ALLOCATED_AND_LIVE (live_cons_p, MEM_TYPE_CONS);
+	    set_cons_marked (ptr);
+	    /* If the cdr is nil, don't bother pushing anything.  */
+	    if (NILP (ptr->u.s.u.cdr))
+	      {
+		obj = ptr->u.s.car;
+		cdr_count = 0;
+		goto loop;
+	      }
+	    /* Push the car and go on with the cdr, so that walking a long
+	       list does not grow the stack.  */
+	    mark_stack_push_value (ptr->u.s.car);
+	    obj = ptr->u.s.u.cdr;
+	    cdr_count++;
+	    if (cdr_count == mark_object_loop_halt)
+	      emacs_abort ();
 	    goto loop;
 	  }
-	mark_object (ptr->u.s.car);
-	obj = ptr->u.s.u.cdr;
-	cdr_count++;
-	if (cdr_count == mark_object_loop_halt)
-	  emacs_abort ();
-	goto loop;
-      }
 
-    case Lisp_Float:
-      CHECK_ALLOCATED_AND_LIVE (live_float_p, MEM_TYPE_FLOAT);
-      /* Do not mark floats stored in a dump image: these floats are
-         "cold" and do not have mark bits.  */
-      if (pdumper_object_p (XFLOAT (obj)))
-        eassert (pdumper_cold_object_p (XFLOAT (obj)));
-      else if (!XFLOAT_MARKED_P (XFLOAT (obj)))
-        XFLOAT_MARK (XFLOAT (obj));
-      break;
+	case Lisp_Float:
+	  CHECK_ALLOCATED_AND_LIVE (live_float_p, MEM_TYPE_FLOAT);
+	  /* Do not mark floats stored in a dump image: these floats are
+	     "cold" and do not have mark bits.  */
+	  if (pdumper_object_p (XFLOAT (obj)))
+	    eassert (pdumper_cold_object_p (XFLOAT (obj)));
+	  else if (!XFLOAT_MARKED_P (XFLOAT (obj)))
+	    XFLOAT_MARK (XFLOAT (obj));
+	  break;
 
-    case_Lisp_Int:
-      break;
+	case_Lisp_Int:
+	  break;
 
-    default:
-      emacs_abort ();
+	default:
+	  emacs_abort ();
+	}
     }
 
 #undef CHECK_LIVE
@@ -6956,6 +7725,23 @@ survives_gc_p (Lisp_Object obj)
 
 
 
+/* Conses and floats are swept lazily.  At the end of a GC,
+   sweep_conses and sweep_floats only count the marked objects and
+   release the blocks that contain nothing else, which is enough to
+   compute the statistics.  The free lists are then rebuilt one block
+   at a time by the allocators, when they run out of free objects.
+   Whatever has not been swept by the next GC is swept before it
+   starts marking, so that all mark bits are clear by then.  */
+
+static void
+finish_lazy_sweep (void)
+{
+  while (cons_sweep_cursor)
+    sweep_next_cons_block ();
+  while (float_sweep_cursor)
+    sweep_next_float_block ();
+}
+
 NO_INLINE /* For better stack traces */
 static void
 sweep_conses (void)
@@ -6963,55 +7749,25 @@ sweep_conses (void)
   struct cons_block **cprev = &cons_block;
   int lim = cons_block_index;
   object_ct num_free = 0, num_used = 0;
+  object_ct num_young = 0;
 
   cons_free_list = 0;
+  gcstat.cons_blocks = 0;
 
   for (struct cons_block *cblk; (cblk = *cprev); )
     {
-      int i = 0;
-      int this_free = 0;
+      int this_used = 0;
       int ilim = (lim + BITS_PER_BITS_WORD - 1) / BITS_PER_BITS_WORD;
 
-      /* Scan the mark bits an int at a time.  */
-      for (i = 0; i < ilim; i++)
+      for (int i = 0; i < ilim; i++)
         {
-          if (cblk->gcmarkbits[i] == BITS_WORD_MAX)
-            {
-              /* Fast path - all cons cells for this int are marked.  */
-              cblk->gcmarkbits[i] = 0;
-              num_used += BITS_PER_BITS_WORD;
-            }
-          else
-            {
-              /* Some cons cells for this int are not marked.
-                 Find which ones, and free them.  */
-              int start, pos, stop;
-
-              start = i * BITS_PER_BITS_WORD;
-              stop = lim - start;
-              if (stop > BITS_PER_BITS_WORD)
-                stop = BITS_PER_BITS_WORD;
-              stop += start;
-
-              for (pos = start; pos < stop; pos++)
-                {
-		  struct Lisp_Cons *acons = &cblk->conses[pos];
-		  if (!XCONS_MARKED_P (acons))
-                    {
-                      this_free++;
-                      cblk->conses[pos].u.s.u.chain = cons_free_list;
-                      cons_free_list = &cblk->conses[pos];
-                      cons_free_list->u.s.car = dead_object ();
-                    }
-                  else
-                    {
-                      num_used++;
-		      XUNMARK_CONS (acons);
-                    }
-                }
-            }
-        }
+	  bits_word marked = cblk->gcmarkbits[i];
+	  this_used += count_one_bits_word (marked);
+	  num_young += count_one_bits_word (cblk->gcfreebits[i] & marked);
+	  cblk->gcfreebits[i] = ~marked;
+	}
 
+      int this_free = lim - this_used;
       lim = CONS_BLOCK_SIZE;
       /* If this block contains only free conses and we have already
          seen more than two blocks worth of free conses then deallocate
@@ -7019,18 +7775,26 @@ sweep_conses (void)
       if (this_free == CONS_BLOCK_SIZE && num_free > CONS_BLOCK_SIZE)
         {
           *cprev = cblk->next;
-          /* Unhook from the free list.  */
-          cons_free_list = cblk->conses[0].u.s.u.chain;
           lisp_align_free (cblk);
         }
       else
         {
           num_free += this_free;
+          num_used += this_used;
+          gcstat.cons_blocks++;
           cprev = &cblk->next;
         }
     }
+  cons_sweep_cursor = cons_block ? &cons_block : NULL;
   gcstat.total_conses = num_used;
   gcstat.total_free_conses = num_free;
+  /* The young objects that died are those allocated since the
+     previous GC and not found live.  */
+  gcstat.young_conses = num_young;
+  gcstat.young_dead_conses
+    = max (0, (cons_cells_consed - conses_consed_at_gc
+	       - (EMACS_INT) num_young));
+  conses_consed_at_gc = cons_cells_consed;
 }
 
 NO_INLINE /* For better stack traces */
@@ -7040,27 +7804,25 @@ sweep_floats (void)
   struct float_block **fprev = &float_block;
   int lim = float_block_index;
   object_ct num_free = 0, num_used = 0;
+  object_ct num_young = 0;
 
   float_free_list = 0;
+  gcstat.float_blocks = 0;
 
   for (struct float_block *fblk; (fblk = *fprev); )
     {
-      int this_free = 0;
-      for (int i = 0; i < lim; i++)
+      int this_used = 0;
+      int ilim = (lim + BITS_PER_BITS_WORD - 1) / BITS_PER_BITS_WORD;
+
+      for (int i = 0; i < ilim; i++)
 	{
-	  struct Lisp_Float *afloat = &fblk->floats[i];
-	  if (!XFLOAT_MARKED_P (afloat))
-	    {
-	      this_free++;
-	      fblk->floats[i].u.chain = float_free_list;
-	      float_free_list = &fblk->floats[i];
-	    }
-	  else
-	    {
-	      num_used++;
-	      XFLOAT_UNMARK (afloat);
-	    }
+	  bits_word marked = fblk->gcmarkbits[i];
+	  this_used += count_one_bits_word (marked);
+	  num_young += count_one_bits_word (fblk->gcfreebits[i] & marked);
+	  fblk->gcfreebits[i] = ~marked;
 	}
+
+      int this_free = lim - this_used;
       lim = FLOAT_BLOCK_SIZE;
       /* If this block contains only free floats and we have already
          seen more than two blocks worth of free floats then deallocate
@@ -7068,18 +7830,24 @@ sweep_floats (void)
       if (this_free == FLOAT_BLOCK_SIZE && num_free > FLOAT_BLOCK_SIZE)
         {
           *fprev = fblk->next;
-          /* Unhook from the free list.  */
-          float_free_list = fblk->floats[0].u.chain;
           lisp_align_free (fblk);
         }
       else
         {
           num_free += this_free;
+          num_used += this_used;
+          gcstat.float_blocks++;
           fprev = &fblk->next;
         }
     }
+  float_sweep_cursor = float_block ? &float_block : NULL;
   gcstat.total_floats = num_used;
   gcstat.total_free_floats = num_free;
+  gcstat.young_floats = num_young;
+  gcstat.young_dead_floats
+    = max (0, (floats_consed - floats_consed_at_gc
+	       - (EMACS_INT) num_young));
+  floats_consed_at_gc = floats_consed;
 }
 
 NO_INLINE /* For better stack traces */
@@ -7091,6 +7859,7 @@ sweep_intervals (void)
   object_ct num_free = 0, num_used = 0;
 
   interval_free_list = 0;
+  gcstat.interval_blocks = 0;
 
   for (struct interval_block *iblk; (iblk = *iprev); )
     {
@@ -7124,6 +7893,7 @@ sweep_intervals (void)
       else
         {
           num_free += this_free;
+          gcstat.interval_blocks++;
           iprev = &iblk->next;
         }
     }
@@ -7141,6 +7911,7 @@ sweep_symbols (void)
   object_ct num_free = 0, num_used = ARRAYELTS (lispsym);
 
   symbol_free_list = NULL;
+  gcstat.symbol_blocks = 0;
 
   for (int i = 0; i < ARRAYELTS (lispsym); i++)
     lispsym[i].u.s.gcmarkbit = 0;
@@ -7193,6 +7964,7 @@ sweep_symbols (void)
       else
         {
           num_free += this_free;
+          gcstat.symbol_blocks++;
           sprev = &sblk->next;
         }
     }
@@ -7558,6 +8330,7 @@ void
 init_alloc (void)
 {
   Vgc_elapsed = make_float (0.0);
+  Vgc_mark_elapsed = make_float (0.0);
   gcs_done = 0;
 }
 
@@ -7645,6 +8418,7 @@ do hash-consing of the objects allocated to pure space.  */);
   DEFSYM (Qbuffers, "buffers");
   DEFSYM (Qstring_bytes, "string-bytes");
   DEFSYM (Qvector_slots, "vector-slots");
+  DEFSYM (Qstring_data, "string-data");
   DEFSYM (Qheap, "heap");
   DEFSYM (QAutomatic_GC, "Automatic GC");
 
@@ -7652,8 +8426,25 @@ do hash-consing of the objects allocated to pure space.  */);
   DEFSYM (Qgc_cons_threshold, "gc-cons-threshold");
   DEFSYM (Qchar_table_extra_slots, "char-table-extra-slots");
 
+  DEFVAR_LISP ("gc-cons-idle-fraction", Vgc_cons_idle_fraction,
+	       doc: /* Fraction of the GC threshold to collect at when idle.
+If this is a number between 0 and 1, Emacs collects garbage when it
+has been waiting for input for a tenth of a second and more than this
+fraction of the allocation that would trigger an automatic collection
+(see `gc-cons-threshold' and `gc-cons-percentage') has happened since
+the last one.  Doing so moves garbage collections out of commands and
+into idle time, where they do not delay the response to typing.
+
+Any other value means only collect when the threshold is reached.  */);
+  Vgc_cons_idle_fraction = Qnil;
+
   DEFVAR_LISP ("gc-elapsed", Vgc_elapsed,
 	       doc: /* Accumulated time elapsed in garbage collections.
+The time is in seconds as a floating point value.  */);
+  DEFVAR_LISP ("gc-mark-elapsed", Vgc_mark_elapsed,
+	       doc: /* Accumulated time spent marking live objects in garbage collections.
+This is the part of `gc-elapsed' that is spent finding which objects
+are still in use, before unused ones are freed.
 The time is in seconds as a floating point value.  */);
   DEFVAR_INT ("gcs-done", gcs_done,
               doc: /* Accumulated number of garbage collections done.  */);
@@ -7681,6 +8472,12 @@ N should be nonnegative.  */);
   defsubr (&Spurecopy);
   defsubr (&Sgarbage_collect);
   defsubr (&Sgarbage_collect_maybe);
+  defsubr (&Sgarbage_collect_generation_statistics);
+  defsubr (&Smemory_fragmentation_report);
+#ifdef HAVE_MALLOC_TRIM
+  defsubr (&Smalloc_trim);
+#endif
+  defsubr (&Sgarbage_collect_pause_histogram);
   defsubr (&Smemory_info);
   defsubr (&Smemory_use_counts);
 #if defined GNU_LINUX && defined __GLIBC__
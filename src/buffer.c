@@ -118,6 +118,9 @@ static void alloc_buffer_text (struct buffer *, ptrdiff_t);
 static void free_buffer_text (struct buffer *b);
 static struct Lisp_Overlay * copy_overlays (struct buffer *, struct Lisp_Overlay *);
 static void modify_overlay (struct buffer *, ptrdiff_t, ptrdiff_t);
+static void invalidate_overlay_index (struct buffer *);
+static void free_overlay_index (struct buffer *);
+static void free_local_var_index (struct buffer *);
 static Lisp_Object buffer_lisp_local_variables (struct buffer *, bool);
 static Lisp_Object buffer_local_variables_1 (struct buffer *buf, int offset, Lisp_Object sym);
 
@@ -601,11 +604,17 @@ even if it is dead.  The return value is never nil.  */)
   BUF_BEG_UNCHANGED (b) = 0;
   *(BUF_GPT_ADDR (b)) = *(BUF_Z_ADDR (b)) = 0; /* Put an anchor '\0'.  */
   b->text->inhibit_shrinking = false;
+  b->text->charpos_index = NULL;
+  b->text->line_index = NULL;
   b->text->redisplay = false;
 
   b->newline_cache = 0;
   b->width_run_cache = 0;
   b->bidi_paragraph_cache = 0;
+  b->syntax_checkpoints = NULL;
+  b->bracket_index = NULL;
+  b->overlay_index = NULL;
+  b->local_var_index = NULL;
   bset_width_table (b, Qnil);
   b->prevent_redisplay_optimizations_p = 1;
 
@@ -727,10 +736,12 @@ clone_per_buffer_values (struct buffer *from, struct buffer *to)
 
   set_buffer_overlays_before (to, copy_overlays (to, from->overlays_before));
   set_buffer_overlays_after (to, copy_overlays (to, from->overlays_after));
+  invalidate_overlay_index (to);
 
   /* Get (a copy of) the alist of Lisp-level local variables of FROM
      and install that in TO.  */
   bset_local_var_alist (to, buffer_lisp_local_variables (from, 1));
+  free_local_var_index (to);
 }
 
 
@@ -846,6 +857,10 @@ does not run the hooks `kill-buffer-hook',
   b->newline_cache = 0;
   b->width_run_cache = 0;
   b->bidi_paragraph_cache = 0;
+  b->syntax_checkpoints = NULL;
+  b->bracket_index = NULL;
+  b->overlay_index = NULL;
+  b->local_var_index = NULL;
   bset_width_table (b, Qnil);
 
   name = Fcopy_sequence (name);
@@ -930,6 +945,7 @@ drop_overlay (struct buffer *b, struct Lisp_Overlay *ov)
 		  marker_position (ov->end));
   unchain_marker (XMARKER (ov->start));
   unchain_marker (XMARKER (ov->end));
+  invalidate_overlay_index (b);
 
 }
 
@@ -989,6 +1005,7 @@ reset_buffer (register struct buffer *b)
   set_buffer_overlays_before (b, NULL);
   set_buffer_overlays_after (b, NULL);
   b->overlay_center = BEG;
+  invalidate_overlay_index (b);
   bset_mark_active (b, Qnil);
   bset_point_before_scroll (b, Qnil);
   bset_file_format (b, Qnil);
@@ -1102,12 +1119,18 @@ reset_buffer_local_variables (struct buffer *b, bool permanent_too)
                 }
             }
           /* Delete this local variable.  */
-          else if (NILP (last))
-            bset_local_var_alist (b, XCDR (tmp));
           else
-            XSETCDR (last, XCDR (tmp));
+            {
+              if (NILP (last))
+                bset_local_var_alist (b, XCDR (tmp));
+              else
+                XSETCDR (last, XCDR (tmp));
+              /* The watchers may have indexed the binding.  */
+              free_local_var_index (b);
+            }
         }
     }
+  free_local_var_index (b);
 
   for (i = 0; i < last_per_buffer_idx; ++i)
     if (permanent_too || buffer_permanent_local_flags[i] == 0)
@@ -1207,6 +1230,239 @@ BUFFER defaults to the current buffer.  */)
   return base ? (XSETBUFFER (buffer, base), buffer) : Qnil;
 }
 
+/* Looking up the binding of a variable in a buffer's local_var_alist
+   takes time proportional to the number of local variables, and it is
+   done whenever a variable is referenced in a buffer other than the
+   one whose binding was loaded last.  For buffers with many local
+   variables, the alist is mirrored by an open-addressing hash table
+   from symbols to their bindings, built by the first lookup that has
+   to look past LOCAL_VAR_INDEX_MIN bindings.  add_buffer_local_binding
+   and remove_buffer_local_binding keep the index up to date; any other
+   change to the alist must discard it with free_local_var_index.
+   Every binding in the index is also in the alist, so the garbage
+   collector need not know about it.
+
+   The index also lists the variables whose values forward into C
+   variables, which set_buffer_internal_2 has to load.  */
+
+struct local_var_index
+{
+  /* The table has 2**BITS slots, COUNT of which hold bindings.  The
+     others are nil.  */
+  int bits;
+  ptrdiff_t count;
+  Lisp_Object *bindings;
+
+  /* The NFORWARDED symbols among them whose values forward into C
+     variables, in a vector of FORWARDED_SIZE entries.  */
+  ptrdiff_t nforwarded, forwarded_size;
+  Lisp_Object *forwarded;
+};
+
+enum { LOCAL_VAR_INDEX_MIN = 16, LOCAL_VAR_INDEX_MIN_BITS = 6 };
+
+static void
+free_local_var_index (struct buffer *b)
+{
+  struct local_var_index *index = b->local_var_index;
+  if (index)
+    {
+      xfree (index->bindings);
+      xfree (index->forwarded);
+      xfree (index);
+      b->local_var_index = NULL;
+    }
+}
+
+/* Return the slot where the lookup of SYMBOL in INDEX starts.  */
+
+static ptrdiff_t
+local_var_home (struct local_var_index *index, Lisp_Object symbol)
+{
+  /* Symbols are aligned, so drop the low bits before multiplying by
+     2**32 divided by the golden ratio.  */
+  uint32_t hash = (uint32_t) ((EMACS_UINT) XHASH (symbol) >> 3) * 2654435769u;
+  return hash >> (32 - index->bits);
+}
+
+/* Return the slot of INDEX holding the binding of SYMBOL, or the
+   empty slot where it would go.  */
+
+static ptrdiff_t
+local_var_slot (struct local_var_index *index, Lisp_Object symbol)
+{
+  ptrdiff_t mask = ((ptrdiff_t) 1 << index->bits) - 1;
+  ptrdiff_t i = local_var_home (index, symbol);
+  while (! (NILP (index->bindings[i])
+	    || EQ (XCAR (index->bindings[i]), symbol)))
+    i = (i + 1) & mask;
+  return i;
+}
+
+static bool
+forwarded_local_p (Lisp_Object symbol)
+{
+  struct Lisp_Symbol *sym = XSYMBOL (symbol);
+  return (sym->u.s.redirect == SYMBOL_LOCALIZED
+	  && SYMBOL_BLV (sym)->fwd.fwdptr);
+}
+
+/* Give INDEX 2**BITS slots and put BINDINGS, a vector of N bindings
+   or nil, into them.  */
+
+static void
+fill_local_var_index (struct local_var_index *index, int bits,
+		      Lisp_Object *bindings, ptrdiff_t n)
+{
+  ptrdiff_t size = (ptrdiff_t) 1 << bits;
+  index->bits = bits;
+  index->bindings = xnmalloc (size, sizeof *index->bindings);
+  memclear (index->bindings, size * sizeof *index->bindings);
+  for (ptrdiff_t i = 0; i < n; i++)
+    if (!NILP (bindings[i]))
+      index->bindings[local_var_slot (index, XCAR (bindings[i]))]
+	= bindings[i];
+}
+
+/* Add BINDING to INDEX, unless its variable is already there.  */
+
+static void
+index_local_binding (struct local_var_index *index, Lisp_Object binding)
+{
+  Lisp_Object symbol = XCAR (binding);
+  ptrdiff_t i = local_var_slot (index, symbol);
+  if (!NILP (index->bindings[i]))
+    return;
+  index->bindings[i] = binding;
+  index->count++;
+
+  if (forwarded_local_p (symbol))
+    {
+      if (index->nforwarded == index->forwarded_size)
+	index->forwarded = xpalloc (index->forwarded, &index->forwarded_size,
+				    1, -1, sizeof *index->forwarded);
+      index->forwarded[index->nforwarded++] = symbol;
+    }
+
+  /* Keep the table at most half full.  */
+  if (index->count > (ptrdiff_t) 1 << (index->bits - 1))
+    {
+      Lisp_Object *old = index->bindings;
+      fill_local_var_index (index, index->bits + 1, old,
+			    (ptrdiff_t) 1 << index->bits);
+      xfree (old);
+    }
+}
+
+/* Remove the binding of SYMBOL from INDEX, if it is there.  */
+
+static void
+unindex_local_binding (struct local_var_index *index, Lisp_Object symbol)
+{
+  ptrdiff_t mask = ((ptrdiff_t) 1 << index->bits) - 1;
+  ptrdiff_t i = local_var_slot (index, symbol);
+  if (NILP (index->bindings[i]))
+    return;
+  index->count--;
+
+  if (forwarded_local_p (symbol))
+    for (ptrdiff_t j = 0; j < index->nforwarded; j++)
+      if (EQ (index->forwarded[j], symbol))
+	{
+	  index->forwarded[j] = index->forwarded[--index->nforwarded];
+	  break;
+	}
+
+  /* Close the gap at I by moving back each following binding whose
+     lookup starts at or before I.  */
+  for (ptrdiff_t j = (i + 1) & mask;
+       !NILP (index->bindings[j]);
+       j = (j + 1) & mask)
+    {
+      ptrdiff_t home = local_var_home (index, XCAR (index->bindings[j]));
+      if (i <= j ? home <= i || j < home : home <= i && j < home)
+	{
+	  index->bindings[i] = index->bindings[j];
+	  i = j;
+	}
+    }
+  index->bindings[i] = Qnil;
+}
+
+static struct local_var_index *
+make_local_var_index (struct buffer *b)
+{
+  ptrdiff_t n = 0;
+  Lisp_Object tail;
+  for (tail = BVAR (b, local_var_alist); CONSP (tail); tail = XCDR (tail))
+    n++;
+
+  int bits = LOCAL_VAR_INDEX_MIN_BITS;
+  while (((ptrdiff_t) 1 << bits) < 2 * n)
+    bits++;
+  struct local_var_index *index = xzalloc (sizeof *index);
+  fill_local_var_index (index, bits, NULL, 0);
+  for (tail = BVAR (b, local_var_alist); CONSP (tail); tail = XCDR (tail))
+    index_local_binding (index, XCAR (tail));
+  return b->local_var_index = index;
+}
+
+/* Return the binding of SYMBOL in the local_var_alist of buffer B, or
+   nil if it has none.  */
+
+Lisp_Object
+buffer_local_binding (struct buffer *b, Lisp_Object symbol)
+{
+  struct local_var_index *index = b->local_var_index;
+  if (!index)
+    {
+      int n = 0;
+      Lisp_Object tail;
+      for (tail = BVAR (b, local_var_alist); CONSP (tail); tail = XCDR (tail))
+	{
+	  if (EQ (XCAR (XCAR (tail)), symbol))
+	    return XCAR (tail);
+	  if (++n == LOCAL_VAR_INDEX_MIN)
+	    break;
+	}
+      if (!CONSP (tail))
+	return Qnil;
+      index = make_local_var_index (b);
+    }
+  return index->bindings[local_var_slot (index, symbol)];
+}
+
+/* Add BINDING, a cons (SYMBOL . VALUE), to the local variables of
+   buffer B, which must not have a binding for SYMBOL yet.  */
+
+void
+add_buffer_local_binding (struct buffer *b, Lisp_Object binding)
+{
+  bset_local_var_alist (b, Fcons (binding, BVAR (b, local_var_alist)));
+  if (b->local_var_index)
+    index_local_binding (b->local_var_index, binding);
+}
+
+/* Remove BINDING from the local variables of buffer B.  */
+
+void
+remove_buffer_local_binding (struct buffer *b, Lisp_Object binding)
+{
+  Lisp_Object tail, prev = Qnil;
+  for (tail = BVAR (b, local_var_alist); CONSP (tail);
+       prev = tail, tail = XCDR (tail))
+    if (EQ (XCAR (tail), binding))
+      {
+	if (NILP (prev))
+	  bset_local_var_alist (b, XCDR (tail));
+	else
+	  XSETCDR (prev, XCDR (tail));
+	break;
+      }
+  if (b->local_var_index)
+    unindex_local_binding (b->local_var_index, XCAR (binding));
+}
+
 DEFUN ("buffer-local-value", Fbuffer_local_value,
        Sbuffer_local_value, 2, 2, 0,
        doc: /* Return the value of VARIABLE in BUFFER.
@@ -1247,7 +1503,7 @@ buffer_local_value (Lisp_Object variable, Lisp_Object buffer)
       { /* Look in local_var_alist.  */
 	struct Lisp_Buffer_Local_Value *blv = SYMBOL_BLV (sym);
 	XSETSYMBOL (variable, sym); /* Update In case of aliasing.  */
-	result = Fassoc (variable, BVAR (buf, local_var_alist), Qnil);
+	result = buffer_local_binding (buf, variable);
 	if (!NILP (result))
 	  {
 	    if (blv->fwd.fwdptr)
@@ -1997,6 +2253,10 @@ cleaning up all windows currently displaying the buffer to be killed. */)
       free_region_cache (b->bidi_paragraph_cache);
       b->bidi_paragraph_cache = 0;
     }
+  free_syntax_checkpoints (b);
+  free_bracket_index (b);
+  free_overlay_index (b);
+  free_local_var_index (b);
   bset_width_table (b, Qnil);
   unblock_input ();
 
@@ -2192,16 +2452,22 @@ void set_buffer_internal_2 (register struct buffer *b)
 
   do
     {
-      for (tail = BVAR (b, local_var_alist); CONSP (tail); tail = XCDR (tail))
-	{
-	  Lisp_Object var = XCAR (XCAR (tail));
-	  struct Lisp_Symbol *sym = XSYMBOL (var);
-	  if (sym->u.s.redirect == SYMBOL_LOCALIZED /* Just to be sure.  */
-	      && SYMBOL_BLV (sym)->fwd.fwdptr)
-	    /* Just reference the variable
-	       to cause it to become set for this buffer.  */
-	    Fsymbol_value (var);
-	}
+      struct local_var_index *index = b->local_var_index;
+      if (index)
+	/* The index lists just the variables we want.  */
+	for (ptrdiff_t i = 0; i < index->nforwarded; i++)
+	  Fsymbol_value (index->forwarded[i]);
+      else
+	for (tail = BVAR (b, local_var_alist); CONSP (tail); tail = XCDR (tail))
+	  {
+	    Lisp_Object var = XCAR (XCAR (tail));
+	    struct Lisp_Symbol *sym = XSYMBOL (var);
+	    if (sym->u.s.redirect == SYMBOL_LOCALIZED /* Just to be sure.  */
+		&& SYMBOL_BLV (sym)->fwd.fwdptr)
+	      /* Just reference the variable
+		 to cause it to become set for this buffer.  */
+	      Fsymbol_value (var);
+	  }
     }
   /* Do the same with any others that were local to the previous buffer */
   while (b != old_buf && (b = old_buf, b));
@@ -2423,11 +2689,17 @@ results, see Info node `(elisp)Swapping Text'.  */)
   swapfield (newline_cache, struct region_cache *);
   swapfield (width_run_cache, struct region_cache *);
   swapfield (bidi_paragraph_cache, struct region_cache *);
+  free_syntax_checkpoints (current_buffer);
+  free_syntax_checkpoints (other_buffer);
+  free_bracket_index (current_buffer);
+  free_bracket_index (other_buffer);
   current_buffer->prevent_redisplay_optimizations_p = 1;
   other_buffer->prevent_redisplay_optimizations_p = 1;
   swapfield (overlays_before, struct Lisp_Overlay *);
   swapfield (overlays_after, struct Lisp_Overlay *);
   swapfield (overlay_center, ptrdiff_t);
+  invalidate_overlay_index (current_buffer);
+  invalidate_overlay_index (other_buffer);
   swapfield_ (undo_list, Lisp_Object);
   swapfield_ (mark, Lisp_Object);
   swapfield_ (mark_active, Lisp_Object); /* Belongs with the `mark'.  */
@@ -2551,6 +2823,8 @@ current buffer is cleared.  */)
 
   /* If the cached position is for this buffer, clear it out.  */
   clear_charpos_cache (current_buffer);
+  invalidate_text_indexes (current_buffer, BEG_BYTE);
+  invalidate_syntax_checkpoints (current_buffer, BEG);
 
   if (NILP (flag))
     begv = BEGV_BYTE, zv = ZV_BYTE;
@@ -2750,6 +3024,7 @@ current buffer is cleared.  */)
 	emacs_abort ();
 
       BUF_MARKERS (current_buffer) = markers;
+      invalidate_text_indexes (current_buffer, BEG_BYTE);
 
       /* Do this last, so it can calculate the new correspondences
 	 between chars and bytes.  */
@@ -2785,8 +3060,10 @@ current buffer is cleared.  */)
 	  BVAR (o, enable_multibyte_characters)
 	    = BVAR (current_buffer, enable_multibyte_characters);
 	  o->prevent_redisplay_optimizations_p = true;
+	  invalidate_overlay_index (o);
 	}
     }
+  invalidate_overlay_index (current_buffer);
 
   /* Restore the modifiedness of the buffer.  */
   if (!modified_p && !NILP (Fbuffer_modified_p (Qnil)))
@@ -2836,6 +3113,292 @@ the normal hook `change-major-mode-hook'.  */)
   return Qnil;
 }
 
+
+/* Looking up overlays by scanning the overlay lists takes time
+   proportional to the number of overlays between the position looked
+   up and the overlay center.  When lookups wander far from the center
+   of a buffer with many overlays, as when scrolling through it, the
+   scans are replaced by an index of the overlays sorted by their
+   start position.  The index doubles as an interval tree: the entries
+   between LO and HI form a balanced subtree rooted at the middle one,
+   which records the largest end position in the subtree.
+
+   The index is built once the list scans done since the overlays last
+   changed have examined more entries than building it would, and is
+   discarded whenever the overlays or the text change.  */
+
+struct overlay_index_entry
+{
+  ptrdiff_t start, end;
+
+  /* The largest end position in the subtree rooted at this entry.  */
+  ptrdiff_t maxend;
+
+  struct Lisp_Overlay *overlay;
+};
+
+struct overlay_index
+{
+  /* BUF_CHARS_MODIFF and BUF_Z of the buffer when WORK was last reset.
+     Insertions and deletions move overlays without touching the
+     overlay lists of the other buffers sharing the text, so they are
+     noticed through these.  */
+  modiff_count chars_modiff;
+  ptrdiff_t z;
+
+  /* True if ENTRIES and BOUNDS describe the current overlays.  */
+  bool valid;
+
+  /* The number of overlay list entries scanned since WORK was reset.  */
+  ptrdiff_t work;
+
+  /* The number of overlays, and the number of entries allocated.  */
+  ptrdiff_t n, size;
+
+  /* The overlays, sorted by start position.  */
+  struct overlay_index_entry *entries;
+
+  /* The start and end positions of the overlays, sorted.  */
+  ptrdiff_t *bounds;
+};
+
+/* Build the index once the list scans have examined this many times
+   as many entries as there are overlays, but no fewer than
+   OVERLAY_INDEX_MIN_WORK.  */
+
+enum { OVERLAY_INDEX_WORK_FACTOR = 4, OVERLAY_INDEX_MIN_WORK = 1024 };
+
+/* Note that the overlays of B have changed.  */
+
+static void
+invalidate_overlay_index (struct buffer *b)
+{
+  struct overlay_index *index = b->overlay_index;
+  if (index)
+    {
+      index->valid = false;
+      index->work = 0;
+    }
+}
+
+static void
+free_overlay_index (struct buffer *b)
+{
+  struct overlay_index *index = b->overlay_index;
+  if (index)
+    {
+      xfree (index->entries);
+      xfree (index->bounds);
+      xfree (index);
+      b->overlay_index = NULL;
+    }
+}
+
+/* Record that a scan of the overlay lists of B examined WORK entries.  */
+
+static void
+note_overlay_scan (struct buffer *b, ptrdiff_t work)
+{
+  struct overlay_index *index = b->overlay_index;
+  if (!index)
+    {
+      /* Don't bother with buffers whose overlays are cheap to scan.  */
+      if (work < 16)
+	return;
+      index = b->overlay_index = xzalloc (sizeof *index);
+      index->chars_modiff = BUF_CHARS_MODIFF (b);
+      index->z = BUF_Z (b);
+    }
+  index->work += work;
+}
+
+static int
+compare_overlay_index_entries (const void *v1, const void *v2)
+{
+  const struct overlay_index_entry *e1 = v1;
+  const struct overlay_index_entry *e2 = v2;
+  return (e1->start > e2->start) - (e1->start < e2->start);
+}
+
+static int
+compare_positions (const void *v1, const void *v2)
+{
+  ptrdiff_t p1 = *(const ptrdiff_t *) v1;
+  ptrdiff_t p2 = *(const ptrdiff_t *) v2;
+  return (p1 > p2) - (p1 < p2);
+}
+
+/* Set the MAXEND fields of the subtree of ENTRIES between LO and HI,
+   and return the largest end position in it.  */
+
+static ptrdiff_t
+set_overlay_index_maxend (struct overlay_index_entry *entries,
+			  ptrdiff_t lo, ptrdiff_t hi)
+{
+  if (lo == hi)
+    return PTRDIFF_MIN;
+  ptrdiff_t mid = lo + (hi - lo) / 2;
+  ptrdiff_t left = set_overlay_index_maxend (entries, lo, mid);
+  ptrdiff_t right = set_overlay_index_maxend (entries, mid + 1, hi);
+  ptrdiff_t maxend = max (entries[mid].end, max (left, right));
+  entries[mid].maxend = maxend;
+  return maxend;
+}
+
+static void
+build_overlay_index (struct buffer *b, struct overlay_index *index)
+{
+  ptrdiff_t n = 0;
+  for (struct Lisp_Overlay *ov = b->overlays_before; ov; ov = ov->next)
+    n++;
+  for (struct Lisp_Overlay *ov = b->overlays_after; ov; ov = ov->next)
+    n++;
+
+  if (index->size < n)
+    {
+      xfree (index->entries);
+      xfree (index->bounds);
+      index->entries = NULL;
+      index->bounds = NULL;
+      index->size = 0;
+      index->entries = xnmalloc (n, sizeof *index->entries);
+      index->bounds = xnmalloc (n, 2 * sizeof *index->bounds);
+      index->size = n;
+    }
+
+  struct overlay_index_entry *e = index->entries;
+  ptrdiff_t *bound = index->bounds;
+  for (int i = 0; i < 2; i++)
+    for (struct Lisp_Overlay *ov = i ? b->overlays_after : b->overlays_before;
+	 ov; ov = ov->next, e++)
+      {
+	e->start = *bound++ = OVERLAY_POSITION (ov->start);
+	e->end = *bound++ = OVERLAY_POSITION (ov->end);
+	e->overlay = ov;
+      }
+
+  qsort (index->entries, n, sizeof *index->entries,
+	 compare_overlay_index_entries);
+  qsort (index->bounds, 2 * n, sizeof *index->bounds, compare_positions);
+  set_overlay_index_maxend (index->entries, 0, n);
+  index->n = n;
+  index->valid = true;
+}
+
+/* Return the overlay index of B if looking up overlays in it is
+   worthwhile, building it if necessary.  Otherwise, return NULL.  */
+
+static struct overlay_index *
+buffer_overlay_index (struct buffer *b)
+{
+  struct overlay_index *index = b->overlay_index;
+  if (!index)
+    return NULL;
+  if (index->chars_modiff != BUF_CHARS_MODIFF (b) || index->z != BUF_Z (b))
+    {
+      index->chars_modiff = BUF_CHARS_MODIFF (b);
+      index->z = BUF_Z (b);
+      invalidate_overlay_index (b);
+      return NULL;
+    }
+  if (!index->valid)
+    {
+      if (index->work < max (OVERLAY_INDEX_MIN_WORK,
+			     OVERLAY_INDEX_WORK_FACTOR * index->n))
+	return NULL;
+      build_overlay_index (b, index);
+    }
+  return index;
+}
+
+/* Return the number of overlays in INDEX that start at or before POS.  */
+
+static ptrdiff_t
+overlay_index_starts_upto (struct overlay_index *index, ptrdiff_t pos)
+{
+  ptrdiff_t lo = 0, hi = index->n;
+  while (lo < hi)
+    {
+      ptrdiff_t mid = lo + (hi - lo) / 2;
+      if (index->entries[mid].start <= pos)
+	lo = mid + 1;
+      else
+	hi = mid;
+    }
+  return lo;
+}
+
+/* Return the number of overlay boundaries in INDEX before POS.  */
+
+static ptrdiff_t
+overlay_index_bounds_before (struct overlay_index *index, ptrdiff_t pos)
+{
+  ptrdiff_t lo = 0, hi = 2 * index->n;
+  while (lo < hi)
+    {
+      ptrdiff_t mid = lo + (hi - lo) / 2;
+      if (index->bounds[mid] < pos)
+	lo = mid + 1;
+      else
+	hi = mid;
+    }
+  return lo;
+}
+
+/* A search of an overlay index, for overlays_at or overlays_in.  */
+
+struct overlay_search
+{
+  /* The overlays sought are those overlapping BEG through END, as in
+     overlays_in, with END_IS_Z telling whether END is ZV.  If AT, they
+     are instead those containing the character at BEG, which equals
+     END, as in overlays_at.  */
+  ptrdiff_t beg, end;
+  bool at, end_is_Z;
+
+  /* Where to put the overlays found, as in overlays_at.  IDX counts
+     the overlays found, including those that did not fit.  */
+  bool extend;
+  Lisp_Object **vec_ptr;
+  ptrdiff_t *len_ptr;
+  ptrdiff_t idx;
+};
+
+static void
+search_overlay_index (struct overlay_index_entry *entries,
+		      ptrdiff_t lo, ptrdiff_t hi, struct overlay_search *s)
+{
+  while (lo < hi)
+    {
+      ptrdiff_t mid = lo + (hi - lo) / 2;
+      struct overlay_index_entry *e = &entries[mid];
+
+      /* Nothing in this subtree extends as far as BEG.  */
+      if (e->maxend < s->beg)
+	return;
+      search_overlay_index (entries, lo, mid, s);
+
+      /* Neither this overlay nor any after it starts by END.  */
+      if (s->end < e->start)
+	return;
+      if (s->at
+	  ? s->beg < e->end
+	  : ((s->beg < e->end && e->start < s->end)
+	     || (e->start == e->end
+		 && (s->beg == e->end || (s->end_is_Z && e->end == s->end)))))
+	{
+	  if (s->idx == *s->len_ptr && s->extend)
+	    *s->vec_ptr = xpalloc (*s->vec_ptr, s->len_ptr, 1,
+				   OVERLAY_COUNT_MAX, sizeof **s->vec_ptr);
+	  if (s->idx < *s->len_ptr)
+	    (*s->vec_ptr)[s->idx] = make_lisp_ptr (e->overlay,
+						   Lisp_Vectorlike);
+	  s->idx++;
+	}
+      lo = mid + 1;
+    }
+}
+
 
 /* Find all the overlays in the current buffer that contain position POS.
    Return the number found, and store them in a vector in *VEC_PTR.
@@ -2870,6 +3433,37 @@ overlays_at (EMACS_INT pos, bool extend, Lisp_Object **vec_ptr,
   ptrdiff_t next = ZV;
   ptrdiff_t prev = BEGV;
   bool inhibit_storing = 0;
+  ptrdiff_t scanned = 0;
+
+  /* The index doesn't reproduce the quirks of the list scan below
+     that CHANGE_REQ is there to avoid.  */
+  struct overlay_index *index = buffer_overlay_index (current_buffer);
+  if (index && (change_req || !prev_ptr))
+    {
+      struct overlay_search s = { .beg = pos, .end = pos, .at = true,
+				  .extend = extend, .vec_ptr = vec_ptr,
+				  .len_ptr = len_ptr };
+      search_overlay_index (index->entries, 0, index->n, &s);
+      if (next_ptr)
+	{
+	  /* The next overlay start after POS.  */
+	  ptrdiff_t i = overlay_index_starts_upto (index, pos);
+	  if (i < index->n && index->entries[i].start < next)
+	    next = index->entries[i].start;
+	  *next_ptr = next;
+	}
+      if (prev_ptr)
+	{
+	  /* An overlay starting before POS counts either by its start,
+	     or, if it ends before POS, by its end, which is nearer.  So
+	     the previous change is the nearest boundary before POS.  */
+	  ptrdiff_t i = overlay_index_bounds_before (index, pos);
+	  if (i > 0 && prev < index->bounds[i - 1])
+	    prev = index->bounds[i - 1];
+	  *prev_ptr = prev;
+	}
+      return s.idx;
+    }
 
   for (struct Lisp_Overlay *tail = current_buffer->overlays_before;
        tail; tail = tail->next)
@@ -2878,6 +3472,7 @@ overlays_at (EMACS_INT pos, bool extend, Lisp_Object **vec_ptr,
       Lisp_Object start = OVERLAY_START (overlay);
       Lisp_Object end = OVERLAY_END (overlay);
       ptrdiff_t endpos = OVERLAY_POSITION (end);
+      scanned++;
       if (endpos < pos)
 	{
 	  if (prev < endpos)
@@ -2924,6 +3519,7 @@ overlays_at (EMACS_INT pos, bool extend, Lisp_Object **vec_ptr,
       Lisp_Object start = OVERLAY_START (overlay);
       Lisp_Object end = OVERLAY_END (overlay);
       ptrdiff_t startpos = OVERLAY_POSITION (start);
+      scanned++;
       if (pos < startpos)
 	{
 	  if (startpos < next)
@@ -2960,6 +3556,7 @@ overlays_at (EMACS_INT pos, bool extend, Lisp_Object **vec_ptr,
 	prev = startpos;
     }
 
+  note_overlay_scan (current_buffer, scanned);
   if (next_ptr)
     *next_ptr = next;
   if (prev_ptr)
@@ -2999,6 +3596,17 @@ overlays_in (EMACS_INT beg, EMACS_INT end, bool extend,
   ptrdiff_t prev = BEGV;
   bool inhibit_storing = 0;
   bool end_is_Z = end == ZV;
+  ptrdiff_t scanned = 0;
+
+  struct overlay_index *index = buffer_overlay_index (current_buffer);
+  if (index && !next_ptr && !prev_ptr)
+    {
+      struct overlay_search s = { .beg = beg, .end = end,
+				  .end_is_Z = end_is_Z, .extend = extend,
+				  .vec_ptr = vec_ptr, .len_ptr = len_ptr };
+      search_overlay_index (index->entries, 0, index->n, &s);
+      return s.idx;
+    }
 
   for (struct Lisp_Overlay *tail = current_buffer->overlays_before;
        tail; tail = tail->next)
@@ -3007,6 +3615,7 @@ overlays_in (EMACS_INT beg, EMACS_INT end, bool extend,
       Lisp_Object ostart = OVERLAY_START (overlay);
       Lisp_Object oend = OVERLAY_END (overlay);
       ptrdiff_t endpos = OVERLAY_POSITION (oend);
+      scanned++;
       if (endpos < beg)
 	{
 	  if (prev < endpos)
@@ -3052,6 +3661,7 @@ overlays_in (EMACS_INT beg, EMACS_INT end, bool extend,
       Lisp_Object ostart = OVERLAY_START (overlay);
       Lisp_Object oend = OVERLAY_END (overlay);
       ptrdiff_t startpos = OVERLAY_POSITION (ostart);
+      scanned++;
       if (end < startpos)
 	{
 	  if (startpos < next)
@@ -3087,6 +3697,7 @@ overlays_in (EMACS_INT beg, EMACS_INT end, bool extend,
 	prev = endpos;
     }
 
+  note_overlay_scan (current_buffer, scanned);
   if (next_ptr)
     *next_ptr = next;
   if (prev_ptr)
@@ -3160,32 +3771,46 @@ disable_line_numbers_overlay_at_eob (void)
 bool
 overlay_touches_p (ptrdiff_t pos)
 {
+  ptrdiff_t scanned = 0;
+  bool found = false;
+
+  struct overlay_index *index = buffer_overlay_index (current_buffer);
+  if (index)
+    {
+      ptrdiff_t i = overlay_index_bounds_before (index, pos);
+      return i < 2 * index->n && index->bounds[i] == pos;
+    }
+
   for (struct Lisp_Overlay *tail = current_buffer->overlays_before;
-       tail; tail = tail->next)
+       tail && !found; tail = tail->next)
     {
       Lisp_Object overlay = make_lisp_ptr (tail, Lisp_Vectorlike);
       eassert (OVERLAYP (overlay));
 
       ptrdiff_t endpos = OVERLAY_POSITION (OVERLAY_END (overlay));
+      scanned++;
       if (endpos < pos)
 	break;
       if (endpos == pos || OVERLAY_POSITION (OVERLAY_START (overlay)) == pos)
-	return 1;
+	found = true;
     }
 
   for (struct Lisp_Overlay *tail = current_buffer->overlays_after;
-       tail; tail = tail->next)
+       tail && !found; tail = tail->next)
     {
       Lisp_Object overlay = make_lisp_ptr (tail, Lisp_Vectorlike);
       eassert (OVERLAYP (overlay));
 
       ptrdiff_t startpos = OVERLAY_POSITION (OVERLAY_START (overlay));
+      scanned++;
       if (pos < startpos)
 	break;
       if (startpos == pos || OVERLAY_POSITION (OVERLAY_END (overlay)) == pos)
-	return 1;
+	found = true;
     }
-  return 0;
+
+  note_overlay_scan (current_buffer, scanned);
+  return found;
 }
 
 struct sortvec
@@ -3635,6 +4260,8 @@ recenter_overlay_lists (struct buffer *buf, ptrdiff_t pos)
 void
 adjust_overlays_for_insert (ptrdiff_t pos, ptrdiff_t length)
 {
+  invalidate_overlay_index (current_buffer);
+
   /* After an insertion, the lists are still sorted properly,
      but we may need to update the value of the overlay center.  */
   if (current_buffer->overlay_center >= pos)
@@ -3644,6 +4271,8 @@ adjust_overlays_for_insert (ptrdiff_t pos, ptrdiff_t length)
 void
 adjust_overlays_for_delete (ptrdiff_t pos, ptrdiff_t length)
 {
+  invalidate_overlay_index (current_buffer);
+
   if (current_buffer->overlay_center < pos)
     /* The deletion was to our right.  No change needed; the before- and
        after-lists are still consistent.  */
@@ -3798,6 +4427,7 @@ fix_start_end_in_overlays (register ptrdiff_t start, register ptrdiff_t end)
       set_buffer_overlays_after (current_buffer, after_list);
     }
   recenter_overlay_lists (current_buffer, current_buffer->overlay_center);
+  invalidate_overlay_index (current_buffer);
 }
 
 /* We have two types of overlay: the one whose ending marker is
@@ -3945,6 +4575,7 @@ for the rear of the overlay advance when text is inserted there
     XMARKER (end)->insertion_type = 1;
 
   overlay = build_overlay (beg, end, Qnil);
+  invalidate_overlay_index (b);
 
   /* Put the new overlay on the wrong list.  */
   end = OVERLAY_END (overlay);
@@ -4015,6 +4646,7 @@ unchain_both (struct buffer *b, Lisp_Object overlay)
   set_buffer_overlays_before (b, unchain_overlay (b->overlays_before, ov));
   set_buffer_overlays_after (b, unchain_overlay (b->overlays_after, ov));
   eassert (XOVERLAY (overlay)->next == NULL);
+  invalidate_overlay_index (b);
 }
 
 DEFUN ("move-overlay", Fmove_overlay, Smove_overlay, 3, 4, 0,
@@ -4124,6 +4756,7 @@ buffer.  */)
 
   /* Put the overlay into the new buffer's overlay lists, first on the
      wrong list.  */
+  invalidate_overlay_index (b);
   if (n_end < b->overlay_center)
     {
       XOVERLAY (overlay)->next = b->overlays_after;
@@ -5139,6 +5772,7 @@ free_buffer_text (struct buffer *b)
     }
 
   BUF_BEG_ADDR (b) = NULL;
+  free_text_indexes (b);
   unblock_input ();
 }
 
@@ -218,6 +218,59 @@ extern ptrdiff_t advance_to_char_boundary (ptrdiff_t byte_pos);
 
 #define FETCH_BYTE(n) *(BYTE_POS_ADDR ((n)))
 
+/* A text index records, at checkpoints spaced about a fixed number of
+   bytes apart in a large buffer, how many characters or lines precede
+   each checkpoint, so that finding a position seldom scans more than
+   that many bytes.  The checkpoints are computed on demand, and like
+   markers they are relocated when text is inserted or deleted.  See
+   marker.c.  */
+
+struct text_index_kind
+{
+  /* The number of bytes between checkpoints.  */
+  ptrdiff_t interval;
+
+  /* The count at BEG.  */
+  ptrdiff_t beg_count;
+
+  /* Return the count of a buffer's text between two byte positions.  */
+  ptrdiff_t (*count) (struct buffer *, ptrdiff_t, ptrdiff_t);
+
+  /* True if checkpoints must be at the start of a character.  */
+  bool char_heads;
+};
+
+struct text_checkpoint
+{
+  /* A byte position, and the count of the text before it.  */
+  ptrdiff_t bytepos, count;
+};
+
+struct text_index
+{
+  struct text_index_kind const *kind;
+
+  /* BUF_Z_BYTE of the text the checkpoints describe.  If the text
+     changes without the checkpoints being adjusted, this no longer
+     matches and the checkpoints are discarded.  */
+  ptrdiff_t z_byte;
+
+  /* The number of checkpoints, and the number allocated.  */
+  ptrdiff_t used, size;
+
+  /* The checkpoints, in increasing order.  The first is at BEG.  */
+  struct text_checkpoint *checkpoints;
+};
+
+extern struct text_index *text_index_get (struct buffer *,
+					  struct text_index **,
+					  struct text_index_kind const *);
+extern ptrdiff_t text_index_upto (struct text_index *, ptrdiff_t);
+extern ptrdiff_t text_index_upto_count (struct text_index *, ptrdiff_t);
+extern bool text_index_split (struct buffer *, struct text_index *,
+			      ptrdiff_t);
+extern void text_index_invalidate (struct text_index *, ptrdiff_t);
+
 /* Define the actual buffer data structures.  */
 
 /* This data structure describes the actual text contents of a buffer.
@@ -279,6 +332,14 @@ struct buffer_text
        to move a marker within a buffer.  */
     struct Lisp_Marker *markers;
 
+    /* Checkpoints relating character and byte positions in the text,
+       or NULL.  See marker.c.  */
+    struct text_index *charpos_index;
+
+    /* Checkpoints counting the newlines in the text, or NULL.  See
+       search.c.  */
+    struct text_index *line_index;
+
     /* Usually false.  Temporarily true in decode_coding_gap to
        prevent Fgarbage_collect from shrinking the gap and losing
        not-yet-decoded bytes.  */
@@ -667,6 +728,15 @@ struct buffer
   struct region_cache *width_run_cache;
   struct region_cache *bidi_paragraph_cache;
 
+  /* The parse states recorded by 'internal--syntax-ppss', or NULL.
+     Unlike the caches above, they are not shared with the base
+     buffer, since they depend on the buffer's syntax table.  */
+  struct syntax_checkpoints *syntax_checkpoints;
+
+  /* The parentheses found by parsing the buffer for 'scan-lists', or
+     NULL.  Not shared with the base buffer either.  */
+  struct bracket_index *bracket_index;
+
   /* Non-zero means disable redisplay optimizations when rebuilding the glyph
      matrices (but not when redrawing).  */
   bool_bf prevent_redisplay_optimizations_p : 1;
@@ -692,6 +762,14 @@ struct buffer
   /* Position where the overlay lists are centered.  */
   ptrdiff_t overlay_center;
 
+  /* Index of the overlays, for buffers with many of them, or NULL.
+     See buffer.c.  */
+  struct overlay_index *overlay_index;
+
+  /* Hash table of the bindings in local_var_alist, for buffers with
+     many local variables, or NULL.  See buffer.c.  */
+  struct local_var_index *local_var_index;
+
   /* Changes in the buffer are recorded here for undo, and t means
      don't record anything.  This information belongs to the base
      buffer of an indirect buffer.  But we can't store it in the
@@ -1165,6 +1243,9 @@ extern void set_buffer_internal_1 (struct buffer *);
 extern void set_buffer_internal_2 (struct buffer *);
 extern void set_buffer_temp (struct buffer *);
 extern Lisp_Object buffer_local_value (Lisp_Object, Lisp_Object);
+extern Lisp_Object buffer_local_binding (struct buffer *, Lisp_Object);
+extern void add_buffer_local_binding (struct buffer *, Lisp_Object);
+extern void remove_buffer_local_binding (struct buffer *, Lisp_Object);
 extern void record_buffer (Lisp_Object);
 extern void fix_overlays_before (struct buffer *, ptrdiff_t, ptrdiff_t);
 extern void mmap_set_vars (bool);
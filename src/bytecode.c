@@ -283,6 +283,18 @@ enum byte_code_op
 #endif
 };
 
+/* How a reference to a stack slot combines with the instruction after
+   it, indexed by that instruction's opcode.  */
+
+enum { REF_PUSH, REF_CAR, REF_CDR, REF_JUMP };
+
+static unsigned char const ref_successor[256] =
+  {
+    [Bcar] = REF_CAR, [Bcar_safe] = REF_CAR,
+    [Bcdr] = REF_CDR, [Bcdr_safe] = REF_CDR,
+    [Bgotoifnil] = REF_JUMP, [Bgotoifnonnil] = REF_JUMP
+  };
+
 /* Fetch the next byte from the bytecode stream.  */
 
 #define FETCH (*pc++)
@@ -292,6 +304,17 @@ enum byte_code_op
 
 #define FETCH2 (op = FETCH, op + (FETCH << 8))
 
+/* Look at the opcode of the next instruction without fetching it, for
+   the superinstructions in exec_byte_code.  When metering, pretend it
+   is Bstack_ref, which is never combined with anything, so that each
+   instruction is counted on its own.  */
+
+#ifdef BYTE_CODE_METER
+#define PEEK Bstack_ref
+#else
+#define PEEK (*pc)
+#endif
+
 /* Push X onto the execution stack.  The expression X should not
    contain TOP, to avoid competing side effects.  */
 
@@ -402,6 +425,8 @@ exec_byte_code (Lisp_Object bytestr, Lisp_Object vector, Lisp_Object maxdepth,
     {
       int op;
       enum handlertype type;
+      bool test;
+      Lisp_Object ref;
 
       if (BYTE_CODE_SAFE && ! (stack_base <= top && top < stack_lim))
 	emacs_abort ();
@@ -518,8 +543,8 @@ exec_byte_code (Lisp_Object bytestr, Lisp_Object vector, Lisp_Object maxdepth,
 	CASE (Beq):
 	  {
 	    Lisp_Object v1 = POP;
-	    TOP = EQ (v1, TOP) ? Qt : Qnil;
-	    NEXT;
+	    test = EQ (v1, TOP);
+	    goto conditional;
 	  }
 
 	CASE (Bmemq):
@@ -570,11 +595,8 @@ exec_byte_code (Lisp_Object bytestr, Lisp_Object vector, Lisp_Object maxdepth,
 	  NEXT;
 
 	CASE (Bdup):
-	  {
-	    Lisp_Object v1 = TOP;
-	    PUSH (v1);
-	    NEXT;
-	  }
+	  ref = TOP;
+	  goto push_ref;
 
 	/* ------------------ */
 
@@ -629,7 +651,45 @@ exec_byte_code (Lisp_Object bytestr, Lisp_Object vector, Lisp_Object maxdepth,
 		  }
 	      }
 #endif
-	    TOP = Ffuncall (op + 1, &TOP);
+
+	    /* Do what Ffuncall does, but dispatch to the most common
+	       kinds of function here: resolving the function of a
+	       symbol is a single load, so a call site needs no cache
+	       for it.  */
+	    maybe_quit ();
+
+	    if (++lisp_eval_depth > max_lisp_eval_depth)
+	      {
+		if (max_lisp_eval_depth < 100)
+		  max_lisp_eval_depth = 100;
+		if (lisp_eval_depth > max_lisp_eval_depth)
+		  error ("Lisp nesting exceeds `max-lisp-eval-depth'");
+	      }
+
+	    ptrdiff_t count1 = record_in_backtrace (TOP, &TOP + 1, op);
+	    maybe_gc ();
+	    if (debug_on_next_call)
+	      do_debug_on_call (Qlambda, count1);
+
+	    Lisp_Object fun = TOP, template, code, val;
+	    if (SYMBOLP (fun) && !NILP (fun))
+	      fun = XSYMBOL (fun)->u.s.function;
+	    if (COMPILEDP (fun)
+		&& (template = AREF (fun, COMPILED_ARGLIST), FIXNUMP (template))
+		&& (code = AREF (fun, COMPILED_BYTECODE), !CONSP (code)))
+	      val = exec_byte_code (code, AREF (fun, COMPILED_CONSTANTS),
+				    AREF (fun, COMPILED_STACK_DEPTH),
+				    template, op, &TOP + 1);
+	    else if (SUBRP (fun) && !SUBR_NATIVE_COMPILED_DYNP (fun))
+	      val = funcall_subr (XSUBR (fun), op, &TOP + 1);
+	    else
+	      val = funcall_general (TOP, op, &TOP + 1);
+
+	    lisp_eval_depth--;
+	    if (backtrace_debug_on_exit (specpdl + count1))
+	      val = call_debugger (list2 (Qexit, val));
+	    specpdl_ptr--;
+	    TOP = val;
 	    NEXT;
 	  }
 
@@ -697,6 +757,66 @@ exec_byte_code (Lisp_Object bytestr, Lisp_Object vector, Lisp_Object maxdepth,
 	  DISCARD (1);
 	  NEXT;
 
+	  /* Superinstructions.  The byte compiler follows most
+	     predicates with a conditional jump, and most references to
+	     a stack slot with `car', `cdr' or a conditional jump.
+	     Rather than add opcodes, which would change the format of
+	     .elc files, the first instruction of such a pair peeks at
+	     the next opcode and, if it is one of these, does the work of
+	     both.  This saves a dispatch, and the push
+	     and pop between the two.
+
+	     A predicate comes here with its result in TEST and its
+	     operands popped, except for TOP, which the result is to
+	     replace.  */
+	conditional:
+	  op = PEEK;
+	  if (Bgotoifnil <= op && op <= Bgotoifnonnilelsepop)
+	    {
+	      bool jump = (op == Bgotoifnonnil || op == Bgotoifnonnilelsepop
+			   ? test : !test);
+	      bool elsepop = op >= Bgotoifnilelsepop;
+	      pc++;
+	      op = FETCH2;
+	      if (jump)
+		{
+		  if (elsepop)
+		    TOP = test ? Qt : Qnil;
+		  else
+		    DISCARD (1);
+		  goto op_branch;
+		}
+	      DISCARD (1);
+	      NEXT;
+	    }
+	  TOP = test ? Qt : Qnil;
+	  NEXT;
+
+	  /* A reference to a stack slot comes here with the value to push
+	     in REF.  */
+	push_ref:
+	  op = PEEK;
+	  if (ref_successor[op] != REF_PUSH)
+	    {
+	      if (ref_successor[op] == REF_JUMP)
+		{
+		  bool jump = op == Bgotoifnil ? NILP (ref) : !NILP (ref);
+		  pc++;
+		  op = FETCH2;
+		  if (jump)
+		    goto op_branch;
+		  NEXT;
+		}
+	      if (CONSP (ref))
+		{
+		  pc++;
+		  PUSH (ref_successor[op] == REF_CAR ? XCAR (ref) : XCDR (ref));
+		  NEXT;
+		}
+	    }
+	  PUSH (ref);
+	  NEXT;
+
 	CASE (BRgoto):
 	  op = FETCH - 128;
 	  goto op_relative_branch;
@@ -844,24 +964,24 @@ exec_byte_code (Lisp_Object bytestr, Lisp_Object vector, Lisp_Object maxdepth,
 	  }
 
 	CASE (Bsymbolp):
-	  TOP = SYMBOLP (TOP) ? Qt : Qnil;
-	  NEXT;
+	  test = SYMBOLP (TOP);
+	  goto conditional;
 
 	CASE (Bconsp):
-	  TOP = CONSP (TOP) ? Qt : Qnil;
-	  NEXT;
+	  test = CONSP (TOP);
+	  goto conditional;
 
 	CASE (Bstringp):
-	  TOP = STRINGP (TOP) ? Qt : Qnil;
-	  NEXT;
+	  test = STRINGP (TOP);
+	  goto conditional;
 
 	CASE (Blistp):
-	  TOP = CONSP (TOP) || NILP (TOP) ? Qt : Qnil;
-	  NEXT;
+	  test = CONSP (TOP) || NILP (TOP);
+	  goto conditional;
 
 	CASE (Bnot):
-	  TOP = NILP (TOP) ? Qt : Qnil;
-	  NEXT;
+	  test = NILP (TOP);
+	  goto conditional;
 
 	CASE (Bcons):
 	  {
@@ -986,43 +1106,61 @@ exec_byte_code (Lisp_Object bytestr, Lisp_Object vector, Lisp_Object maxdepth,
 
 	CASE (Beqlsign):
 	  {
-	    Lisp_Object v1 = POP;
-	    TOP = arithcompare (TOP, v1, ARITH_EQUAL);
-	    NEXT;
+	    Lisp_Object v2 = POP, v1 = TOP;
+	    test = (FIXNUMP (v1) && FIXNUMP (v2)
+		    ? XFIXNUM (v1) == XFIXNUM (v2)
+		    : !NILP (arithcompare (v1, v2, ARITH_EQUAL)));
+	    goto conditional;
 	  }
 
 	CASE (Bgtr):
 	  {
-	    Lisp_Object v1 = POP;
-	    TOP = arithcompare (TOP, v1, ARITH_GRTR);
-	    NEXT;
+	    Lisp_Object v2 = POP, v1 = TOP;
+	    test = (FIXNUMP (v1) && FIXNUMP (v2)
+		    ? XFIXNUM (v1) > XFIXNUM (v2)
+		    : !NILP (arithcompare (v1, v2, ARITH_GRTR)));
+	    goto conditional;
 	  }
 
 	CASE (Blss):
 	  {
-	    Lisp_Object v1 = POP;
-	    TOP = arithcompare (TOP, v1, ARITH_LESS);
-	    NEXT;
+	    Lisp_Object v2 = POP, v1 = TOP;
+	    test = (FIXNUMP (v1) && FIXNUMP (v2)
+		    ? XFIXNUM (v1) < XFIXNUM (v2)
+		    : !NILP (arithcompare (v1, v2, ARITH_LESS)));
+	    goto conditional;
 	  }
 
 	CASE (Bleq):
 	  {
-	    Lisp_Object v1 = POP;
-	    TOP = arithcompare (TOP, v1, ARITH_LESS_OR_EQUAL);
-	    NEXT;
+	    Lisp_Object v2 = POP, v1 = TOP;
+	    test = (FIXNUMP (v1) && FIXNUMP (v2)
+		    ? XFIXNUM (v1) <= XFIXNUM (v2)
+		    : !NILP (arithcompare (v1, v2, ARITH_LESS_OR_EQUAL)));
+	    goto conditional;
 	  }
 
 	CASE (Bgeq):
 	  {
-	    Lisp_Object v1 = POP;
-	    TOP = arithcompare (TOP, v1, ARITH_GRTR_OR_EQUAL);
-	    NEXT;
+	    Lisp_Object v2 = POP, v1 = TOP;
+	    test = (FIXNUMP (v1) && FIXNUMP (v2)
+		    ? XFIXNUM (v1) >= XFIXNUM (v2)
+		    : !NILP (arithcompare (v1, v2, ARITH_GRTR_OR_EQUAL)));
+	    goto conditional;
 	  }
 
 	CASE (Bdiff):
-	  DISCARD (1);
-	  TOP = Fminus (2, &TOP);
-	  NEXT;
+	  {
+	    Lisp_Object v2 = POP, v1 = TOP;
+	    EMACS_INT res;
+	    if (FIXNUMP (v1) && FIXNUMP (v2)
+		&& (res = XFIXNUM (v1) - XFIXNUM (v2),
+		    !FIXNUM_OVERFLOW_P (res)))
+	      TOP = make_fixnum (res);
+	    else
+	      TOP = Fminus (2, &TOP);
+	    NEXT;
+	  }
 
 	CASE (Bnegate):
 	  TOP = (FIXNUMP (TOP) && XFIXNUM (TOP) != MOST_NEGATIVE_FIXNUM
@@ -1031,9 +1169,17 @@ exec_byte_code (Lisp_Object bytestr, Lisp_Object vector, Lisp_Object maxdepth,
 	  NEXT;
 
 	CASE (Bplus):
-	  DISCARD (1);
-	  TOP = Fplus (2, &TOP);
-	  NEXT;
+	  {
+	    Lisp_Object v2 = POP, v1 = TOP;
+	    EMACS_INT res;
+	    if (FIXNUMP (v1) && FIXNUMP (v2)
+		&& (res = XFIXNUM (v1) + XFIXNUM (v2),
+		    !FIXNUM_OVERFLOW_P (res)))
+	      TOP = make_fixnum (res);
+	    else
+	      TOP = Fplus (2, &TOP);
+	    NEXT;
+	  }
 
 	CASE (Bmax):
 	  DISCARD (1);
@@ -1317,12 +1463,12 @@ exec_byte_code (Lisp_Object bytestr, Lisp_Object vector, Lisp_Object maxdepth,
 	  NEXT;
 
 	CASE (Bnumberp):
-	  TOP = NUMBERP (TOP) ? Qt : Qnil;
-	  NEXT;
+	  test = NUMBERP (TOP);
+	  goto conditional;
 
 	CASE (Bintegerp):
-	  TOP = INTEGERP (TOP) ? Qt : Qnil;
-	  NEXT;
+	  test = INTEGERP (TOP);
+	  goto conditional;
 
 #if BYTE_CODE_SAFE
 	  /* These are intentionally written using 'case' syntax,
@@ -1350,23 +1496,14 @@ exec_byte_code (Lisp_Object bytestr, Lisp_Object vector, Lisp_Object maxdepth,
 	CASE (Bstack_ref3):
 	CASE (Bstack_ref4):
 	CASE (Bstack_ref5):
-	  {
-	    Lisp_Object v1 = top[Bstack_ref - op];
-	    PUSH (v1);
-	    NEXT;
-	  }
+	  ref = top[Bstack_ref - op];
+	  goto push_ref;
 	CASE (Bstack_ref6):
-	  {
-	    Lisp_Object v1 = top[- FETCH];
-	    PUSH (v1);
-	    NEXT;
-	  }
+	  ref = top[- FETCH];
+	  goto push_ref;
 	CASE (Bstack_ref7):
-	  {
-	    Lisp_Object v1 = top[- FETCH2];
-	    PUSH (v1);
-	    NEXT;
-	  }
+	  ref = top[- FETCH2];
+	  goto push_ref;
 	CASE (Bstack_set):
 	  /* stack-set-0 = discard; stack-set-1 = discard-1-preserve-tos.  */
 	  {
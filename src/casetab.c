@@ -22,12 +22,24 @@ along with GNU Emacs.  If not, see <https://www.gnu.org/licenses/>.  */
 
 #include "lisp.h"
 #include "buffer.h"
+#include "character.h"
+#include "pdumper.h"
 
 Lisp_Object Vascii_downcase_table;
 static Lisp_Object Vascii_upcase_table;
 Lisp_Object Vascii_canon_table;
 static Lisp_Object Vascii_eqv_table;
 
+/* If not nil, the canonicalize table of the standard case table, whose
+   translations of the characters below 0400 are in
+   standard_canon_chars.  char_table_translate looks them up there
+   instead of in the char-table.  Like the compiled regexps that were
+   compiled with it, the array is not updated if the char-table is
+   modified in place; case tables are meant to be modified through
+   their downcase table, and then installed again.  */
+Lisp_Object standard_canon_chars_table;
+int standard_canon_chars[0400];
+
 static void set_canon (Lisp_Object case_table, Lisp_Object range, Lisp_Object elt);
 static void set_identity (Lisp_Object table, Lisp_Object c, Lisp_Object elt);
 static void shuffle (Lisp_Object table, Lisp_Object c, Lisp_Object elt);
@@ -78,6 +90,7 @@ This is the one used for new buffers.  */)
 }
 
 static Lisp_Object set_case_table (Lisp_Object, bool);
+static void set_standard_canon_chars (void);
 
 DEFUN ("set-case-table", Fset_case_table, Sset_case_table, 1, 1, 0,
        doc: /* Select a new case table for the current buffer.
@@ -154,6 +167,7 @@ set_case_table (Lisp_Object table, bool standard)
       Vascii_upcase_table = up;
       Vascii_canon_table = canon;
       Vascii_eqv_table = eqv;
+      set_standard_canon_chars ();
     }
   else
     {
@@ -166,6 +180,21 @@ set_case_table (Lisp_Object table, bool standard)
   return table;
 }
 
+/* Fill standard_canon_chars from the canonicalize table of the
+   standard case table.  */
+
+static void
+set_standard_canon_chars (void)
+{
+  standard_canon_chars_table = Qnil;
+  if (CHAR_TABLE_P (Vascii_canon_table))
+    {
+      for (int c = 0; c < 0400; c++)
+	standard_canon_chars[c] = char_table_translate (Vascii_canon_table, c);
+      standard_canon_chars_table = Vascii_canon_table;
+    }
+}
+
 /* The following functions are called in map_char_table.  */
 
 /* Set CANON char-table element for characters in RANGE to a
@@ -300,4 +329,6 @@ syms_of_casetab (void)
   defsubr (&Sstandard_case_table);
   defsubr (&Sset_case_table);
   defsubr (&Sset_standard_case_table);
+
+  pdumper_do_now_and_after_load (set_standard_canon_chars);
 }
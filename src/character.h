@@ -587,6 +587,9 @@ extern bool printablep (int);
 extern bool blankp (int);
 extern bool graphic_base_p (int);
 
+extern Lisp_Object standard_canon_chars_table;
+extern int standard_canon_chars[0400];
+
 /* Look up the element in char table OBJ at index CH, and return it as
    an integer.  If the element is not a character, return CH itself.  */
 
@@ -597,6 +600,10 @@ char_table_translate (Lisp_Object obj, int ch)
      so there is an eassert instead of CHECK_xxx for the sake of speed.  */
   eassert (CHAR_VALID_P (ch));
   eassert (CHAR_TABLE_P (obj));
+  /* Case-folded searches mostly translate ASCII and Latin-1
+     characters by the standard canonicalize table.  */
+  if (ch < 0400 && EQ (obj, standard_canon_chars_table))
+    return standard_canon_chars[ch];
   obj = CHAR_TABLE_REF (obj, ch);
   return CHARACTERP (obj) ? XFIXNUM (obj) : ch;
 }
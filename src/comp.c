@@ -91,6 +91,7 @@ along with GNU Emacs.  If not, see <https://www.gnu.org/licenses/>.  */
 #undef gcc_jit_context_set_int_option
 #undef gcc_jit_context_set_logfile
 #undef gcc_jit_context_set_str_option
+#undef gcc_jit_function_add_attribute
 #undef gcc_jit_function_get_param
 #undef gcc_jit_function_new_block
 #undef gcc_jit_function_new_local
@@ -156,6 +157,10 @@ DEF_DLL_FN (gcc_jit_lvalue *, gcc_jit_function_new_local,
 DEF_DLL_FN (gcc_jit_lvalue *, gcc_jit_global_set_initializer,
 	    (gcc_jit_lvalue *global, const void *blob, size_t num_bytes));
 #endif
+#if defined (LIBGCCJIT_HAVE_ATTRIBUTES)
+DEF_DLL_FN (void, gcc_jit_function_add_attribute,
+	    (gcc_jit_function *func, enum gcc_jit_fn_attribute attribute));
+#endif
 DEF_DLL_FN (gcc_jit_lvalue *, gcc_jit_lvalue_access_field,
             (gcc_jit_lvalue *struct_or_union, gcc_jit_location *loc,
              gcc_jit_field *field));
@@ -339,6 +344,9 @@ init_gccjit_functions (void)
 #if defined (LIBGCCJIT_HAVE_gcc_jit_global_set_initializer)
   LOAD_DLL_FN_OPT (library, gcc_jit_global_set_initializer);
 #endif
+#if defined (LIBGCCJIT_HAVE_ATTRIBUTES)
+  LOAD_DLL_FN_OPT (library, gcc_jit_function_add_attribute);
+#endif
 #if defined (LIBGCCJIT_HAVE_gcc_jit_version)
   LOAD_DLL_FN_OPT (library, gcc_jit_version_major);
   LOAD_DLL_FN_OPT (library, gcc_jit_version_minor);
@@ -399,6 +407,9 @@ init_gccjit_functions (void)
 #if defined (LIBGCCJIT_HAVE_gcc_jit_global_set_initializer)
  #define gcc_jit_global_set_initializer fn_gcc_jit_global_set_initializer
 #endif
+#if defined (LIBGCCJIT_HAVE_ATTRIBUTES)
+ #define gcc_jit_function_add_attribute fn_gcc_jit_function_add_attribute
+#endif
 #define gcc_jit_lvalue_access_field fn_gcc_jit_lvalue_access_field
 #define gcc_jit_lvalue_as_rvalue fn_gcc_jit_lvalue_as_rvalue
 #define gcc_jit_lvalue_get_address fn_gcc_jit_lvalue_get_address
@@ -3903,6 +3914,7 @@ declare_lex_function (Lisp_Object func)
 
 /* Declare a function being compiled and add it to comp.exported_funcs_h.  */
 
+#pragma GCC diagnostic ignored "-Waddress"
 static void
 declare_function (Lisp_Object func)
 {
@@ -3915,10 +3927,18 @@ declare_function (Lisp_Object func)
 				    comp.lisp_obj_type,
 				    SSDATA (CALL1I (comp-func-c-name, func)),
 				    0, NULL, 0);
+#if defined (LIBGCCJIT_HAVE_ATTRIBUTES)
+  /* Functions the profile never saw running are optimized for size
+     and placed apart from the others.  */
+  if (gcc_jit_function_add_attribute
+      && !NILP (CALL1I (comp-func-cold, func)))
+    gcc_jit_function_add_attribute (gcc_func, GCC_JIT_FN_ATTRIBUTE_COLD);
+#endif
   Fputhash (CALL1I (comp-func-c-name, func),
 	    make_mint_ptr (gcc_func),
 	    comp.exported_funcs_h);
 }
+#pragma GCC diagnostic pop
 
 static void
 compile_function (Lisp_Object func)
@@ -1392,7 +1392,7 @@ swap_in_symval_forwarding (struct Lisp_Symbol *symbol, struct Lisp_Buffer_Local_
       {
 	Lisp_Object var;
 	XSETSYMBOL (var, symbol);
-	tem1 = assq_no_quit (var, BVAR (current_buffer, local_var_alist));
+	tem1 = buffer_local_binding (current_buffer, var);
 	set_blv_where (blv, Fcurrent_buffer ());
       }
       if (!(blv->found = !NILP (tem1)))
@@ -1536,9 +1536,7 @@ set_internal (Lisp_Object symbol, Lisp_Object newval, Lisp_Object where,
 
 	    /* Find the new binding.  */
 	    XSETSYMBOL (symbol, sym); /* May have changed via aliasing.  */
-	    Lisp_Object tem1
-	      = assq_no_quit (symbol,
-			      BVAR (XBUFFER (where), local_var_alist));
+	    Lisp_Object tem1 = buffer_local_binding (XBUFFER (where), symbol);
 	    set_blv_where (blv, where);
 	    blv->found = true;
 
@@ -1566,9 +1564,7 @@ set_internal (Lisp_Object symbol, Lisp_Object newval, Lisp_Object where,
 		else
 		  {
 		    tem1 = Fcons (symbol, XCDR (blv->defcell));
-		    bset_local_var_alist
-		      (XBUFFER (where),
-		       Fcons (tem1, BVAR (XBUFFER (where), local_var_alist)));
+		    add_buffer_local_binding (XBUFFER (where), tem1);
 		  }
 	      }
 
@@ -2101,7 +2097,7 @@ Instead, use `add-hook' and specify t for the LOCAL argument.  */)
 
   /* Make sure this buffer has its own value of symbol.  */
   XSETSYMBOL (variable, sym);	/* Update in case of aliasing.  */
-  tem = Fassq (variable, BVAR (current_buffer, local_var_alist));
+  tem = buffer_local_binding (current_buffer, variable);
   if (NILP (tem))
     {
       if (let_shadows_buffer_binding_p (sym))
@@ -2116,10 +2112,8 @@ Instead, use `add-hook' and specify t for the LOCAL argument.  */)
            default value.  */
         swap_in_global_binding (sym);
 
-      bset_local_var_alist
-	(current_buffer,
-	 Fcons (Fcons (variable, XCDR (blv->defcell)),
-		BVAR (current_buffer, local_var_alist)));
+      add_buffer_local_binding (current_buffer,
+				Fcons (variable, XCDR (blv->defcell)));
 
       /* If the symbol forwards into a C variable, then load the binding
          for this buffer now, to preserve the invariant that forwarded
@@ -2181,11 +2175,9 @@ From now on the default value will apply in this buffer.  Return VARIABLE.  */)
 
   /* Get rid of this buffer's alist element, if any.  */
   XSETSYMBOL (variable, sym);	/* Propagate variable indirection.  */
-  tem = Fassq (variable, BVAR (current_buffer, local_var_alist));
+  tem = buffer_local_binding (current_buffer, variable);
   if (!NILP (tem))
-    bset_local_var_alist
-      (current_buffer,
-       Fdelq (tem, BVAR (current_buffer, local_var_alist)));
+    remove_buffer_local_binding (current_buffer, tem);
 
   /* If the symbol is set up with the current buffer's binding
      loaded, recompute its value.  We have to do it now, or else
@@ -2222,7 +2214,7 @@ Also see `buffer-local-boundp'.*/)
     case SYMBOL_PLAINVAL: return Qnil;
     case SYMBOL_LOCALIZED:
       {
-	Lisp_Object tail, elt, tmp;
+	Lisp_Object tmp;
 	struct Lisp_Buffer_Local_Value *blv = SYMBOL_BLV (sym);
 	XSETBUFFER (tmp, buf);
 	XSETSYMBOL (variable, sym); /* Update in case of aliasing.  */
@@ -2230,13 +2222,7 @@ Also see `buffer-local-boundp'.*/)
 	if (EQ (blv->where, tmp)) /* The binding is already loaded.  */
 	  return blv_found (blv) ? Qt : Qnil;
 	else
-	  for (tail = BVAR (buf, local_var_alist); CONSP (tail); tail = XCDR (tail))
-	    {
-	      elt = XCAR (tail);
-	      if (EQ (variable, XCAR (elt)))
-		return Qt;
-	    }
-	return Qnil;
+	  return NILP (buffer_local_binding (buf, variable)) ? Qnil : Qt;
       }
     case SYMBOL_FORWARDED:
       {
@@ -3499,7 +3485,7 @@ shift_right_ull (bits_word w)
 
 /* Return the number of 1 bits in W.  */
 
-static int
+int
 count_one_bits_word (bits_word w)
 {
   if (BITS_WORD_MAX <= UINT_MAX)
@@ -3634,7 +3620,7 @@ pre_value (bool precondition, int value)
 
 /* Compute the number of trailing zero bits in val.  If val is zero,
    return the number of bits in val.  */
-static int
+int
 count_trailing_zero_bits (bits_word val)
 {
   if (BITS_WORD_MAX == UINT_MAX)
@@ -4316,6 +4316,7 @@ ring.  */)
                                    len1, current_buffer, 0);
       graft_intervals_into_buffer (tmp_interval2, start1,
                                    len2, current_buffer, 0);
+      invalidate_text_indexes (current_buffer, start1_byte);
       update_compositions (start1, start1 + len2, CHECK_BORDER);
       update_compositions (start1 + len2, end2, CHECK_TAIL);
     }
@@ -4423,6 +4424,7 @@ ring.  */)
                                        len2, current_buffer, 0);
         }
 
+      invalidate_text_indexes (current_buffer, start1_byte);
       update_compositions (start1, start1 + len2, CHECK_BORDER);
       update_compositions (end2 - len1, end2, CHECK_BORDER);
     }
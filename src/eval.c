@@ -137,7 +137,7 @@ backtrace_args (union specbinding *pdl)
   return pdl->bt.args;
 }
 
-static bool
+bool
 backtrace_debug_on_exit (union specbinding *pdl)
 {
   eassert (pdl->kind == SPECPDL_BACKTRACE);
@@ -353,7 +353,7 @@ call_debugger (Lisp_Object arg)
   return unbind_to (count, val);
 }
 
-static void
+void
 do_debug_on_call (Lisp_Object code, ptrdiff_t count)
 {
   debug_on_next_call = 0;
@@ -2979,37 +2979,15 @@ FUNCTIONP (Lisp_Object object)
     return false;
 }
 
-DEFUN ("funcall", Ffuncall, Sfuncall, 1, MANY, 0,
-       doc: /* Call first argument as a function, passing remaining arguments to it.
-Return the value that function returns.
-Thus, (funcall \\='cons \\='x \\='y) returns (x . y).
-usage: (funcall FUNCTION &rest ARGUMENTS)  */)
-  (ptrdiff_t nargs, Lisp_Object *args)
-{
-  Lisp_Object fun, original_fun;
-  Lisp_Object funcar;
-  ptrdiff_t numargs = nargs - 1;
-  Lisp_Object val;
-  ptrdiff_t count;
-
-  maybe_quit ();
-
-  if (++lisp_eval_depth > max_lisp_eval_depth)
-    {
-      if (max_lisp_eval_depth < 100)
-	max_lisp_eval_depth = 100;
-      if (lisp_eval_depth > max_lisp_eval_depth)
-	error ("Lisp nesting exceeds `max-lisp-eval-depth'");
-    }
-
-  count = record_in_backtrace (args[0], &args[1], nargs - 1);
-
-  maybe_gc ();
-
-  if (debug_on_next_call)
-    do_debug_on_call (Qlambda, count);
+/* Call the function ORIGINAL_FUN, a function or a symbol, with the
+   NUMARGS arguments in ARGS, without recording the call in the
+   backtrace.  Ffuncall and the byte-code interpreter do that.  */
 
-  original_fun = args[0];
+Lisp_Object
+funcall_general (Lisp_Object original_fun, ptrdiff_t numargs,
+		 Lisp_Object *args)
+{
+  Lisp_Object fun, funcar;
 
  retry:
 
@@ -3019,12 +2997,19 @@ usage: (funcall FUNCTION &rest ARGUMENTS)  */)
       && (fun = XSYMBOL (fun)->u.s.function, SYMBOLP (fun)))
     fun = indirect_function (fun);
 
+  Lisp_Object template, code;
   if (SUBRP (fun) && !SUBR_NATIVE_COMPILED_DYNP (fun))
-    val = funcall_subr (XSUBR (fun), numargs, args + 1);
+    return funcall_subr (XSUBR (fun), numargs, args);
+  else if (COMPILEDP (fun)
+	   && (template = AREF (fun, COMPILED_ARGLIST), FIXNUMP (template))
+	   && (code = AREF (fun, COMPILED_BYTECODE), !CONSP (code)))
+    return exec_byte_code (code, AREF (fun, COMPILED_CONSTANTS),
+			   AREF (fun, COMPILED_STACK_DEPTH),
+			   template, numargs, args);
   else if (COMPILEDP (fun)
 	   || SUBR_NATIVE_COMPILED_DYNP (fun)
 	   || MODULE_FUNCTIONP (fun))
-    val = funcall_lambda (fun, numargs, args + 1);
+    return funcall_lambda (fun, numargs, args);
   else
     {
       if (NILP (fun))
@@ -3036,7 +3021,7 @@ usage: (funcall FUNCTION &rest ARGUMENTS)  */)
 	xsignal1 (Qinvalid_function, original_fun);
       if (EQ (funcar, Qlambda)
 	  || EQ (funcar, Qclosure))
-	val = funcall_lambda (fun, numargs, args + 1);
+	return funcall_lambda (fun, numargs, args);
       else if (EQ (funcar, Qautoload))
 	{
 	  Fautoload_do_load (fun, original_fun, Qnil);
@@ -3045,6 +3030,36 @@ usage: (funcall FUNCTION &rest ARGUMENTS)  */)
       else
 	xsignal1 (Qinvalid_function, original_fun);
     }
+}
+
+DEFUN ("funcall", Ffuncall, Sfuncall, 1, MANY, 0,
+       doc: /* Call first argument as a function, passing remaining arguments to it.
+Return the value that function returns.
+Thus, (funcall \\='cons \\='x \\='y) returns (x . y).
+usage: (funcall FUNCTION &rest ARGUMENTS)  */)
+  (ptrdiff_t nargs, Lisp_Object *args)
+{
+  ptrdiff_t count;
+
+  maybe_quit ();
+
+  if (++lisp_eval_depth > max_lisp_eval_depth)
+    {
+      if (max_lisp_eval_depth < 100)
+	max_lisp_eval_depth = 100;
+      if (lisp_eval_depth > max_lisp_eval_depth)
+	error ("Lisp nesting exceeds `max-lisp-eval-depth'");
+    }
+
+  count = record_in_backtrace (args[0], &args[1], nargs - 1);
+
+  maybe_gc ();
+
+  if (debug_on_next_call)
+    do_debug_on_call (Qlambda, count);
+
+  Lisp_Object val = funcall_general (args[0], nargs - 1, args + 1);
+
   lisp_eval_depth--;
   if (backtrace_debug_on_exit (specpdl + count))
     val = call_debugger (list2 (Qexit, val));
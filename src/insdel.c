@@ -249,6 +249,7 @@ adjust_markers_for_delete (ptrdiff_t from, ptrdiff_t from_byte,
   ptrdiff_t charpos;
 
   adjust_suspend_auto_hscroll (from, to);
+  adjust_text_indexes_for_delete (current_buffer, from_byte, to_byte);
   for (m = BUF_MARKERS (current_buffer); m; m = m->next)
     {
       charpos = m->charpos;
@@ -289,6 +290,7 @@ adjust_markers_for_insert (ptrdiff_t from, ptrdiff_t from_byte,
   ptrdiff_t nbytes = to_byte - from_byte;
 
   adjust_suspend_auto_hscroll (from, to);
+  adjust_text_indexes_for_insert (current_buffer, from_byte, to_byte);
   for (m = BUF_MARKERS (current_buffer); m; m = m->next)
     {
       eassert (m->bytepos >= m->charpos
@@ -355,6 +357,8 @@ adjust_markers_for_replace (ptrdiff_t from, ptrdiff_t from_byte,
   ptrdiff_t diff_bytes = new_bytes - old_bytes;
 
   adjust_suspend_auto_hscroll (from, from + old_chars);
+  adjust_text_indexes_for_replace (current_buffer, from_byte,
+				   old_bytes, new_bytes, diff_chars);
   for (m = BUF_MARKERS (current_buffer); m; m = m->next)
     {
       if (m->bytepos >= prev_to_byte)
@@ -442,6 +446,7 @@ adjust_markers_bytepos (ptrdiff_t from, ptrdiff_t from_byte,
 
   /* Make sure cached charpos/bytepos is invalid.  */
   clear_charpos_cache (current_buffer);
+  invalidate_text_indexes (current_buffer, from_byte);
 }
 
 
@@ -1905,6 +1910,8 @@ void
 modify_text (ptrdiff_t start, ptrdiff_t end)
 {
   prepare_to_modify_buffer (start, end, NULL);
+  text_index_invalidate (current_buffer->text->line_index,
+			 CHAR_TO_BYTE (start));
 
   BUF_COMPUTE_UNCHANGED (current_buffer, start - 1, end);
   if (MODIFF <= SAVE_MODIFF)
@@ -2026,6 +2033,9 @@ prepare_to_modify_buffer (ptrdiff_t start, ptrdiff_t end,
 void
 invalidate_buffer_caches (struct buffer *buf, ptrdiff_t start, ptrdiff_t end)
 {
+  /* The syntax checkpoints are per buffer, even for indirect
+     buffers.  */
+  invalidate_syntax_checkpoints (buf, start);
   /* Indirect buffers usually have their caches set to NULL, but we
      need to consider the caches of their base buffer.  */
   if (buf->base_buffer)
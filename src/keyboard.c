@@ -2358,6 +2358,10 @@ read_decoded_event_from_main_queue (struct timespec *end_time,
     }
 }
 
+/* Seconds read_char waits for input before collecting garbage that
+   gc_idle_collection_due_p says is due.  */
+#define GC_IDLE_DELAY 0.1
+
 /* Read a character from the keyboard; call the redisplay if needed.  */
 /* commandflag 0 means do not autosave, but do redisplay.
    -1 means do not redisplay, but do autosave.
@@ -2763,6 +2767,29 @@ read_char (int commandflag, Lisp_Object map,
       goto exit;
     }
 
+  /* Collect garbage if enough has been allocated and no input comes
+     for a moment, see `gc-cons-idle-fraction'.  This must not wait
+     for the auto-save timeout below, which is at least half a minute.  */
+
+  if (INTERACTIVE && NILP (c) && gc_idle_collection_due_p ()
+      && (!end_time
+	  || timespec_cmp (timespec_add (current_timespec (),
+					 dtotimespec (GC_IDLE_DELAY)),
+			   *end_time) < 0))
+    {
+      Lisp_Object tem0;
+
+      ptrdiff_t count = SPECPDL_INDEX ();
+      save_getcjmp (save_jump);
+      record_unwind_protect_ptr (restore_getcjmp, save_jump);
+      restore_getcjmp (local_getcjmp);
+      tem0 = sit_for (make_float (GC_IDLE_DELAY), 1, 1);
+      unbind_to (count, Qnil);
+      if (EQ (tem0, Qt)
+	  && ! CONSP (Vunread_command_events))
+	garbage_collect ();
+    }
+
   /* Maybe autosave and/or garbage collect due to idleness.  */
 
   if (INTERACTIVE && NILP (c))
@@ -76,6 +76,326 @@ clear_charpos_cache (struct buffer *b)
     cached_buffer = 0;
 }
 
+/* Text indexes.  See struct text_index in buffer.h.  */
+
+/* Return the number of checkpoints of INDEX at or before BYTEPOS.  */
+
+ptrdiff_t
+text_index_upto (struct text_index *index, ptrdiff_t bytepos)
+{
+  ptrdiff_t lo = 0, hi = index->used;
+  while (lo < hi)
+    {
+      ptrdiff_t mid = lo + (hi - lo) / 2;
+      if (index->checkpoints[mid].bytepos <= bytepos)
+	lo = mid + 1;
+      else
+	hi = mid;
+    }
+  return lo;
+}
+
+/* Return the number of checkpoints of INDEX whose count is at most
+   COUNT.  */
+
+ptrdiff_t
+text_index_upto_count (struct text_index *index, ptrdiff_t count)
+{
+  ptrdiff_t lo = 0, hi = index->used;
+  while (lo < hi)
+    {
+      ptrdiff_t mid = lo + (hi - lo) / 2;
+      if (index->checkpoints[mid].count <= count)
+	lo = mid + 1;
+      else
+	hi = mid;
+    }
+  return lo;
+}
+
+/* Return the index of kind KIND in *SLOT for B's text, creating it if
+   necessary, or NULL if the text is too small for one to be worth
+   it.  */
+
+struct text_index *
+text_index_get (struct buffer *b, struct text_index **slot,
+		struct text_index_kind const *kind)
+{
+  if (BUF_Z_BYTE (b) - BUF_BEG_BYTE (b) <= 4 * kind->interval)
+    return NULL;
+  struct text_index *index = *slot;
+  if (!index)
+    {
+      index = *slot = xzalloc (sizeof *index);
+      index->kind = kind;
+    }
+  if (index->z_byte != BUF_Z_BYTE (b) || index->used == 0)
+    {
+      if (index->size == 0)
+	index->checkpoints = xpalloc (NULL, &index->size, 1, -1,
+				      sizeof *index->checkpoints);
+      index->checkpoints[0].bytepos = BUF_BEG_BYTE (b);
+      index->checkpoints[0].count = kind->beg_count;
+      index->used = 1;
+      index->z_byte = BUF_Z_BYTE (b);
+    }
+  return index;
+}
+
+/* Add a checkpoint of B about one interval after checkpoint K of
+   INDEX, if that is not too close to the checkpoint after K or to the
+   end of the text.  Return true if a checkpoint was added.  */
+
+bool
+text_index_split (struct buffer *b, struct text_index *index, ptrdiff_t k)
+{
+  struct text_index_kind const *kind = index->kind;
+  struct text_checkpoint *c = index->checkpoints;
+  ptrdiff_t next = c[k].bytepos + kind->interval;
+  ptrdiff_t limit = (k + 1 < index->used
+		     ? c[k + 1].bytepos - kind->interval
+		     : BUF_Z_BYTE (b));
+  if (limit <= next)
+    return false;
+  if (kind->char_heads)
+    while (!CHAR_HEAD_P (BUF_FETCH_BYTE (b, next)))
+      if (++next == BUF_Z_BYTE (b))
+	return false;
+
+  if (index->used == index->size)
+    index->checkpoints = c = xpalloc (c, &index->size, 1, -1, sizeof *c);
+  memmove (c + k + 2, c + k + 1, (index->used - k - 1) * sizeof *c);
+  c[k + 1].count = c[k].count + kind->count (b, c[k].bytepos, next);
+  c[k + 1].bytepos = next;
+  index->used++;
+  return true;
+}
+
+/* Discard the checkpoints of INDEX after BYTEPOS, where the text has
+   changed.  INDEX may be NULL.  */
+
+void
+text_index_invalidate (struct text_index *index, ptrdiff_t bytepos)
+{
+  if (index && index->used)
+    index->used = max (1, text_index_upto (index, bytepos));
+}
+
+/* Relocate the checkpoints of INDEX for the replacement of the text
+   between FROM_BYTE and TO_BYTE by text DIFF_BYTES longer, whose count
+   is DIFF_COUNT more.  Checkpoints after FROM_BYTE, up to TO_BYTE, are
+   discarded.  */
+
+static void
+text_index_shift (struct text_index *index, ptrdiff_t from_byte,
+		  ptrdiff_t to_byte, ptrdiff_t diff_bytes,
+		  ptrdiff_t diff_count)
+{
+  ptrdiff_t lo = text_index_upto (index, from_byte);
+  ptrdiff_t hi = text_index_upto (index, to_byte);
+  struct text_checkpoint *c = index->checkpoints;
+  memmove (c + lo, c + hi, (index->used - hi) * sizeof *c);
+  index->used -= hi - lo;
+  for (ptrdiff_t k = lo; k < index->used; k++)
+    {
+      c[k].bytepos += diff_bytes;
+      c[k].count += diff_count;
+    }
+  index->z_byte += diff_bytes;
+}
+
+/* Relocate the checkpoints of INDEX for B after the text between
+   FROM_BYTE and TO_BYTE was inserted.  */
+
+static void
+text_index_insert (struct buffer *b, struct text_index *index,
+		   ptrdiff_t from_byte, ptrdiff_t to_byte)
+{
+  if (! (index && index->used))
+    return;
+  /* Count the inserted text only if some checkpoint follows it.  */
+  ptrdiff_t count = (text_index_upto (index, from_byte) < index->used
+		     ? index->kind->count (b, from_byte, to_byte)
+		     : 0);
+  text_index_shift (index, from_byte, from_byte, to_byte - from_byte, count);
+}
+
+/* Relocate the checkpoints of INDEX for B before the text between
+   FROM_BYTE and TO_BYTE is deleted.  */
+
+static void
+text_index_delete (struct buffer *b, struct text_index *index,
+		   ptrdiff_t from_byte, ptrdiff_t to_byte)
+{
+  if (! (index && index->used))
+    return;
+  ptrdiff_t lo = text_index_upto (index, from_byte);
+  ptrdiff_t hi = text_index_upto (index, to_byte);
+  struct text_checkpoint *c = index->checkpoints;
+  ptrdiff_t count = 0;
+  if (hi < index->used)
+    {
+      /* Count the deleted text directly, or from the checkpoints
+	 before FROM_BYTE and TO_BYTE, whichever scans less.  */
+      ptrdiff_t (*count_text) (struct buffer *, ptrdiff_t, ptrdiff_t)
+	= index->kind->count;
+      if (to_byte - from_byte
+	  <= (from_byte - c[lo - 1].bytepos) + (to_byte - c[hi - 1].bytepos))
+	count = count_text (b, from_byte, to_byte);
+      else
+	count = (c[hi - 1].count
+		 + count_text (b, c[hi - 1].bytepos, to_byte)
+		 - c[lo - 1].count
+		 - count_text (b, c[lo - 1].bytepos, from_byte));
+    }
+  text_index_shift (index, from_byte, to_byte, from_byte - to_byte, - count);
+}
+
+static void
+text_index_free (struct text_index **slot)
+{
+  struct text_index *index = *slot;
+  if (index)
+    {
+      xfree (index->checkpoints);
+      xfree (index);
+      *slot = NULL;
+    }
+}
+
+/* The text indexes of a buffer are adjusted together, by the
+   following functions.  */
+
+/* Discard the checkpoints of B's text after BYTEPOS, where the text
+   has changed.  */
+
+void
+invalidate_text_indexes (struct buffer *b, ptrdiff_t bytepos)
+{
+  text_index_invalidate (b->text->charpos_index, bytepos);
+  text_index_invalidate (b->text->line_index, bytepos);
+}
+
+/* Relocate the checkpoints of B's text after the text between
+   FROM_BYTE and TO_BYTE was inserted.  */
+
+void
+adjust_text_indexes_for_insert (struct buffer *b, ptrdiff_t from_byte,
+				ptrdiff_t to_byte)
+{
+  text_index_insert (b, b->text->charpos_index, from_byte, to_byte);
+  text_index_insert (b, b->text->line_index, from_byte, to_byte);
+}
+
+/* Relocate the checkpoints of B's text before the text between
+   FROM_BYTE and TO_BYTE is deleted.  */
+
+void
+adjust_text_indexes_for_delete (struct buffer *b, ptrdiff_t from_byte,
+				ptrdiff_t to_byte)
+{
+  text_index_delete (b, b->text->charpos_index, from_byte, to_byte);
+  text_index_delete (b, b->text->line_index, from_byte, to_byte);
+}
+
+/* Relocate the checkpoints of B's text after the OLD_BYTES bytes at
+   FROM_BYTE were replaced by NEW_BYTES bytes, DIFF_CHARS characters
+   more.  The replaced text is gone, so the line index cannot be
+   relocated past it.  */
+
+void
+adjust_text_indexes_for_replace (struct buffer *b, ptrdiff_t from_byte,
+				 ptrdiff_t old_bytes, ptrdiff_t new_bytes,
+				 ptrdiff_t diff_chars)
+{
+  struct text_index *index = b->text->charpos_index;
+  if (index && index->used)
+    text_index_shift (index, from_byte, from_byte + old_bytes,
+		      new_bytes - old_bytes, diff_chars);
+  text_index_invalidate (b->text->line_index, from_byte);
+}
+
+void
+free_text_indexes (struct buffer *b)
+{
+  text_index_free (&b->text->charpos_index);
+  text_index_free (&b->text->line_index);
+}
+
+/* In large multibyte buffers, the correspondence between character
+   and byte positions is also recorded in a text index with
+   checkpoints spaced about CHARPOS_INDEX_INTERVAL bytes apart, so that
+   converting a position seldom scans more than that many bytes.  */
+
+enum { CHARPOS_INDEX_INTERVAL = 4096 };
+
+/* Return the number of characters that start between byte positions
+   FROM and TO of B.  */
+
+static ptrdiff_t
+count_char_heads (struct buffer *b, ptrdiff_t from, ptrdiff_t to)
+{
+  ptrdiff_t n = 0;
+  while (from < to)
+    {
+      ptrdiff_t end = (from < BUF_GPT_BYTE (b)
+		       ? min (to, BUF_GPT_BYTE (b)) : to);
+      unsigned char const *p = BUF_BYTE_ADDRESS (b, from);
+      for (ptrdiff_t i = 0; i < end - from; i++)
+	n += CHAR_HEAD_P (p[i]);
+      from = end;
+    }
+  return n;
+}
+
+static struct text_index_kind const charpos_index_kind =
+  { CHARPOS_INDEX_INTERVAL, BEG, count_char_heads, true };
+
+/* Return the character position index of B if it is worth consulting
+   for a position between bytes BELOW and ABOVE, creating it if
+   necessary.  Otherwise, return NULL.  */
+
+static struct text_index *
+charpos_index_for (struct buffer *b, ptrdiff_t below, ptrdiff_t above)
+{
+  if (above - below <= CHARPOS_INDEX_INTERVAL)
+    return NULL;
+  return text_index_get (b, &b->text->charpos_index, &charpos_index_kind);
+}
+
+/* Return the number of the last checkpoint of B at or before CHARPOS,
+   adding checkpoints so that the next one is not much further away.
+   Return -1 if that would cost more than scanning from BELOW or ABOVE
+   bytes, the closest positions known otherwise.  */
+
+static ptrdiff_t
+charpos_checkpoint (struct buffer *b, struct text_index *index,
+		    ptrdiff_t charpos, ptrdiff_t below, ptrdiff_t above)
+{
+  ptrdiff_t k = text_index_upto_count (index, charpos) - 1;
+  if (index->checkpoints[k].bytepos < below - (above - below))
+    return -1;
+  while (text_index_split (b, index, k)
+	 && index->checkpoints[k + 1].count <= charpos)
+    k++;
+  return k;
+}
+
+/* Likewise, for the checkpoint at or before BYTEPOS.  */
+
+static ptrdiff_t
+bytepos_checkpoint (struct buffer *b, struct text_index *index,
+		    ptrdiff_t bytepos, ptrdiff_t below, ptrdiff_t above)
+{
+  ptrdiff_t k = text_index_upto (index, bytepos) - 1;
+  if (index->checkpoints[k].bytepos < below - (above - below))
+    return -1;
+  while (text_index_split (b, index, k)
+	 && index->checkpoints[k + 1].bytepos <= bytepos)
+    k++;
+  return k;
+}
+
 /* Converting between character positions and byte positions.  */
 
 /* There are several places in the buffer where we know
@@ -161,6 +481,8 @@ ptrdiff_t
 buf_charpos_to_bytepos (struct buffer *b, ptrdiff_t charpos)
 {
   struct Lisp_Marker *tail;
+  struct text_index *index;
+  ptrdiff_t k;
   ptrdiff_t best_above, best_above_byte;
   ptrdiff_t best_below, best_below_byte;
   ptrdiff_t distance = BYTECHAR_DISTANCE_INITIAL;
@@ -196,7 +518,21 @@ buf_charpos_to_bytepos (struct buffer *b, ptrdiff_t charpos)
   if (b == cached_buffer && BUF_MODIFF (b) == cached_modiff)
     CONSIDER (cached_charpos, cached_bytepos);
 
-  for (tail = BUF_MARKERS (b); tail; tail = tail->next)
+  /* In a large buffer, the checkpoints on either side of CHARPOS are
+     close enough that the markers need not be looked at.  */
+  index = charpos_index_for (b, best_below_byte, best_above_byte);
+  k = (index
+       ? charpos_checkpoint (b, index, charpos,
+			     best_below_byte, best_above_byte)
+       : -1);
+  if (k >= 0)
+    {
+      struct text_checkpoint *c = index->checkpoints;
+      CONSIDER (c[k].count, c[k].bytepos);
+      if (k + 1 < index->used)
+	CONSIDER (c[k + 1].count, c[k + 1].bytepos);
+    }
+  for (tail = k < 0 ? BUF_MARKERS (b) : NULL; tail; tail = tail->next)
     {
       CONSIDER (tail->charpos, tail->bytepos);
 
@@ -317,6 +653,8 @@ ptrdiff_t
 buf_bytepos_to_charpos (struct buffer *b, ptrdiff_t bytepos)
 {
   struct Lisp_Marker *tail;
+  struct text_index *index;
+  ptrdiff_t k;
   ptrdiff_t best_above, best_above_byte;
   ptrdiff_t best_below, best_below_byte;
   ptrdiff_t distance = BYTECHAR_DISTANCE_INITIAL;
@@ -347,7 +685,19 @@ buf_bytepos_to_charpos (struct buffer *b, ptrdiff_t bytepos)
   if (b == cached_buffer && BUF_MODIFF (b) == cached_modiff)
     CONSIDER (cached_bytepos, cached_charpos);
 
-  for (tail = BUF_MARKERS (b); tail; tail = tail->next)
+  index = charpos_index_for (b, best_below_byte, best_above_byte);
+  k = (index
+       ? bytepos_checkpoint (b, index, bytepos,
+			     best_below_byte, best_above_byte)
+       : -1);
+  if (k >= 0)
+    {
+      struct text_checkpoint *c = index->checkpoints;
+      CONSIDER (c[k].bytepos, c[k].count);
+      if (k + 1 < index->used)
+	CONSIDER (c[k + 1].bytepos, c[k + 1].count);
+    }
+  for (tail = k < 0 ? BUF_MARKERS (b) : NULL; tail; tail = tail->next)
     {
       CONSIDER (tail->bytepos, tail->charpos);
 
@@ -185,13 +185,31 @@ ptrdiff_t emacs_re_safe_alloca = MAX_ALLOCA;
 /* Type of source-pattern and string chars.  */
 typedef const unsigned char re_char;
 
+/* How much work a call to re_match_2_internal may do before giving
+   up.  See CHECK_BACKTRACK_BUDGET.  */
+struct re_backtrack_budget
+{
+  /* The number of times the matcher has backtracked or looped.  */
+  ptrdiff_t steps;
+
+  /* The position from which to count the text examined.  */
+  ptrdiff_t base;
+};
+
 static void re_compile_fastmap (struct re_pattern_buffer *);
 static ptrdiff_t re_match_2_internal (struct re_pattern_buffer *bufp,
 				     re_char *string1, ptrdiff_t size1,
 				     re_char *string2, ptrdiff_t size2,
 				     ptrdiff_t pos,
 				     struct re_registers *regs,
-				     ptrdiff_t stop);
+				     ptrdiff_t stop,
+				     struct re_backtrack_budget *budget);
+static ptrdiff_t re_search_nfa (struct re_pattern_buffer *bufp,
+			       re_char *string1, ptrdiff_t size1,
+			       re_char *string2, ptrdiff_t size2,
+			       ptrdiff_t pos, ptrdiff_t range,
+			       struct re_registers *regs, ptrdiff_t stop,
+			       ptrdiff_t *endp);
 
 /* These are the command codes that appear in compiled regular
    expressions.  Some opcodes are followed by argument bytes.  A
@@ -1167,6 +1185,10 @@ static bool at_endline_loc_p (re_char *p, re_char *pend);
 static re_char *skip_one_char (re_char *p);
 static int analyze_first (re_char *p, re_char *pend,
 			  char *fastmap, bool multibyte);
+struct nfa_insn;
+static ptrdiff_t build_nfa (struct re_pattern_buffer *bufp,
+			   bool target_multibyte, struct nfa_insn *prog,
+			   ptrdiff_t *map);
 
 /* Fetch the next character in the uncompiled pattern, with no
    translation.  */
@@ -2659,6 +2681,9 @@ regex_compile (re_char *pattern, ptrdiff_t size,
 
   /* Success; set the length of the buffer.  */
   bufp->used = b - bufp->buffer;
+  bufp->nfa_compatible
+    = (!posix_backtracking
+       && 0 <= build_nfa (bufp, false, NULL, NULL));
 
 #ifdef REGEX_EMACS_DEBUG
   if (regex_emacs_debug > 0)
@@ -3110,14 +3135,16 @@ analyze_first (re_char *p, re_char *pend, char *fastmap, bool multibyte)
    The caller must supply the address of a (1 << BYTEWIDTH)-byte data
    area as BUFP->fastmap.
 
-   Set the 'fastmap', 'fastmap_accurate', and 'can_be_null' fields in
-   the pattern buffer.  */
+   Set the 'fastmap', 'fastmap_accurate', 'can_be_null',
+   'start_bytes_count' and 'start_bytes' fields in the pattern
+   buffer.  */
 
 static void
 re_compile_fastmap (struct re_pattern_buffer *bufp)
 {
   char *fastmap = bufp->fastmap;
-  int analysis;
+  Lisp_Object translate = bufp->translate;
+  int analysis, count = 0;
 
   eassert (fastmap && bufp->buffer);
 
@@ -3129,8 +3156,157 @@ re_compile_fastmap (struct re_pattern_buffer *bufp)
   analysis = analyze_first (bufp->buffer, bufp->buffer + bufp->used,
 			    fastmap, RE_MULTIBYTE_P (bufp));
   bufp->can_be_null = (analysis != 0);
+
+  /* Find the ASCII characters that can start a match.  An ASCII
+     character of the text is looked up in the fastmap after
+     translation, as itself whether the text is multibyte or not.  */
+  for (int c = 0; c < 0x80 && 0 <= count; c++)
+    {
+      int translated = TRANSLATE (c);
+      if (!ASCII_CHAR_P (translated))
+	count = -1;
+      else if (fastmap[translated])
+	{
+	  if (count < RE_MAX_START_BYTES)
+	    bufp->start_bytes[count++] = c;
+	  else
+	    count = -1;
+	}
+    }
+  bufp->start_bytes_count = count;
 } /* re_compile_fastmap */
+
+/* Return the number of bytes from D, at most LEN, that are ASCII
+   characters that cannot start a match for BUFP, whose fastmap is
+   accurate.  Look at a word at a time as long as possible, so that
+   plain ASCII text is skipped quickly.  */
+
+static ptrdiff_t
+skip_ascii_nonstarters (struct re_pattern_buffer *bufp, re_char *d,
+			ptrdiff_t len)
+{
+  int count = bufp->start_bytes_count;
+  unsigned char const *bytes = bufp->start_bytes;
+  uint64_t const ones = 0x0101010101010101;
+  uint64_t const highs = ones << 7;
+  ptrdiff_t i = 0;
+
+  eassume (0 <= count && count <= RE_MAX_START_BYTES);
+
+  /* A word has a byte that is non-ASCII or one of BYTES if it has a
+     byte with the high bit set, or if it has a zero byte after
+     being XORed with that one repeated.  */
+  for (; i <= len - 8; i += 8)
+    {
+      uint64_t w;
+      memcpy (&w, d + i, sizeof w);
+      uint64_t found = w;
+      for (int j = 0; j < count; j++)
+	{
+	  uint64_t v = w ^ (bytes[j] * ones);
+	  found |= (v - ones) & ~v;
+	}
+      if (found & highs)
+	break;
+    }
+
+  for (; i < len && ASCII_CHAR_P (d[i]); i++)
+    for (int j = 0; j < count; j++)
+      if (d[i] == bytes[j])
+	return i;
+  return i;
+}
 
+/* Return how many bytes at D, the start of RANGE bytes of text, cannot
+   start a match for BUFP according to its fastmap, stopping when there
+   are only LIM bytes left.  Search forward only.  */
+
+static ptrdiff_t
+skip_nonstarters (struct re_pattern_buffer *bufp, re_char *d,
+		  ptrdiff_t range, ptrdiff_t lim)
+{
+  char *fastmap = bufp->fastmap;
+  Lisp_Object translate = bufp->translate;
+  bool multibyte = RE_TARGET_MULTIBYTE_P (bufp);
+  bool skip_ascii = 0 <= bufp->start_bytes_count;
+  ptrdiff_t irange = range;
+  int buf_ch;
+
+  /* Skip the ASCII characters that cannot start a match a word at a
+     time, and stop if what follows them is an ASCII character that
+     can.  */
+#define SKIP_ASCII_NONSTARTERS()					\
+  (skip_ascii && ASCII_CHAR_P (*d)					\
+   && (skip = skip_ascii_nonstarters (bufp, d, range - lim),		\
+       d += skip, range -= skip,					\
+       range == lim || ASCII_CHAR_P (*d)))
+  ptrdiff_t skip;
+
+  /* Written out as an if-else to avoid testing 'translate' inside the
+     loop.  */
+  if (!NILP (translate))
+    {
+      if (multibyte)
+	while (range > lim)
+	  {
+	    int buf_charlen;
+
+	    if (SKIP_ASCII_NONSTARTERS ())
+	      break;
+	    buf_ch = string_char_and_length (d, &buf_charlen);
+	    buf_ch = RE_TRANSLATE (translate, buf_ch);
+	    if (fastmap[CHAR_LEADING_CODE (buf_ch)])
+	      break;
+
+	    range -= buf_charlen;
+	    d += buf_charlen;
+	  }
+      else
+	while (range > lim)
+	  {
+	    if (SKIP_ASCII_NONSTARTERS ())
+	      break;
+	    buf_ch = *d;
+	    int ch = RE_CHAR_TO_MULTIBYTE (buf_ch);
+	    int translated = RE_TRANSLATE (translate, ch);
+	    if (translated != ch
+		&& (ch = RE_CHAR_TO_UNIBYTE (translated)) >= 0)
+	      buf_ch = ch;
+	    if (fastmap[buf_ch])
+	      break;
+	    d++;
+	    range--;
+	  }
+    }
+  else
+    {
+      if (multibyte)
+	while (range > lim)
+	  {
+	    int buf_charlen;
+
+	    if (SKIP_ASCII_NONSTARTERS ())
+	      break;
+	    /* The leading code of a character is its first byte.  */
+	    if (fastmap[*d])
+	      break;
+	    buf_charlen = BYTES_BY_CHAR_HEAD (*d);
+	    range -= buf_charlen;
+	    d += buf_charlen;
+	  }
+      else
+	while (range > lim)
+	  {
+	    if (SKIP_ASCII_NONSTARTERS () || fastmap[*d])
+	      break;
+	    d++;
+	    range--;
+	  }
+    }
+#undef SKIP_ASCII_NONSTARTERS
+  return irange - range;
+}
+
 /* Set REGS to hold NUM_REGS registers, storing them in STARTS and
    ENDS.  Subsequent matches using PATTERN_BUFFER and REGS will use
    this memory for recording register information.  STARTS and ENDS
@@ -3201,6 +3377,32 @@ re_search (struct re_pattern_buffer *bufp, const char *string, ptrdiff_t size,
    found, -1 if no match, or -2 if error (such as failure
    stack overflow).  */
 
+/* Return the position of the first newline from FROM up to but not
+   including TO in the virtual concatenation of STRING1 and STRING2,
+   whose sizes are SIZE1 and SIZE2, or -1 if there is none.  */
+
+static ptrdiff_t
+find_newline_in_strings (re_char *string1, ptrdiff_t size1,
+			 re_char *string2, ptrdiff_t size2,
+			 ptrdiff_t from, ptrdiff_t to)
+{
+  if (from < size1)
+    {
+      ptrdiff_t end = min (to, size1);
+      re_char *nl = memchr (string1 + from, '\n', end - from);
+      if (nl)
+	return nl - string1;
+      from = size1;
+    }
+  if (from < to)
+    {
+      re_char *nl = memchr (string2 + from - size1, '\n', to - from);
+      if (nl)
+	return nl - string2 + size1;
+    }
+  return -1;
+}
+
 ptrdiff_t
 re_search_2 (struct re_pattern_buffer *bufp, const char *str1, ptrdiff_t size1,
 	     const char *str2, ptrdiff_t size2,
@@ -3217,6 +3419,7 @@ re_search_2 (struct re_pattern_buffer *bufp, const char *str1, ptrdiff_t size1,
   bool anchored_start;
   /* Nonzero if we are searching multibyte string.  */
   bool multibyte = RE_TARGET_MULTIBYTE_P (bufp);
+  struct re_backtrack_budget budget = { .base = startpos };
 
   /* Check for out-of-range STARTPOS.  */
   if (startpos < 0 || startpos > total_size)
@@ -3272,9 +3475,22 @@ re_search_2 (struct re_pattern_buffer *bufp, const char *str1, ptrdiff_t size1,
 	 because that case doesn't repeat.  */
       if (anchored_start && startpos > 0)
 	{
-	  if (! ((startpos <= size1 ? string1[startpos - 1]
-		  : string2[startpos - size1 - 1])
-		 == '\n'))
+	  if (range > 0)
+	    {
+	      /* Go to the start of the next line, if there is one
+		 before the end of the range.  */
+	      ptrdiff_t nl = find_newline_in_strings (string1, size1,
+						      string2, size2,
+						      startpos - 1,
+						      startpos + range);
+	      if (nl < 0)
+		return -1;
+	      range -= nl + 1 - startpos;
+	      startpos = nl + 1;
+	    }
+	  else if (! ((startpos <= size1 ? string1[startpos - 1]
+		       : string2[startpos - size1 - 1])
+		      == '\n'))
 	    goto advance;
 	}
 
@@ -3291,64 +3507,12 @@ re_search_2 (struct re_pattern_buffer *bufp, const char *str1, ptrdiff_t size1,
 
 	  if (range > 0)	/* Searching forwards.  */
 	    {
-	      ptrdiff_t irange = range, lim = 0;
-
+	      ptrdiff_t lim = 0;
 	      if (startpos < size1 && startpos + range >= size1)
 		lim = range - (size1 - startpos);
-
-	      /* Written out as an if-else to avoid testing 'translate'
-		 inside the loop.  */
-	      if (!NILP (translate))
-		{
-		  if (multibyte)
-		    while (range > lim)
-		      {
-			int buf_charlen;
-
-			buf_ch = string_char_and_length (d, &buf_charlen);
-			buf_ch = RE_TRANSLATE (translate, buf_ch);
-			if (fastmap[CHAR_LEADING_CODE (buf_ch)])
-			  break;
-
-			range -= buf_charlen;
-			d += buf_charlen;
-		      }
-		  else
-		    while (range > lim)
-		      {
-			buf_ch = *d;
-			int ch = RE_CHAR_TO_MULTIBYTE (buf_ch);
-			int translated = RE_TRANSLATE (translate, ch);
-			if (translated != ch
-			    && (ch = RE_CHAR_TO_UNIBYTE (translated)) >= 0)
-			  buf_ch = ch;
-			if (fastmap[buf_ch])
-			  break;
-			d++;
-			range--;
-		      }
-		}
-	      else
-		{
-		  if (multibyte)
-		    while (range > lim)
-		      {
-			int buf_charlen;
-
-			buf_ch = string_char_and_length (d, &buf_charlen);
-			if (fastmap[CHAR_LEADING_CODE (buf_ch)])
-			  break;
-			range -= buf_charlen;
-			d += buf_charlen;
-		      }
-		  else
-		    while (range > lim && !fastmap[*d])
-		      {
-			d++;
-			range--;
-		      }
-		}
-	      startpos += irange - range;
+	      ptrdiff_t skip = skip_nonstarters (bufp, d, range, lim);
+	      startpos += skip;
+	      range -= skip;
 	    }
 	  else				/* Searching backwards.  */
 	    {
@@ -3378,13 +3542,32 @@ re_search_2 (struct re_pattern_buffer *bufp, const char *str1, ptrdiff_t size1,
 	  && !bufp->can_be_null)
 	return -1;
 
+      /* A forward search shares one budget among all the starting
+	 positions, so as to notice when it takes quadratic time.  */
+      if (range < 0)
+	budget = (struct re_backtrack_budget) { .base = startpos };
+
       val = re_match_2_internal (bufp, string1, size1, string2, size2,
-				 startpos, regs, stop);
+				 startpos, regs, stop,
+				 bufp->nfa_compatible ? &budget : NULL);
 
       if (val >= 0)
 	return startpos;
 
-      if (val == -2)
+      if (val < -1 && bufp->nfa_compatible)
+	{
+	  /* Backtracking took too long or overflowed the failure
+	     stack; match without it.  */
+	  ptrdiff_t end;
+	  if (range > 0)
+	    return re_search_nfa (bufp, string1, size1, string2, size2,
+				  startpos, range, regs, stop, &end);
+	  if (re_search_nfa (bufp, string1, size1, string2, size2,
+			     startpos, 0, regs, stop, &end)
+	      >= 0)
+	    return startpos;
+	}
+      else if (val == -2)
 	return -2;
 
     advance:
@@ -3429,6 +3612,223 @@ re_search_2 (struct re_pattern_buffer *bufp, const char *str1, ptrdiff_t size1,
     }
   return -1;
 } /* re_search_2 */
+
+/* Return the index into the fastmap of BUFP for the character at D.  */
+
+static int
+fastmap_index (struct re_pattern_buffer *bufp, re_char *d)
+{
+  Lisp_Object translate = bufp->translate;
+
+  if (RE_TARGET_MULTIBYTE_P (bufp))
+    return (NILP (translate) ? *d
+	    : CHAR_LEADING_CODE (RE_TRANSLATE (translate, STRING_CHAR (d))));
+
+  int buf_ch = *d;
+  if (!NILP (translate))
+    {
+      int ch = RE_CHAR_TO_MULTIBYTE (buf_ch);
+      int translated = RE_TRANSLATE (translate, ch);
+      if (translated != ch
+	  && (ch = RE_CHAR_TO_UNIBYTE (translated)) >= 0)
+	buf_ch = ch;
+    }
+  return buf_ch;
+}
+
+/* Like re_search_2 with a RANGE that is not negative, but search for
+   any of the N patterns in BUFPS, and store in *WHICH the index of
+   the one that matched.  Where several patterns match at the same
+   place, the first of them wins.  All the patterns must have the same
+   translate table and the same kind of target.
+
+   The text is scanned only once: the union of the fastmaps of the
+   patterns is used to skip places where none of them can match, and
+   at the other places only the patterns whose own fastmap allows it
+   are tried.  Patterns that start with '^' or '\\`' are left out of
+   the union and only tried where they can match.  */
+
+ptrdiff_t
+re_search_multi (struct re_pattern_buffer **bufps, ptrdiff_t n,
+		 const char *str1, ptrdiff_t size1,
+		 const char *str2, ptrdiff_t size2,
+		 ptrdiff_t startpos, ptrdiff_t range,
+		 struct re_registers *regs, ptrdiff_t stop,
+		 ptrdiff_t *which)
+{
+  re_char *string1 = (re_char *) str1;
+  re_char *string2 = (re_char *) str2;
+  ptrdiff_t total_size = size1 + size2;
+  char fastmap[0400];
+  /* A pattern buffer that stands for the unanchored patterns in BUFPS
+     when skipping text.  */
+  struct re_pattern_buffer any =
+    {
+      .fastmap = fastmap,
+      .translate = bufps[0]->translate,
+      .target_multibyte = bufps[0]->target_multibyte,
+      .start_bytes_count = 0
+    };
+  bool multibyte = RE_TARGET_MULTIBYTE_P (&any);
+  /* Whether some patterns start with '^', and whether some start with
+     '\\`' or '^' and can match the empty string.  */
+  bool anchored_line = false, anchored_null = false;
+
+  eassert (0 <= range);
+  if (startpos < 0 || startpos > total_size)
+    return -1;
+  range = min (range, total_size - startpos);
+
+  memset (fastmap, 0, sizeof fastmap);
+  for (ptrdiff_t i = 0; i < n; i++)
+    {
+      struct re_pattern_buffer *bufp = bufps[i];
+      re_opcode_t op = bufp->used > 0 ? bufp->buffer[0] : succeed;
+
+      eassert (EQ (bufp->translate, any.translate)
+	       && bufp->target_multibyte == any.target_multibyte);
+      if (bufp->fastmap && !bufp->fastmap_accurate)
+	re_compile_fastmap (bufp);
+      if (op == begline || op == begbuf)
+	{
+	  /* These need only stop the skipping at the start of a
+	     line.  */
+	  anchored_line |= op == begline;
+	  anchored_null |= !bufp->fastmap || bufp->can_be_null;
+	  continue;
+	}
+      if (!bufp->fastmap || bufp->can_be_null)
+	{
+	  any.can_be_null = true;
+	  continue;
+	}
+      for (int c = 0; c < 0400; c++)
+	fastmap[c] |= bufp->fastmap[c];
+
+      /* Merge the start bytes, giving up if there are too many.  */
+      if (bufp->start_bytes_count < 0)
+	any.start_bytes_count = -1;
+      for (int j = 0; j < bufp->start_bytes_count; j++)
+	if (0 <= any.start_bytes_count
+	    && !memchr (any.start_bytes, bufp->start_bytes[j],
+			any.start_bytes_count))
+	  {
+	    if (any.start_bytes_count == RE_MAX_START_BYTES)
+	      any.start_bytes_count = -1;
+	    else
+	      any.start_bytes[any.start_bytes_count++]
+		= bufp->start_bytes[j];
+	  }
+    }
+
+  /* Stop at newlines, so as to try the patterns that start with '^'
+     after them.  */
+  if (anchored_line)
+    {
+      fastmap['\n'] = 1;
+      if (0 <= any.start_bytes_count
+	  && !memchr (any.start_bytes, '\n', any.start_bytes_count))
+	{
+	  if (any.start_bytes_count == RE_MAX_START_BYTES)
+	    any.start_bytes_count = -1;
+	  else
+	    any.start_bytes[any.start_bytes_count++] = '\n';
+	}
+    }
+
+  gl_state.object = re_match_object; /* Used by SYNTAX_TABLE_BYTE_TO_CHAR. */
+  {
+    ptrdiff_t charpos = SYNTAX_TABLE_BYTE_TO_CHAR (POS_AS_IN_BUFFER (startpos));
+
+    SETUP_SYNTAX_TABLE_FOR_OBJECT (re_match_object, charpos, 1);
+  }
+
+  for (;;)
+    {
+      bool bol = (startpos == 0
+		  || (startpos <= size1 ? string1[startpos - 1]
+		      : string2[startpos - size1 - 1]) == '\n');
+
+      /* Skip the text where no unanchored pattern can match, unless
+	 an anchored one can match here.  */
+      if (startpos < total_size && !any.can_be_null
+	  && ! (bol && (anchored_line || startpos == 0)))
+	{
+	  ptrdiff_t lim = 0;
+	  if (startpos < size1 && startpos + range >= size1)
+	    lim = range - (size1 - startpos);
+	  ptrdiff_t skip = skip_nonstarters (&any, POS_ADDR_VSTRING (startpos),
+					     range, lim);
+	  startpos += skip;
+	  range -= skip;
+	  /* Skipping stops at a newline rather than after it.  */
+	  bol &= skip == 0;
+	}
+
+      /* If none can match the null string, and that's all we have
+	 left, fail.  */
+      if (startpos == total_size && !any.can_be_null
+	  && ! (bol && anchored_null))
+	return -1;
+
+      int c = (startpos < total_size
+	       ? fastmap_index (&any, POS_ADDR_VSTRING (startpos)) : -1);
+
+      for (ptrdiff_t i = 0; i < n; i++)
+	{
+	  struct re_pattern_buffer *bufp = bufps[i];
+	  re_opcode_t op = bufp->used > 0 ? bufp->buffer[0] : succeed;
+	  if ((op == begline && !bol) || (op == begbuf && startpos > 0))
+	    continue;
+	  if (! (!bufp->fastmap || bufp->can_be_null
+		 || (0 <= c && bufp->fastmap[c])))
+	    continue;
+
+	  /* There is no sharing the budget among the starting positions
+	     here, since a pattern that takes too long can only be
+	     matched without backtracking at one position at a time.  */
+	  struct re_backtrack_budget budget = { .base = startpos };
+	  ptrdiff_t val = re_match_2_internal (bufp, string1, size1,
+					       string2, size2, startpos,
+					       regs, stop,
+					       (bufp->nfa_compatible
+						? &budget : NULL));
+	  if (val < -1 && bufp->nfa_compatible)
+	    {
+	      ptrdiff_t end;
+	      val = re_search_nfa (bufp, string1, size1, string2, size2,
+				   startpos, 0, regs, stop, &end);
+	    }
+	  if (val >= 0)
+	    {
+	      *which = i;
+	      return startpos;
+	    }
+	  if (val == -2)
+	    return -2;
+	}
+
+      if (!range)
+	break;
+
+      /* Update STARTPOS to the next character boundary.  */
+      if (multibyte)
+	{
+	  int len = BYTES_BY_CHAR_HEAD (*POS_ADDR_VSTRING (startpos));
+
+	  range -= len;
+	  if (range < 0)
+	    break;
+	  startpos += len;
+	}
+      else
+	{
+	  range--;
+	  startpos++;
+	}
+    }
+  return -1;
+}
 
 /* Declarations and macros for re_match_2.  */
 
@@ -3852,9 +4252,20 @@ re_match_2 (struct re_pattern_buffer *bufp,
   charpos = SYNTAX_TABLE_BYTE_TO_CHAR (POS_AS_IN_BUFFER (pos));
   SETUP_SYNTAX_TABLE_FOR_OBJECT (re_match_object, charpos, 1);
 
+  struct re_backtrack_budget budget = { .base = pos };
   result = re_match_2_internal (bufp, (re_char *) string1, size1,
 				(re_char *) string2, size2,
-				pos, regs, stop);
+				pos, regs, stop,
+				bufp->nfa_compatible ? &budget : NULL);
+  if (result < -1 && bufp->nfa_compatible)
+    {
+      ptrdiff_t end;
+      result = re_search_nfa (bufp, (re_char *) string1, size1,
+			      (re_char *) string2, size2,
+			      pos, 0, regs, stop, &end);
+      if (result >= 0)
+	result = end - pos;
+    }
   return result;
 }
 
@@ -3865,13 +4276,68 @@ unwind_re_match (void *ptr)
   b->text->inhibit_shrinking = 0;
 }
 
+/* Make sure REGS has room for NUM_REGS registers, allocating or
+   growing its arrays as BUFP->regs_allocated says.  */
+static void
+allocate_registers (struct re_pattern_buffer *bufp,
+		    struct re_registers *regs, ptrdiff_t num_regs)
+{
+  /* Have the register data arrays been allocated?	*/
+  if (bufp->regs_allocated == REGS_UNALLOCATED)
+    { /* No.  So allocate them with malloc.  */
+      ptrdiff_t n = max (RE_NREGS, num_regs);
+      regs->start = xnmalloc (n, sizeof *regs->start);
+      regs->end = xnmalloc (n, sizeof *regs->end);
+      regs->num_regs = n;
+      bufp->regs_allocated = REGS_REALLOCATE;
+    }
+  else if (bufp->regs_allocated == REGS_REALLOCATE)
+    { /* Yes.  If we need more elements than were already
+	 allocated, reallocate them.  If we need fewer, just
+	 leave it alone.  */
+      ptrdiff_t n = regs->num_regs;
+      if (n < num_regs)
+	{
+	  n = max (n + (n >> 1), num_regs);
+	  regs->start = xnrealloc (regs->start, n, sizeof *regs->start);
+	  regs->end = xnrealloc (regs->end, n, sizeof *regs->end);
+	  regs->num_regs = n;
+	}
+    }
+  else
+    eassert (bufp->regs_allocated == REGS_FIXED);
+}
+
+/* The backtracking matcher gives up on a pattern when it has
+   backtracked or looped more than this many times, plus the size of
+   the pattern for each byte of text examined.  */
+enum { RE_BACKTRACK_MIN_STEPS = 100000 };
+
+/* Count one step against BUDGET, and return -3 if it is exhausted.  */
+#define CHECK_BACKTRACK_BUDGET()					\
+  do {									\
+    if (budget && ++budget->steps > RE_BACKTRACK_MIN_STEPS		\
+	&& ((budget->steps - RE_BACKTRACK_MIN_STEPS) / bufp->used	\
+	    > POINTER_TO_OFFSET (d) - budget->base))			\
+      {									\
+	unbind_to (count, Qnil);					\
+	SAFE_FREE ();							\
+	return -3;							\
+      }									\
+  } while (false)
+
 /* This is a separate function so that we can force an alloca cleanup
-   afterwards.  */
+   afterwards.
+
+   If BUDGET is non-null, return -3 when the match has taken too many
+   steps for the text it has examined since BUDGET->base; see
+   CHECK_BACKTRACK_BUDGET.  */
 static ptrdiff_t
 re_match_2_internal (struct re_pattern_buffer *bufp,
 		     re_char *string1, ptrdiff_t size1,
 		     re_char *string2, ptrdiff_t size2,
-		     ptrdiff_t pos, struct re_registers *regs, ptrdiff_t stop)
+		     ptrdiff_t pos, struct re_registers *regs, ptrdiff_t stop,
+		     struct re_backtrack_budget *budget)
 {
   eassume (0 <= size1);
   eassume (0 <= size2);
@@ -4143,31 +4609,7 @@ re_match_2_internal (struct re_pattern_buffer *bufp,
 	  /* If caller wants register contents data back, do it.  */
 	  if (regs)
 	    {
-	      /* Have the register data arrays been allocated?	*/
-	      if (bufp->regs_allocated == REGS_UNALLOCATED)
-		{ /* No.  So allocate them with malloc.  */
-		  ptrdiff_t n = max (RE_NREGS, num_regs);
-		  regs->start = xnmalloc (n, sizeof *regs->start);
-		  regs->end = xnmalloc (n, sizeof *regs->end);
-		  regs->num_regs = n;
-		  bufp->regs_allocated = REGS_REALLOCATE;
-		}
-	      else if (bufp->regs_allocated == REGS_REALLOCATE)
-		{ /* Yes.  If we need more elements than were already
-		     allocated, reallocate them.  If we need fewer, just
-		     leave it alone.  */
-		  ptrdiff_t n = regs->num_regs;
-		  if (n < num_regs)
-		    {
-		      n = max (n + (n >> 1), num_regs);
-		      regs->start
-			= xnrealloc (regs->start, n, sizeof *regs->start);
-		      regs->end = xnrealloc (regs->end, n, sizeof *regs->end);
-		      regs->num_regs = n;
-		    }
-		}
-	      else
-		eassert (bufp->regs_allocated == REGS_FIXED);
+	      allocate_registers (bufp, regs, num_regs);
 
 	      /* Convert the pointer data in 'regstart' and 'regend' to
 		 indices.  Register zero has to be set differently,
@@ -4688,6 +5130,7 @@ re_match_2_internal (struct re_pattern_buffer *bufp,
 	case jump:
 	unconditional_jump:
 	  maybe_quit ();
+	  CHECK_BACKTRACK_BUDGET ();
 	  EXTRACT_NUMBER_AND_INCR (mcnt, p);	/* Get the amount to jump.  */
 	  DEBUG_PRINT ("EXECUTING jump %d ", mcnt);
 	  p += mcnt;				/* Do the jump.  */
@@ -5011,6 +5454,7 @@ re_match_2_internal (struct re_pattern_buffer *bufp,
     /* We goto here if a matching operation fails. */
     fail:
       maybe_quit ();
+      CHECK_BACKTRACK_BUDGET ();
       if (!FAIL_STACK_EMPTY ())
 	{
 	  re_char *str, *pat;
@@ -5094,6 +5538,921 @@ bcmp_translate (re_char *s1, re_char *s2, ptrdiff_t len,
 
   return p1 != p1_end || p2 != p2_end;
 }
+
+
+/* Matching without backtracking.  */
+
+/* re_match_2_internal can take time exponential in the length of the
+   text for patterns like "\\(a\\|aa\\)*c", and a search can take time
+   quadratic in it for patterns like "a*b".  When that happens,
+   re_search_2 and re_match_2 redo the work here instead, by
+   simulating the pattern as a nondeterministic automaton, one
+   character at a time, in the way of Thompson's construction and
+   Pike's VM.  The threads of the automaton are kept in the order in
+   which the backtracking matcher would try them, so that the result,
+   groups included, is the same.
+
+   When the backtracking matcher comes back to a loop whose body can
+   match the empty string without having moved, it leaves the loop
+   (see CHECK_INFINITE_LOOP).  So what a thread can do next depends
+   not only on its instruction but also on the loops it has entered
+   at the current position, and threads are told apart by both.  The
+   cost is thus proportional to the product of the sizes of the
+   pattern and of the text examined, times a small factor for nested
+   loops of that kind.
+
+   Patterns with back references, counted repetitions (whose counters
+   live in the pattern itself), POSIX backtracking, or more than
+   NFA_MAX_LOOPS loops that can match the empty string cannot be
+   simulated this way; regex_compile records which patterns can in
+   BUFP->nfa_compatible.  */
+
+enum
+  {
+    /* The maximum number of on_failure_jump_loop and
+       on_failure_jump_nastyloop commands in a pattern.  */
+    NFA_MAX_LOOPS = 64,
+
+    /* How many sets of loops to tell apart at each instruction.  */
+    NFA_MAX_VISITS = 8
+  };
+
+/* An instruction of the automaton.  */
+struct nfa_insn
+{
+  /* The pattern command it comes from.  exactn, anychar, charset,
+     charset_not and the syntax and category specs consume a
+     character; start_memory and stop_memory record the position;
+     jump and the on_failure_jump variants branch; succeed accepts
+     the match; the remaining commands are assertions about the
+     position.  Each exactn instruction matches one character.  */
+  re_opcode_t op;
+
+  /* The character to match for exactn, the register number for
+     start_memory and stop_memory, the syntax or category code, or
+     the number of the loop for on_failure_jump_loop and
+     on_failure_jump_nastyloop.  */
+  int arg;
+
+  /* The charset or charset_not command, for charsets.  */
+  re_char *set;
+
+  /* The instruction to go to next; for branches, the one preferred
+     by the backtracking matcher.  */
+  ptrdiff_t x;
+
+  /* For on_failure_jump and its variants, the other instruction.  */
+  ptrdiff_t y;
+};
+
+/* Translate the compiled pattern in BUFP into automaton instructions,
+   and return their number, or -1 if the pattern cannot be simulated.
+   TARGET_MULTIBYTE is as in the pattern buffer.  If PROG is null,
+   just count the instructions.  Otherwise store them in PROG, using
+   MAP, an array with one element per byte of the pattern plus one,
+   all initialized to -1.  */
+
+static ptrdiff_t
+build_nfa (struct re_pattern_buffer *bufp, bool target_multibyte,
+	   struct nfa_insn *prog, ptrdiff_t *map)
+{
+  re_char *start = bufp->buffer, *p = start, *pend = start + bufp->used;
+  bool multibyte = RE_MULTIBYTE_P (bufp);
+  ptrdiff_t n = 0;
+  int nloops = 0;
+
+#define EMIT_NFA_INSN(OP, ARG, SET, TARGET)				\
+  do {									\
+    if (prog)								\
+      prog[n] = (struct nfa_insn) { .op = (OP), .arg = (ARG),		\
+				    .set = (SET), .x = n + 1,		\
+				    .y = (TARGET) };			\
+    n++;								\
+  } while (false)
+
+  while (p < pend)
+    {
+      re_opcode_t op = *p;
+      int mcnt;
+
+      if (map)
+	map[p - start] = n;
+      p++;
+
+      switch (op)
+	{
+	case no_op:
+	  break;
+
+	case exactn:
+	  {
+	    re_char *end = p + 1 + *p;
+	    for (p++; p < end; )
+	      {
+		int c, len;
+		if (multibyte)
+		  c = string_char_and_length (p, &len);
+		else
+		  {
+		    c = *p;
+		    len = 1;
+		  }
+		if (target_multibyte)
+		  c = multibyte ? c : RE_CHAR_TO_MULTIBYTE (c);
+		else
+		  c = multibyte ? RE_CHAR_TO_UNIBYTE (c) : c;
+		EMIT_NFA_INSN (exactn, c, NULL, -1);
+		p += len;
+	      }
+	  }
+	  break;
+
+	case charset:
+	case charset_not:
+	  EMIT_NFA_INSN (op, 0, p - 1, -1);
+	  p = skip_one_char (p - 1);
+	  break;
+
+	case syntaxspec:
+	case notsyntaxspec:
+	case categoryspec:
+	case notcategoryspec:
+	case start_memory:
+	case stop_memory:
+	  EMIT_NFA_INSN (op, *p, NULL, -1);
+	  p++;
+	  break;
+
+	case succeed:
+	case anychar:
+	case begline:
+	case endline:
+	case begbuf:
+	case endbuf:
+	case wordbeg:
+	case wordend:
+	case wordbound:
+	case notwordbound:
+	case symbeg:
+	case symend:
+	case at_dot:
+	  EMIT_NFA_INSN (op, 0, NULL, -1);
+	  break;
+
+	case on_failure_jump_smart:
+	  /* Decide as re_match_2_internal does, whether or not it has
+	     already rewritten the command.  */
+	  EXTRACT_NUMBER (mcnt, p);
+	  if (prog && mutually_exclusive_p (bufp, p + 2, p + 2 + mcnt))
+	    op = on_failure_keep_string_jump;
+	  else
+	    op = on_failure_jump;
+	  FALLTHROUGH;
+	case jump:
+	case on_failure_jump:
+	case on_failure_keep_string_jump:
+	  /* Record the target as an offset in the pattern for now.  */
+	  EXTRACT_NUMBER_AND_INCR (mcnt, p);
+	  EMIT_NFA_INSN (op, 0, NULL, p + mcnt - start);
+	  break;
+
+	case on_failure_jump_loop:
+	case on_failure_jump_nastyloop:
+	  if (nloops == NFA_MAX_LOOPS)
+	    return -1;
+	  EXTRACT_NUMBER_AND_INCR (mcnt, p);
+	  EMIT_NFA_INSN (op, nloops++, NULL, p + mcnt - start);
+	  break;
+
+	case duplicate:
+	case succeed_n:
+	case jump_n:
+	case set_number_at:
+	  return -1;
+
+	default:
+	  abort ();
+	}
+    }
+
+  /* Accept at the end of the pattern, in case something jumps
+     there.  */
+  if (map)
+    map[p - start] = n;
+  EMIT_NFA_INSN (succeed, 0, NULL, -1);
+
+#undef EMIT_NFA_INSN
+
+  if (prog)
+    for (ptrdiff_t i = 0; i < n; i++)
+      {
+	struct nfa_insn *insn = &prog[i];
+	ptrdiff_t target = insn->y;
+
+	if (insn->op == jump)
+	  {
+	    /* When on_failure_jump_smart turns a loop into an
+	       on_failure_keep_string_jump loop, it retargets the jump
+	       that closes the loop to just past the
+	       on_failure_keep_string_jump.  Go back through the branch
+	       instead, so that the automaton can leave the loop.  */
+	    if (3 <= target && 0 <= map[target - 3]
+		&& start[target - 3] == on_failure_keep_string_jump)
+	      target -= 3;
+	    insn->x = map[target];
+	    insn->y = -1;
+	  }
+	else if (0 <= target)
+	  insn->y = map[target];
+      }
+
+  return n;
+}
+
+/* A set of threads of the automaton, all at the same position of the
+   text, in decreasing order of priority.  */
+struct nfa_threads
+{
+  /* The number of threads.  */
+  ptrdiff_t n;
+
+  /* The instruction each thread is at.  */
+  ptrdiff_t *pc;
+
+  /* The registers of each thread, as positions in the text or -1:
+     NCAPS elements per thread, two per register.  */
+  ptrdiff_t *caps;
+};
+
+/* What remains to do when following the branches of the automaton
+   from an instruction: follow them from instruction ARG, set register
+   slot ARG back to VALUE, or enter or leave loop number ARG.  */
+struct nfa_frame
+{
+  enum { NFA_FOLLOW, NFA_RESTORE, NFA_ENTER, NFA_LEAVE } kind;
+  ptrdiff_t arg, value;
+};
+
+/* The state of a simulation.  */
+struct nfa
+{
+  struct nfa_insn *prog;
+
+  /* Number of register slots in a thread.  */
+  ptrdiff_t ncaps;
+
+  /* REACH[PC] is the set of loops, one bit per loop, that instruction
+     PC can get to without consuming a character.  */
+  uint_least64_t *reach;
+
+  /* The loops whose bodies the thread being followed has entered at
+     the current position.  */
+  uint_least64_t loops;
+
+  /* VISITED[PC] is GENERATION if instruction PC has already been
+     reached at the current position of the text.  If so, NVISITS[PC]
+     is the number of sets of loops it has been reached with, and
+     VISIT_LOOPS[PC * NFA_MAX_VISITS] onward holds them.  */
+  ptrdiff_t *visited;
+  ptrdiff_t generation;
+  int *nvisits;
+  uint_least64_t *visit_loops;
+
+  /* Room for the frames needed to follow the branches.  */
+  struct nfa_frame *stack;
+
+  /* The text, as in re_match_2_internal.  */
+  re_char *string1, *string2;
+  ptrdiff_t size1, size2, stop;
+  bool target_multibyte;
+  Lisp_Object translate;
+
+  /* The character at position CHAR_POS of the text, or -1, in the
+     forms the various instructions compare: as it is, translated for
+     exactn, as given to execute_charset, and as given to the syntax
+     and category tables.  LEN is its length in bytes.  */
+  ptrdiff_t char_pos;
+  int len, corig, exact_ch, set_ch, after_ch;
+  bool set_unibyte;
+};
+
+/* Make NFA hold the character at POS, which must be before the stop
+   position.  */
+
+static void
+nfa_fetch_char (struct nfa *nfa, ptrdiff_t pos)
+{
+  Lisp_Object translate = nfa->translate;
+  re_char *string1 = nfa->string1, *string2 = nfa->string2;
+  ptrdiff_t size1 = nfa->size1;
+  re_char *d = POS_ADDR_VSTRING (pos);
+
+  if (nfa->char_pos == pos)
+    return;
+  nfa->char_pos = pos;
+  nfa->corig = RE_STRING_CHAR_AND_LENGTH (d, nfa->len,
+					  nfa->target_multibyte);
+  if (nfa->target_multibyte)
+    {
+      nfa->exact_ch = TRANSLATE (nfa->corig);
+      nfa->set_ch = RE_CHAR_TO_UNIBYTE (nfa->exact_ch);
+      nfa->set_unibyte = nfa->set_ch >= 0;
+      if (!nfa->set_unibyte)
+	nfa->set_ch = nfa->exact_ch;
+      nfa->after_ch = nfa->corig;
+    }
+  else
+    {
+      nfa->after_ch = RE_CHAR_TO_MULTIBYTE (*d);
+      nfa->exact_ch = nfa->set_ch = *d;
+      nfa->set_unibyte = true;
+      if (! CHAR_BYTE8_P (nfa->after_ch))
+	{
+	  int c1 = RE_CHAR_TO_UNIBYTE (TRANSLATE (nfa->after_ch));
+	  if (c1 >= 0)
+	    nfa->exact_ch = nfa->set_ch = c1;
+	  else
+	    nfa->set_unibyte = false;
+	}
+    }
+}
+
+/* Return true if INSN, which consumes a character, matches the
+   character at POS in the text of NFA.  */
+
+static bool
+nfa_char_match_p (struct nfa *nfa, struct nfa_insn *insn, ptrdiff_t pos)
+{
+  Lisp_Object translate = nfa->translate;
+
+  if (pos >= nfa->stop)
+    return false;
+  nfa_fetch_char (nfa, pos);
+
+  switch (insn->op)
+    {
+    case exactn:
+      return nfa->exact_ch == insn->arg;
+
+    case anychar:
+      return TRANSLATE (nfa->corig) != '\n';
+
+    case charset:
+    case charset_not:
+      {
+	re_char *p = insn->set;
+	return execute_charset (&p, nfa->set_ch, nfa->corig,
+				nfa->set_unibyte, translate);
+      }
+
+    case syntaxspec:
+    case notsyntaxspec:
+      {
+	UPDATE_SYNTAX_TABLE (SYNTAX_TABLE_BYTE_TO_CHAR
+			     (POS_AS_IN_BUFFER (pos)));
+	return ((SYNTAX (nfa->after_ch) == (enum syntaxcode) insn->arg)
+		== (insn->op == syntaxspec));
+      }
+
+    case categoryspec:
+    case notcategoryspec:
+      return ((! CHAR_HAS_CATEGORY (nfa->after_ch, insn->arg))
+	      != (insn->op == categoryspec));
+
+    default:
+      abort ();
+    }
+}
+
+/* Return true if the assertion OP holds at position POS in the text
+   of NFA.  This does what re_match_2_internal does for OP.  */
+
+static bool
+nfa_assertion_p (struct nfa *nfa, re_opcode_t op, ptrdiff_t pos)
+{
+  re_char *string1 = nfa->string1, *string2 = nfa->string2;
+  ptrdiff_t size1 = nfa->size1, size2 = nfa->size2;
+  re_char *end1 = string1 + size1, *end2 = string2 + size2;
+  bool target_multibyte = nfa->target_multibyte;
+  re_char *d = POS_ADDR_VSTRING (pos);
+  ptrdiff_t charpos;
+  int c1, c2, s1, s2, dummy;
+
+  switch (op)
+    {
+    case begline:
+      if (AT_STRINGS_BEG (d))
+	return true;
+      GET_CHAR_BEFORE_2 (c1, d, string1, end1, string2, end2);
+      return c1 == '\n';
+
+    case endline:
+      return AT_STRINGS_END (d) || *d == '\n';
+
+    case begbuf:
+      return AT_STRINGS_BEG (d);
+
+    case endbuf:
+      return AT_STRINGS_END (d);
+
+    case at_dot:
+      return PTR_BYTE_POS (d) == PT_BYTE;
+
+    case wordbound:
+    case notwordbound:
+      {
+	bool not = op == notwordbound;
+	if (AT_STRINGS_BEG (d) || AT_STRINGS_END (d))
+	  return !not;
+	charpos = SYNTAX_TABLE_BYTE_TO_CHAR (POS_AS_IN_BUFFER (pos)) - 1;
+	UPDATE_SYNTAX_TABLE (charpos);
+	GET_CHAR_BEFORE_2 (c1, d, string1, end1, string2, end2);
+	s1 = SYNTAX (c1);
+	UPDATE_SYNTAX_TABLE_FORWARD (charpos + 1);
+	GET_CHAR_AFTER (c2, d, dummy);
+	s2 = SYNTAX (c2);
+	return (((s1 == Sword) != (s2 == Sword))
+		|| ((s1 == Sword) && WORD_BOUNDARY_P (c1, c2))) != not;
+      }
+
+    case wordbeg:
+      if (AT_STRINGS_END (d))
+	return false;
+      charpos = SYNTAX_TABLE_BYTE_TO_CHAR (POS_AS_IN_BUFFER (pos));
+      UPDATE_SYNTAX_TABLE (charpos);
+      if (pos >= nfa->stop)
+	return false;
+      GET_CHAR_AFTER (c2, d, dummy);
+      if (SYNTAX (c2) != Sword)
+	return false;
+      if (AT_STRINGS_BEG (d))
+	return true;
+      GET_CHAR_BEFORE_2 (c1, d, string1, end1, string2, end2);
+      UPDATE_SYNTAX_TABLE_BACKWARD (charpos - 1);
+      s1 = SYNTAX (c1);
+      return ! ((s1 == Sword) && !WORD_BOUNDARY_P (c1, c2));
+
+    case wordend:
+      if (AT_STRINGS_BEG (d))
+	return false;
+      charpos = SYNTAX_TABLE_BYTE_TO_CHAR (POS_AS_IN_BUFFER (pos)) - 1;
+      UPDATE_SYNTAX_TABLE (charpos);
+      GET_CHAR_BEFORE_2 (c1, d, string1, end1, string2, end2);
+      if (SYNTAX (c1) != Sword)
+	return false;
+      if (AT_STRINGS_END (d))
+	return true;
+      GET_CHAR_AFTER (c2, d, dummy);
+      UPDATE_SYNTAX_TABLE_FORWARD (charpos + 1);
+      s2 = SYNTAX (c2);
+      return ! ((s2 == Sword) && !WORD_BOUNDARY_P (c1, c2));
+
+    case symbeg:
+      if (AT_STRINGS_END (d))
+	return false;
+      charpos = SYNTAX_TABLE_BYTE_TO_CHAR (POS_AS_IN_BUFFER (pos));
+      UPDATE_SYNTAX_TABLE (charpos);
+      if (pos >= nfa->stop)
+	return false;
+      c2 = RE_STRING_CHAR (d, target_multibyte);
+      s2 = SYNTAX (c2);
+      if (s2 != Sword && s2 != Ssymbol)
+	return false;
+      if (AT_STRINGS_BEG (d))
+	return true;
+      GET_CHAR_BEFORE_2 (c1, d, string1, end1, string2, end2);
+      UPDATE_SYNTAX_TABLE_BACKWARD (charpos - 1);
+      s1 = SYNTAX (c1);
+      return s1 != Sword && s1 != Ssymbol;
+
+    case symend:
+      if (AT_STRINGS_BEG (d))
+	return false;
+      charpos = SYNTAX_TABLE_BYTE_TO_CHAR (POS_AS_IN_BUFFER (pos)) - 1;
+      UPDATE_SYNTAX_TABLE (charpos);
+      GET_CHAR_BEFORE_2 (c1, d, string1, end1, string2, end2);
+      s1 = SYNTAX (c1);
+      if (s1 != Sword && s1 != Ssymbol)
+	return false;
+      if (AT_STRINGS_END (d))
+	return true;
+      c2 = RE_STRING_CHAR (d, target_multibyte);
+      UPDATE_SYNTAX_TABLE_FORWARD (charpos + 1);
+      s2 = SYNTAX (c2);
+      return s2 != Sword && s2 != Ssymbol;
+
+    default:
+      abort ();
+    }
+}
+
+/* Return true if instruction PC of NFA has not yet been reached at
+   the current position with the loops that matter to it, and record
+   that it now has.  */
+
+static bool
+nfa_first_visit (struct nfa *nfa, ptrdiff_t pc)
+{
+  uint_least64_t loops = nfa->loops & nfa->reach[pc];
+  uint_least64_t *visits = nfa->visit_loops + pc * NFA_MAX_VISITS;
+
+  if (nfa->visited[pc] != nfa->generation)
+    {
+      nfa->visited[pc] = nfa->generation;
+      nfa->nvisits[pc] = 1;
+      visits[0] = loops;
+      return true;
+    }
+  for (int i = 0; i < nfa->nvisits[pc]; i++)
+    if (visits[i] == loops)
+      return false;
+  /* Give up telling apart threads in deeply nested loops; this can
+     only lose groups matched in empty iterations.  */
+  if (nfa->nvisits[pc] == NFA_MAX_VISITS)
+    return false;
+  visits[nfa->nvisits[pc]++] = loops;
+  return true;
+}
+
+/* Add to LIST the threads that instruction PC leads to at position
+   POS of the text without consuming a character, in the order in
+   which the backtracking matcher would try them.  CAPS holds the
+   registers of the thread at PC; it is used as scratch space but
+   left unchanged.  A thread that gets to a point already reached at
+   POS is dropped, since one with higher priority is already there.  */
+
+static void
+nfa_add_thread (struct nfa *nfa, struct nfa_threads *list, ptrdiff_t pc,
+		ptrdiff_t *caps, ptrdiff_t pos)
+{
+  struct nfa_frame *sp = nfa->stack;
+
+  nfa->loops = 0;
+  *sp++ = (struct nfa_frame) { NFA_FOLLOW, pc, 0 };
+  while (sp > nfa->stack)
+    {
+      struct nfa_frame frame = *--sp;
+      switch (frame.kind)
+	{
+	case NFA_RESTORE:
+	  caps[frame.arg] = frame.value;
+	  continue;
+	case NFA_ENTER:
+	  nfa->loops |= (uint_least64_t) 1 << frame.arg;
+	  continue;
+	case NFA_LEAVE:
+	  nfa->loops &= ~((uint_least64_t) 1 << frame.arg);
+	  continue;
+	case NFA_FOLLOW:
+	  break;
+	}
+
+      pc = frame.arg;
+      struct nfa_insn *insn = &nfa->prog[pc];
+      uint_least64_t loop = 0;
+
+      switch (insn->op)
+	{
+	case on_failure_jump_loop:
+	case on_failure_jump_nastyloop:
+	  loop = (uint_least64_t) 1 << insn->arg;
+	  if (nfa->loops & loop)
+	    {
+	      /* Coming back to the loop without having consumed
+		 anything leaves it, as CHECK_INFINITE_LOOP does in the
+		 backtracking matcher.  */
+	      *sp++ = (struct nfa_frame)
+		{ NFA_FOLLOW,
+		  insn->op == on_failure_jump_loop ? insn->y : insn->x, 0 };
+	      continue;
+	    }
+	  break;
+
+	case succeed:
+	case exactn:
+	case anychar:
+	case charset:
+	case charset_not:
+	case syntaxspec:
+	case notsyntaxspec:
+	case categoryspec:
+	case notcategoryspec:
+	  /* What such a thread does next does not depend on its loops,
+	     which it leaves by consuming a character.  */
+	  if (nfa->visited[pc] != nfa->generation)
+	    {
+	      nfa->visited[pc] = nfa->generation;
+	      list->pc[list->n] = pc;
+	      memcpy (list->caps + list->n * nfa->ncaps, caps,
+		      nfa->ncaps * sizeof *caps);
+	      list->n++;
+	    }
+	  continue;
+
+	default:
+	  break;
+	}
+
+      if (!nfa_first_visit (nfa, pc))
+	continue;
+
+      switch (insn->op)
+	{
+	case jump:
+	  *sp++ = (struct nfa_frame) { NFA_FOLLOW, insn->x, 0 };
+	  break;
+
+	case on_failure_jump:
+	  *sp++ = (struct nfa_frame) { NFA_FOLLOW, insn->y, 0 };
+	  *sp++ = (struct nfa_frame) { NFA_FOLLOW, insn->x, 0 };
+	  break;
+
+	case on_failure_keep_string_jump:
+	  /* Such a loop never gives back what it matched: it is left
+	     only where its body, a single character, does not
+	     match.  */
+	  *sp++ = (struct nfa_frame)
+	    { NFA_FOLLOW,
+	      (nfa_char_match_p (nfa, &nfa->prog[insn->x], pos)
+	       ? insn->x : insn->y), 0 };
+	  break;
+
+	case on_failure_jump_loop:
+	  /* The body of the loop is at X.  */
+	  nfa->loops |= loop;
+	  *sp++ = (struct nfa_frame) { NFA_FOLLOW, insn->y, 0 };
+	  *sp++ = (struct nfa_frame) { NFA_LEAVE, insn->arg, 0 };
+	  *sp++ = (struct nfa_frame) { NFA_FOLLOW, insn->x, 0 };
+	  break;
+
+	case on_failure_jump_nastyloop:
+	  /* The body of the loop is at Y.  */
+	  *sp++ = (struct nfa_frame) { NFA_LEAVE, insn->arg, 0 };
+	  *sp++ = (struct nfa_frame) { NFA_FOLLOW, insn->y, 0 };
+	  *sp++ = (struct nfa_frame) { NFA_ENTER, insn->arg, 0 };
+	  *sp++ = (struct nfa_frame) { NFA_FOLLOW, insn->x, 0 };
+	  break;
+
+	case start_memory:
+	case stop_memory:
+	  {
+	    ptrdiff_t slot = 2 * insn->arg + (insn->op == stop_memory);
+	    *sp++ = (struct nfa_frame) { NFA_RESTORE, slot, caps[slot] };
+	    caps[slot] = pos;
+	    *sp++ = (struct nfa_frame) { NFA_FOLLOW, insn->x, 0 };
+	  }
+	  break;
+
+	default:
+	  if (nfa_assertion_p (nfa, insn->op, pos))
+	    *sp++ = (struct nfa_frame) { NFA_FOLLOW, insn->x, 0 };
+	  break;
+	}
+    }
+}
+
+/* Like re_search_2, but without backtracking: return the first
+   position from POS to POS + RANGE, RANGE being nonnegative, at which
+   the pattern in BUFP matches, or -1 if there is none.  Set *ENDP to
+   the end of the match.  Only use this if BUFP->nfa_compatible.  */
+
+static ptrdiff_t
+re_search_nfa (struct re_pattern_buffer *bufp,
+	       re_char *string1, ptrdiff_t size1,
+	       re_char *string2, ptrdiff_t size2,
+	       ptrdiff_t pos, ptrdiff_t range,
+	       struct re_registers *regs, ptrdiff_t stop, ptrdiff_t *endp)
+{
+  eassume (0 <= pos && pos <= stop && stop <= size1 + size2);
+  eassume (0 <= range);
+
+  Lisp_Object translate = bufp->translate;
+  bool target_multibyte = RE_TARGET_MULTIBYTE_P (bufp);
+  char *fastmap = (bufp->fastmap && bufp->fastmap_accurate
+		   && !bufp->can_be_null) ? bufp->fastmap : NULL;
+  ptrdiff_t num_regs = bufp->re_nsub + 1;
+  ptrdiff_t ncaps = 2 * num_regs;
+  ptrdiff_t limit = min (pos + range, stop);
+
+  REGEX_USE_SAFE_ALLOCA;
+  ptrdiff_t count = SPECPDL_INDEX ();
+
+  /* Prevent relocation of the buffer text, as re_match_2_internal
+     does.  */
+  if (!current_buffer->text->inhibit_shrinking)
+    {
+      record_unwind_protect_ptr (unwind_re_match, current_buffer);
+      current_buffer->text->inhibit_shrinking = 1;
+    }
+
+  if (size2 == 0 && string1 != NULL)
+    {
+      string2 = string1;
+      size2 = size1;
+      string1 = 0;
+      size1 = 0;
+    }
+
+  struct nfa nfa;
+  ptrdiff_t ninsns = build_nfa (bufp, target_multibyte, NULL, NULL);
+  eassert (0 < ninsns);
+  ptrdiff_t *map;
+  SAFE_NALLOCA (nfa.prog, 1, ninsns);
+  SAFE_NALLOCA (map, 1, bufp->used + 1);
+  for (ptrdiff_t i = 0; i <= bufp->used; i++)
+    map[i] = -1;
+  build_nfa (bufp, target_multibyte, nfa.prog, map);
+
+  nfa.ncaps = ncaps;
+  SAFE_NALLOCA (nfa.visited, 1, ninsns);
+  SAFE_NALLOCA (nfa.nvisits, 1, ninsns);
+  SAFE_NALLOCA (nfa.visit_loops, NFA_MAX_VISITS, ninsns);
+  SAFE_NALLOCA (nfa.reach, 1, ninsns);
+  for (ptrdiff_t i = 0; i < ninsns; i++)
+    {
+      struct nfa_insn *insn = &nfa.prog[i];
+      nfa.visited[i] = 0;
+      nfa.reach[i] = (insn->op == on_failure_jump_loop
+		      || insn->op == on_failure_jump_nastyloop
+		      ? (uint_least64_t) 1 << insn->arg : 0);
+    }
+  nfa.generation = 1;
+
+  /* Propagate REACH backward along the branches that do not consume
+     anything, until nothing changes.  */
+  for (bool changed = true; changed; )
+    {
+      changed = false;
+      for (ptrdiff_t i = ninsns - 1; 0 <= i; i--)
+	{
+	  struct nfa_insn *insn = &nfa.prog[i];
+	  uint_least64_t reach = nfa.reach[i];
+	  switch (insn->op)
+	    {
+	    case succeed:
+	    case exactn:
+	    case anychar:
+	    case charset:
+	    case charset_not:
+	    case syntaxspec:
+	    case notsyntaxspec:
+	    case categoryspec:
+	    case notcategoryspec:
+	      continue;
+
+	    case on_failure_jump:
+	    case on_failure_keep_string_jump:
+	    case on_failure_jump_loop:
+	    case on_failure_jump_nastyloop:
+	      reach |= nfa.reach[insn->y];
+	      FALLTHROUGH;
+	    default:
+	      reach |= nfa.reach[insn->x];
+	      break;
+	    }
+	  if (reach != nfa.reach[i])
+	    {
+	      nfa.reach[i] = reach;
+	      changed = true;
+	    }
+	}
+    }
+
+  /* Each instruction reached pushes at most four frames and pops
+     one.  */
+  SAFE_NALLOCA (nfa.stack, 3 * (NFA_MAX_VISITS + 1), ninsns + 1);
+  nfa.string1 = string1;
+  nfa.string2 = string2;
+  nfa.size1 = size1;
+  nfa.size2 = size2;
+  nfa.stop = stop;
+  nfa.target_multibyte = target_multibyte;
+  nfa.translate = translate;
+  nfa.char_pos = -1;
+
+  struct nfa_threads lists[2];
+  struct nfa_threads *clist = &lists[0], *nlist = &lists[1];
+  ptrdiff_t *caps, *work, *best;
+  SAFE_NALLOCA (clist->pc, 2, ninsns);
+  nlist->pc = clist->pc + ninsns;
+  SAFE_NALLOCA (caps, 2 * ninsns + 2, ncaps);
+  clist->caps = caps;
+  nlist->caps = caps + ninsns * ncaps;
+  work = caps + 2 * ninsns * ncaps;
+  best = work + ncaps;
+  clist->n = 0;
+
+  bool matched = false;
+  for (;;)
+    {
+      re_char *d = POS_ADDR_VSTRING (pos);
+
+      /* Start a thread at POS, with the lowest priority, unless a
+	 match starting earlier has been found.  */
+      if (!matched && pos <= limit)
+	{
+	  bool start = true;
+	  if (fastmap)
+	    {
+	      if (pos == size1 + size2)
+		start = false;
+	      else if (target_multibyte)
+		start = fastmap[CHAR_LEADING_CODE (TRANSLATE (STRING_CHAR (d)))];
+	      else
+		{
+		  int ch = RE_CHAR_TO_MULTIBYTE (*d);
+		  int translated = TRANSLATE (ch);
+		  int buf_ch = *d;
+		  if (translated != ch
+		      && (ch = RE_CHAR_TO_UNIBYTE (translated)) >= 0)
+		    buf_ch = ch;
+		  start = fastmap[buf_ch];
+		}
+	    }
+	  if (start)
+	    {
+	      for (ptrdiff_t i = 0; i < ncaps; i++)
+		work[i] = -1;
+	      work[0] = pos;
+	      nfa_add_thread (&nfa, clist, 0, work, pos);
+	    }
+	}
+
+      if (clist->n == 0 && (matched || pos >= limit))
+	break;
+
+      int len = 0;
+      if (pos < stop)
+	{
+	  nfa_fetch_char (&nfa, pos);
+	  len = nfa.len;
+	}
+
+      nfa.generation++;
+      nlist->n = 0;
+      for (ptrdiff_t i = 0; i < clist->n; i++)
+	{
+	  struct nfa_insn *insn = &nfa.prog[clist->pc[i]];
+	  ptrdiff_t *tcaps = clist->caps + i * ncaps;
+
+	  if (insn->op == succeed)
+	    {
+	      /* Threads with lower priority cannot win any more.  */
+	      matched = true;
+	      memcpy (best, tcaps, ncaps * sizeof *best);
+	      best[1] = pos;
+	      break;
+	    }
+	  if (nfa_char_match_p (&nfa, insn, pos))
+	    {
+	      memcpy (work, tcaps, ncaps * sizeof *work);
+	      nfa_add_thread (&nfa, nlist, insn->x, work, pos + len);
+	    }
+	}
+
+      struct nfa_threads *tem = clist;
+      clist = nlist;
+      nlist = tem;
+
+      if (pos >= stop)
+	break;
+      pos += len;
+      maybe_quit ();
+    }
+
+  ptrdiff_t result = -1;
+  if (matched)
+    {
+      result = best[0];
+      *endp = best[1];
+      if (regs)
+	{
+	  allocate_registers (bufp, regs, num_regs);
+	  if (regs->num_regs > 0)
+	    {
+	      regs->start[0] = best[0];
+	      regs->end[0] = best[1];
+	    }
+	  for (ptrdiff_t reg = 1; reg < num_regs; reg++)
+	    {
+	      if (best[2 * reg + 1] < 0)
+		regs->start[reg] = regs->end[reg] = -1;
+	      else
+		{
+		  regs->start[reg] = best[2 * reg];
+		  regs->end[reg] = best[2 * reg + 1];
+		}
+	    }
+	  for (ptrdiff_t reg = num_regs; reg < regs->num_regs; reg++)
+	    regs->start[reg] = regs->end[reg] = -1;
+	}
+    }
+
+  unbind_to (count, Qnil);
+  SAFE_FREE ();
+  return result;
+}
+
 
 /* Entry points for GNU code.  */
 
@@ -55,6 +55,10 @@ extern ptrdiff_t emacs_re_max_failures;
 /* Amount of memory that we can safely stack allocate.  */
 extern ptrdiff_t emacs_re_safe_alloca;
 
+/* The number of characters that can start a match for which
+   're_search_2' skips text a word at a time.  */
+enum { RE_MAX_START_BYTES = 3 };
+
 /* This data structure represents a compiled pattern.  Before calling
    the pattern compiler, the fields 'buffer', 'allocated', 'fastmap',
    and 'translate' can be set.  After the pattern has been
@@ -91,6 +95,15 @@ struct re_pattern_buffer
 	/* Number of subexpressions found by the compiler.  */
   ptrdiff_t re_nsub;
 
+        /* The ASCII characters that can start a match, as found in
+           the text before translation, if there are no more than
+           RE_MAX_START_BYTES of them; 'start_bytes_count' is their
+           number.  It is -1 if there are more, or if the translate
+           table maps an ASCII character to a non-ASCII one.  Set by
+           're_compile_fastmap' along with the fastmap.  */
+  signed char start_bytes_count;
+  unsigned char start_bytes[RE_MAX_START_BYTES];
+
         /* True if and only if this pattern can match the empty string.
            Well, in truth it's used only in 're_search_2', to see
            whether or not we should use the fastmap, so we don't set
@@ -118,6 +131,11 @@ struct re_pattern_buffer
   /* If true, multi-byte form in the target of match should be
      recognized as a multibyte character.  */
   bool_bf target_multibyte : 1;
+
+  /* If true, the pattern has no back references, counted repetitions
+     or POSIX backtracking, so that it can be matched without
+     backtracking when backtracking takes too long.  */
+  bool_bf nfa_compatible : 1;
 };
 
 /* Declarations for routines.  */
@@ -151,6 +169,17 @@ extern ptrdiff_t re_search_2 (struct re_pattern_buffer *buffer,
 			     struct re_registers *regs,
 			     ptrdiff_t stop);
 
+/* Like 're_search_2' searching forward, but search for the first
+   match of any of the N patterns in BUFFERS, and store the index of
+   the pattern that matched in *WHICH.  */
+extern ptrdiff_t re_search_multi (struct re_pattern_buffer **buffers,
+				 ptrdiff_t n,
+				 const char *string1, ptrdiff_t length1,
+				 const char *string2, ptrdiff_t length2,
+				 ptrdiff_t start, ptrdiff_t range,
+				 struct re_registers *regs,
+				 ptrdiff_t stop, ptrdiff_t *which);
+
 
 /* Like 're_search_2', but return how many characters in STRING the regexp
    in BUFFER matched, starting at position START.  */
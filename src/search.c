@@ -34,13 +34,18 @@ along with GNU Emacs.  If not, see <https://www.gnu.org/licenses/>.  */
 
 #include "regex-emacs.h"
 
-#define REGEXP_CACHE_SIZE 20
-
 /* If the regexp is non-nil, then the buffer contains the compiled form
    of that regexp, suitable for searching.  */
 struct regexp_cache
 {
-  struct regexp_cache *next;
+  /* The next and previous entries in the order of most recent use.  */
+  struct regexp_cache *next, *prev;
+  /* The next entry in the same bucket of regexp_cache_table, if this
+     entry is in the table.  */
+  struct regexp_cache *hash_next;
+  /* The hash code of the regexp and the other parts of the key that
+     can be hashed; see regexp_cache_hash.  */
+  EMACS_UINT hash;
   Lisp_Object regexp, f_whitespace_regexp;
   /* Syntax table for which the regexp applies.  We need this because
      of character classes.  If this is t, then the compiled pattern is valid
@@ -52,13 +57,26 @@ struct regexp_cache
   bool posix;
   /* True means we're inside a buffer match.  */
   bool busy;
+  /* True means the entry is in regexp_cache_table.  */
+  bool hashed;
 };
 
-/* The instances of that struct.  */
-static struct regexp_cache searchbufs[REGEXP_CACHE_SIZE];
+/* The most and least recently used entries of the cache.  */
+static struct regexp_cache *searchbuf_head, *searchbuf_tail;
+
+/* The number of entries in the cache.  */
+static ptrdiff_t searchbuf_count;
 
-/* The head of the linked list; points to the most recently used buffer.  */
-static struct regexp_cache *searchbuf_head;
+/* A hash table of the entries that hold a compiled regexp, with
+   REGEXP_CACHE_TABLE_SIZE buckets, a power of two.  */
+static struct regexp_cache **regexp_cache_table;
+static ptrdiff_t regexp_cache_table_size;
+
+/* Counts of the lookups in the cache that found a compiled regexp,
+   of those that had to compile one, and of the compiled regexps
+   thrown away to make room for others.  */
+static EMACS_INT regexp_cache_hits, regexp_cache_misses;
+static EMACS_INT regexp_cache_evictions;
 
 static void set_search_regs (ptrdiff_t, ptrdiff_t);
 static void save_search_regs (void);
@@ -151,6 +169,140 @@ shrink_regexp_cache (void)
       }
 }
 
+/* Mark the Lisp objects referenced by the cache.
+   This is called from garbage collection.  */
+
+void
+mark_regexp_cache (void)
+{
+  for (struct regexp_cache *cp = searchbuf_head; cp; cp = cp->next)
+    {
+      mark_object (cp->regexp);
+      mark_object (cp->f_whitespace_regexp);
+      mark_object (cp->syntax_table);
+      mark_object (cp->buf.translate);
+    }
+}
+
+/* Remove CP from the hash table of the cache, if it is there.  */
+
+static void
+regexp_cache_unhash (struct regexp_cache *cp)
+{
+  if (cp->hashed)
+    {
+      struct regexp_cache **prev
+	= &regexp_cache_table[cp->hash & (regexp_cache_table_size - 1)];
+      while (*prev != cp)
+	prev = &(*prev)->hash_next;
+      *prev = cp->hash_next;
+      cp->hashed = false;
+    }
+}
+
+/* Add CP, which holds a compiled regexp, to the hash table of the
+   cache.  */
+
+static void
+regexp_cache_rehash (struct regexp_cache *cp)
+{
+  struct regexp_cache **bucket
+    = &regexp_cache_table[cp->hash & (regexp_cache_table_size - 1)];
+  eassert (!cp->hashed);
+  cp->hash_next = *bucket;
+  *bucket = cp;
+  cp->hashed = true;
+}
+
+/* Return the hash code for looking up PATTERN compiled with TRANSLATE
+   and POSIX.  The syntax table and the whitespace regexp are not
+   hashed, since an entry can be valid for any syntax table.  */
+
+static EMACS_UINT
+regexp_cache_hash (Lisp_Object pattern, Lisp_Object translate, bool posix)
+{
+  EMACS_UINT hash = hash_string (SSDATA (pattern), SBYTES (pattern));
+  hash = sxhash_combine (hash, XHASH (translate));
+  return sxhash_combine (hash, (STRING_MULTIBYTE (pattern) << 1) | posix);
+}
+
+/* Unlink CP from the list of entries in order of use.  */
+
+static void
+regexp_cache_unlink (struct regexp_cache *cp)
+{
+  if (cp->prev)
+    cp->prev->next = cp->next;
+  else
+    searchbuf_head = cp->next;
+  if (cp->next)
+    cp->next->prev = cp->prev;
+  else
+    searchbuf_tail = cp->prev;
+}
+
+/* Return the number of entries the cache can have.  */
+
+static ptrdiff_t
+regexp_cache_capacity (void)
+{
+  ptrdiff_t limit = PTRDIFF_MAX / (4 * sizeof *regexp_cache_table);
+  return max (1, min (regexp_cache_size, limit));
+}
+
+/* Return the number of buckets of the hash table for a cache of
+   CAPACITY entries.  */
+
+static ptrdiff_t
+regexp_cache_table_size_for (ptrdiff_t capacity)
+{
+  ptrdiff_t table_size = 16;
+  while (table_size < 2 * capacity)
+    table_size *= 2;
+  return table_size;
+}
+
+/* Make the hash table of the cache the right size for its capacity,
+   and free the entries beyond that capacity if they are not in
+   use.  */
+
+static void
+resize_regexp_cache (void)
+{
+  ptrdiff_t size = regexp_cache_capacity ();
+  ptrdiff_t table_size = regexp_cache_table_size_for (size);
+
+  for (struct regexp_cache *cp = searchbuf_tail;
+       cp && searchbuf_count > size; )
+    {
+      struct regexp_cache *prev = cp->prev;
+      if (!cp->busy)
+	{
+	  if (cp->hashed)
+	    regexp_cache_evictions++;
+	  regexp_cache_unhash (cp);
+	  regexp_cache_unlink (cp);
+	  xfree (cp->buf.buffer);
+	  xfree (cp);
+	  searchbuf_count--;
+	}
+      cp = prev;
+    }
+
+  if (regexp_cache_table_size != table_size)
+    {
+      xfree (regexp_cache_table);
+      regexp_cache_table = xzalloc (table_size * sizeof *regexp_cache_table);
+      regexp_cache_table_size = table_size;
+      for (struct regexp_cache *cp = searchbuf_head; cp; cp = cp->next)
+	if (cp->hashed)
+	  {
+	    cp->hashed = false;
+	    regexp_cache_rehash (cp);
+	  }
+    }
+}
+
 /* Clear the regexp cache w.r.t. a particular syntax table,
    because it was changed.
    There is no danger of memory leak here because re_compile_pattern
@@ -159,14 +311,15 @@ shrink_regexp_cache (void)
 void
 clear_regexp_cache (void)
 {
-  int i;
-
-  for (i = 0; i < REGEXP_CACHE_SIZE; ++i)
+  for (struct regexp_cache *cp = searchbuf_head; cp; cp = cp->next)
     /* It's tempting to compare with the syntax-table we've actually changed,
        but it's not sufficient because char-table inheritance means that
        modifying one syntax-table can change others at the same time.  */
-    if (!searchbufs[i].busy && !EQ (searchbufs[i].syntax_table, Qt))
-      searchbufs[i].regexp = Qnil;
+    if (!cp->busy && !EQ (cp->syntax_table, Qt))
+      {
+	regexp_cache_unhash (cp);
+	cp->regexp = Qnil;
+      }
 }
 
 static void
@@ -199,53 +352,86 @@ static struct regexp_cache *
 compile_pattern (Lisp_Object pattern, struct re_registers *regp,
 		 Lisp_Object translate, bool posix, bool multibyte)
 {
-  struct regexp_cache *cp, **cpp, **lru_nonbusy;
-
-  for (cpp = &searchbuf_head, lru_nonbusy = NULL; ; cpp = &cp->next)
+  struct regexp_cache *cp;
+  EMACS_UINT hash = regexp_cache_hash (pattern, translate, posix);
+  ptrdiff_t capacity = regexp_cache_capacity ();
+
+  if (searchbuf_count > capacity
+      || (regexp_cache_table_size
+	  != regexp_cache_table_size_for (capacity)))
+    resize_regexp_cache ();
+
+  for (cp = regexp_cache_table[hash & (regexp_cache_table_size - 1)];
+       cp; cp = cp->hash_next)
+    if (cp->hash == hash
+	&& !cp->busy
+	&& SCHARS (cp->regexp) == SCHARS (pattern)
+	&& STRING_MULTIBYTE (cp->regexp) == STRING_MULTIBYTE (pattern)
+	&& !NILP (Fstring_equal (cp->regexp, pattern))
+	&& EQ (cp->buf.translate, translate)
+	&& cp->posix == posix
+	&& (EQ (cp->syntax_table, Qt)
+	    || EQ (cp->syntax_table, BVAR (current_buffer, syntax_table)))
+	&& !NILP (Fequal (cp->f_whitespace_regexp, Vsearch_spaces_regexp))
+	&& cp->buf.charset_unibyte == charset_unibyte)
+      break;
+
+  if (cp)
+    regexp_cache_hits++;
+  else
     {
-      cp = *cpp;
-      if (!cp->busy)
-        lru_nonbusy = cpp;
-      /* Entries are initialized to nil, and may be set to nil by
-	 compile_pattern_1 if the pattern isn't valid.  Don't apply
-	 string accessors in those cases.  However, compile_pattern_1
-	 is only applied to the cache entry we pick here to reuse.  So
-	 nil should never appear before a non-nil entry.  */
-      if (NILP (cp->regexp))
-	goto compile_it;
-      if (SCHARS (cp->regexp) == SCHARS (pattern)
-          && !cp->busy
-	  && STRING_MULTIBYTE (cp->regexp) == STRING_MULTIBYTE (pattern)
-	  && !NILP (Fstring_equal (cp->regexp, pattern))
-	  && EQ (cp->buf.translate, translate)
-	  && cp->posix == posix
-	  && (EQ (cp->syntax_table, Qt)
-	      || EQ (cp->syntax_table, BVAR (current_buffer, syntax_table)))
-	  && !NILP (Fequal (cp->f_whitespace_regexp, Vsearch_spaces_regexp))
-	  && cp->buf.charset_unibyte == charset_unibyte)
-	break;
-
-      /* If we're at the end of the cache, compile into the last
-	 (least recently used) non-busy cell in the cache.  */
-      if (cp->next == 0)
+      /* Compile into the least recently used entry that is not busy
+	 if the cache is full, or else into a new entry.  */
+      regexp_cache_misses++;
+      if (searchbuf_count >= capacity)
+	for (cp = searchbuf_tail; cp && cp->busy; cp = cp->prev)
+	  continue;
+      if (cp)
 	{
-          if (!lru_nonbusy)
-            error ("Too much matching reentrancy");
-          cpp = lru_nonbusy;
-          cp = *cpp;
-	compile_it:
-          eassert (!cp->busy);
-	  compile_pattern_1 (cp, pattern, translate, posix);
-	  break;
+	  if (cp->hashed)
+	    regexp_cache_evictions++;
+	  regexp_cache_unhash (cp);
+	}
+      else
+	{
+	  /* Put the new entry last, so that it is the first to be
+	     reused if the regexp turns out to be invalid.  The cache
+	     can grow beyond its capacity when all its entries are
+	     busy; resize_regexp_cache shrinks it again later.  */
+	  cp = xzalloc (sizeof *cp);
+	  cp->buf.allocated = 100;
+	  cp->buf.buffer = xmalloc (100);
+	  cp->buf.fastmap = cp->fastmap;
+	  cp->regexp = Qnil;
+	  cp->f_whitespace_regexp = Qnil;
+	  cp->syntax_table = Qnil;
+	  cp->buf.translate = Qnil;
+	  cp->prev = searchbuf_tail;
+	  if (searchbuf_tail)
+	    searchbuf_tail->next = cp;
+	  else
+	    searchbuf_head = cp;
+	  searchbuf_tail = cp;
+	  searchbuf_count++;
 	}
+      eassert (!cp->busy);
+      compile_pattern_1 (cp, pattern, translate, posix);
+      cp->hash = hash;
+      regexp_cache_rehash (cp);
     }
 
-  /* When we get here, cp (aka *cpp) contains the compiled pattern,
-     either because we found it in the cache or because we just compiled it.
-     Move it to the front of the queue to mark it as most recently used.  */
-  *cpp = cp->next;
-  cp->next = searchbuf_head;
-  searchbuf_head = cp;
+  /* When we get here, cp contains the compiled pattern, either
+     because we found it in the cache or because we just compiled it.
+     Move it to the front of the list to mark it as most recently
+     used.  */
+  if (cp != searchbuf_head)
+    {
+      regexp_cache_unlink (cp);
+      cp->prev = NULL;
+      cp->next = searchbuf_head;
+      searchbuf_head->prev = cp;
+      searchbuf_head = cp;
+    }
 
   /* Advise the searching functions about the space we have allocated
      for register data.  */
@@ -624,6 +810,169 @@ newline_cache_on_off (struct buffer *buf)
 }
 
 
+/* In large buffers, the number of newlines before a position is also
+   recorded in a text index with checkpoints spaced about
+   LINE_INDEX_INTERVAL bytes apart, so that counting lines or moving
+   over many of them seldom scans more than that many bytes.  See
+   also the character position index in marker.c.  */
+
+enum { LINE_INDEX_INTERVAL = 16 * 1024 };
+
+/* find_newline consults the line index only when looking for more
+   newlines than this; fewer are found faster by scanning.  */
+enum { LINE_INDEX_MIN_COUNT = 256 };
+
+/* Return the number of newlines in the N bytes at P.  Look at eight
+   bytes at a time, adding up the newlines found in each byte of a
+   word, and sum those bytes every 255 words, before they overflow.  */
+
+static ptrdiff_t
+count_newline_bytes (unsigned char const *p, ptrdiff_t n)
+{
+  uint64_t const ones = 0x0101010101010101;
+  uint64_t const low7 = ones * 0x7f;
+  uint64_t const newlines = ones * '\n';
+  uint64_t const pairs = 0x00ff00ff00ff00ff;
+  ptrdiff_t count = 0, i = 0;
+
+  while (i <= n - 8)
+    {
+      uint64_t sums = 0;
+      for (int words = 0; words < 255 && i <= n - 8; words++, i += 8)
+	{
+	  uint64_t w;
+	  memcpy (&w, p + i, sizeof w);
+	  /* A byte of W is a newline iff the high bit of that byte of
+	     T is clear.  */
+	  uint64_t x = w ^ newlines;
+	  uint64_t t = ((x & low7) + low7) | x;
+	  sums += (~t >> 7) & ones;
+	}
+      sums = (sums & pairs) + ((sums >> 8) & pairs);
+      count += (sums * 0x0001000100010001) >> 48;
+    }
+
+  for (; i < n; i++)
+    count += p[i] == '\n';
+  return count;
+}
+
+/* Return the number of newlines of B between bytes FROM and TO.  */
+
+static ptrdiff_t
+count_newlines (struct buffer *b, ptrdiff_t from, ptrdiff_t to)
+{
+  ptrdiff_t n = 0;
+  while (from < to)
+    {
+      ptrdiff_t end = (from < BUF_GPT_BYTE (b)
+		       ? min (to, BUF_GPT_BYTE (b)) : to);
+      n += count_newline_bytes (BUF_BYTE_ADDRESS (b, from), end - from);
+      from = end;
+    }
+  return n;
+}
+
+/* Return the byte position of B after the Nth newline at or after
+   byte FROM.  There must be that many before byte TO.  */
+
+static ptrdiff_t
+nth_newline_end (struct buffer *b, ptrdiff_t from, ptrdiff_t to,
+		 ptrdiff_t n)
+{
+  while (true)
+    {
+      ptrdiff_t end = (from < BUF_GPT_BYTE (b)
+		       ? min (to, BUF_GPT_BYTE (b)) : to);
+      unsigned char *base = BUF_BYTE_ADDRESS (b, from);
+      unsigned char *p = base, *lim = base + (end - from);
+      while ((p = memchr (p, '\n', lim - p)))
+	{
+	  p++;
+	  if (--n == 0)
+	    return from + (p - base);
+	}
+      eassert (end < to);
+      from = end;
+    }
+}
+
+static struct text_index_kind const line_index_kind =
+  { LINE_INDEX_INTERVAL, 0, count_newlines, false };
+
+/* Return the number of newlines of B before BYTEPOS, adding
+   checkpoints so that the next one is not much further away.  */
+
+static ptrdiff_t
+lines_before (struct buffer *b, struct text_index *index, ptrdiff_t bytepos)
+{
+  ptrdiff_t k = text_index_upto (index, bytepos) - 1;
+  while (text_index_split (b, index, k)
+	 && index->checkpoints[k + 1].bytepos <= bytepos)
+    k++;
+  struct text_checkpoint *c = &index->checkpoints[k];
+  return c->count + count_newlines (b, c->bytepos, bytepos);
+}
+
+/* Return the byte position of B after its Nth newline, which must
+   exist.  */
+
+static ptrdiff_t
+line_end_position (struct buffer *b, struct text_index *index, ptrdiff_t n)
+{
+  ptrdiff_t k = text_index_upto_count (index, n - 1) - 1;
+  while (text_index_split (b, index, k)
+	 && index->checkpoints[k + 1].count < n)
+    k++;
+  struct text_checkpoint *c = index->checkpoints;
+  return nth_newline_end (b, c[k].bytepos,
+			  (k + 1 < index->used
+			   ? c[k + 1].bytepos : BUF_Z_BYTE (b)),
+			  n - c[k].count);
+}
+
+/* Like find_newline, but in bytes, and using the line index of the
+   current buffer.  Look for COUNT newlines between START_BYTE and
+   END_BYTE, set *COUNTED to the number found, negated if COUNT is
+   negative, and set *BYTEPOS to the position after the COUNTth one,
+   or to END_BYTE.  Return false without doing that if the positions
+   are too close for the index to be worth it.  */
+
+bool
+find_newline_by_index (ptrdiff_t start_byte, ptrdiff_t end_byte,
+		       ptrdiff_t count, ptrdiff_t *counted,
+		       ptrdiff_t *bytepos)
+{
+  if (count == 0
+      || eabs (end_byte - start_byte) <= 2 * LINE_INDEX_INTERVAL)
+    return false;
+  struct text_index *index = text_index_get (current_buffer,
+					     &current_buffer->text->line_index,
+					     &line_index_kind);
+  if (!index)
+    return false;
+
+  ptrdiff_t start_lines = lines_before (current_buffer, index, start_byte);
+  ptrdiff_t end_lines = lines_before (current_buffer, index, end_byte);
+  ptrdiff_t found = eabs (end_lines - start_lines);
+  if (found < eabs (count))
+    {
+      *counted = count > 0 ? found : - found;
+      *bytepos = end_byte;
+    }
+  else
+    {
+      /* Going backward, the first newline found is the last one
+	 before START_BYTE.  */
+      *counted = count;
+      *bytepos = line_end_position (current_buffer, index,
+				    (count > 0
+				     ? start_lines + count
+				     : start_lines + count + 1));
+    }
+  return true;
+}
+
 /* Search for COUNT newlines between START/START_BYTE and END/END_BYTE.
 
    If COUNT is positive, search forwards; END must be >= START.
@@ -667,6 +1016,24 @@ find_newline (ptrdiff_t start, ptrdiff_t start_byte, ptrdiff_t end,
   if (end_byte == -1)
     end_byte = CHAR_TO_BYTE (end);
 
+  /* Skip many lines with the line index, if it is worth it.  */
+  if (count > LINE_INDEX_MIN_COUNT || count < - LINE_INDEX_MIN_COUNT)
+    {
+      ptrdiff_t found, found_byte;
+
+      if (start_byte == -1)
+	start_byte = CHAR_TO_BYTE (start);
+      if (find_newline_by_index (start_byte, end_byte, count,
+				 &found, &found_byte))
+	{
+	  if (counted)
+	    *counted = found;
+	  if (bytepos)
+	    *bytepos = found_byte;
+	  return found == count ? BYTE_TO_CHAR (found_byte) : end;
+	}
+    }
+
   newline_cache = newline_cache_on_off (current_buffer);
   if (current_buffer->base_buffer)
     cache_buffer = current_buffer->base_buffer;
@@ -1131,14 +1498,7 @@ trivial_regexp_p (Lisp_Object regexp)
 do						\
   {						\
     if (! NILP (trt))				\
-      {						\
-	Lisp_Object temp;			\
-	temp = Faref (trt, make_fixnum (d));	\
-	if (FIXNUMP (temp))			\
-	  out = XFIXNUM (temp);			\
-	else					\
-	  out = d;				\
-      }						\
+      out = char_table_translate (trt, d);	\
     else					\
       out = d;					\
   }						\
@@ -2333,7 +2693,249 @@ and `replace-match'.  */)
 {
   return search_command (regexp, bound, noerror, count, 1, 1, 1);
 }
+
+DEFUN ("re-search-forward-multi", Fre_search_forward_multi,
+       Sre_search_forward_multi, 1, 3, 0,
+       doc: /* Search forward from point for any of the regexps in REGEXPS.
+REGEXPS is a list or vector of regular expressions.  Find the first
+occurrence of any of them; where several of them match at the same
+place, prefer the one that comes first in REGEXPS.  Set point to the
+end of the occurrence found, set the match data as `re-search-forward'
+would for the regexp that matched, and return the index of that
+regexp in REGEXPS.
+
+This scans the text only once, so it is faster than searching for
+each of the regexps in turn.
+
+The optional arguments BOUND and NOERROR mean the same as for
+`re-search-forward'.
+
+Search case-sensitivity is determined by the value of the variable
+`case-fold-search', which see.  */)
+  (Lisp_Object regexps, Lisp_Object bound, Lisp_Object noerror)
+{
+  ptrdiff_t lim, lim_byte;
+  ptrdiff_t n = VECTORP (regexps) ? ASIZE (regexps) : list_length (regexps);
+  bool multibyte = !NILP (BVAR (current_buffer, enable_multibyte_characters));
+  /* Snapshot in case Lisp changes the value.  */
+  bool preserve_match_data = NILP (Vinhibit_changing_match_data);
+  struct re_registers *regs
+    = preserve_match_data ? &search_regs : &search_regs_1;
+  Lisp_Object trt = (!NILP (BVAR (current_buffer, case_fold_search))
+		     ? BVAR (current_buffer, case_canon_table) : Qnil);
+  struct re_pattern_buffer **bufps;
+  ptrdiff_t val = -1, which = 0;
+  ptrdiff_t count = SPECPDL_INDEX ();
+  USE_SAFE_ALLOCA;
+
+  if (NILP (bound))
+    lim = ZV, lim_byte = ZV_BYTE;
+  else
+    {
+      lim = fix_position (bound);
+      if (lim < PT)
+	error ("Invalid search bound (wrong side of point)");
+      if (lim > ZV)
+	lim = ZV, lim_byte = ZV_BYTE;
+      else
+	lim_byte = CHAR_TO_BYTE (lim);
+    }
+
+  /* This is so set_image_of_range_1 in regex-emacs.c can find the EQV
+     table.  */
+  set_char_table_extras (BVAR (current_buffer, case_canon_table), 2,
+			 BVAR (current_buffer, case_eqv_table));
+
+  /* Compile all the regexps, and keep them from being reused for
+     other searches until this one is done.  */
+  SAFE_NALLOCA (bufps, 1, n);
+  Lisp_Object tail = regexps;
+  for (ptrdiff_t i = 0; i < n; i++)
+    {
+      Lisp_Object regexp;
+      if (VECTORP (regexps))
+	regexp = AREF (regexps, i);
+      else
+	{
+	  regexp = XCAR (tail);
+	  tail = XCDR (tail);
+	}
+      CHECK_STRING (regexp);
+      struct regexp_cache *cache_entry
+	= compile_pattern (regexp, regs, trt, false, multibyte);
+      freeze_pattern (cache_entry);
+      bufps[i] = &cache_entry->buf;
+    }
+
+  maybe_quit ();
+
+  unsigned char *p1 = BEGV_ADDR;
+  ptrdiff_t s1 = GPT_BYTE - BEGV_BYTE;
+  unsigned char *p2 = GAP_END_ADDR;
+  ptrdiff_t s2 = ZV_BYTE - GPT_BYTE;
+  if (s1 < 0)
+    {
+      p2 = p1;
+      s2 = ZV_BYTE - BEGV_BYTE;
+      s1 = 0;
+    }
+  if (s2 < 0)
+    {
+      s1 = ZV_BYTE - BEGV_BYTE;
+      s2 = 0;
+    }
+
+  freeze_buffer_relocation ();
+  re_match_object = Qnil;
+  if (n > 0)
+    val = re_search_multi (bufps, n, (char *) p1, s1, (char *) p2, s2,
+			   PT_BYTE - BEGV_BYTE, lim_byte - PT_BYTE, regs,
+			   lim_byte - BEGV_BYTE, &which);
+  SAFE_FREE_UNBIND_TO (count, Qnil);
+  if (val == -2)
+    matcher_overflow ();
+
+  if (val < 0)
+    {
+      if (NILP (noerror))
+	xsignal1 (Qsearch_failed, regexps);
+      if (!EQ (noerror, Qt))
+	SET_PT_BOTH (lim, lim_byte);
+      return Qnil;
+    }
+
+  if (preserve_match_data)
+    {
+      for (ptrdiff_t i = 0; i < search_regs.num_regs; i++)
+	if (search_regs.start[i] >= 0)
+	  {
+	    search_regs.start[i]
+	      = BYTE_TO_CHAR (search_regs.start[i] + BEGV_BYTE);
+	    search_regs.end[i] = BYTE_TO_CHAR (search_regs.end[i] + BEGV_BYTE);
+	  }
+      XSETBUFFER (last_thing_searched, current_buffer);
+      SET_PT (search_regs.end[0]);
+    }
+  else
+    SET_PT (BYTE_TO_CHAR (search_regs_1.end[0] + BEGV_BYTE));
+
+  return make_fixnum (which);
+}
 
+DEFUN ("count-regexp-matches", Fcount_regexp_matches,
+       Scount_regexp_matches, 1, 3, 0,
+       doc: /* Return the number of matches for REGEXP from START to END.
+START and END default to point and the end of the accessible portion
+of the buffer.  Each search starts where the previous match ended, so
+overlapping matches are not counted; after an empty match, it starts
+one character further.
+
+This finds the same matches as calling `re-search-forward' repeatedly,
+without returning to Lisp in between.  It does not move point, and it
+does not change the match data.
+
+Search case-sensitivity is determined by the value of the variable
+`case-fold-search', which see.  */)
+  (Lisp_Object regexp, Lisp_Object start, Lisp_Object end)
+{
+  CHECK_STRING (regexp);
+  ptrdiff_t from = NILP (start) ? PT : fix_position (start);
+  ptrdiff_t to = NILP (end) ? ZV : fix_position (end);
+  from = clip_to_bounds (BEGV, from, ZV);
+  to = clip_to_bounds (from, to, ZV);
+  ptrdiff_t pos_byte = CHAR_TO_BYTE (from);
+  ptrdiff_t lim_byte = CHAR_TO_BYTE (to);
+  bool multibyte = !NILP (BVAR (current_buffer, enable_multibyte_characters));
+  Lisp_Object trt = (!NILP (BVAR (current_buffer, case_fold_search))
+		     ? BVAR (current_buffer, case_canon_table) : Qnil);
+  EMACS_INT matches = 0;
+
+  if (running_asynch_code)
+    save_search_regs ();
+
+  /* An empty regexp matches at every position.  */
+  if (SCHARS (regexp) == 0)
+    return make_int (to - from);
+
+  /* Like search_buffer, look for a literal string with a plain string
+     search.  Its matches are never empty, so there are fewer than
+     TO - FROM + 1 of them, and the search reports how many of these
+     it did not find.  */
+  if (trivial_regexp_p (regexp) && NILP (Vsearch_spaces_regexp))
+    {
+      if (from == to)
+	return make_fixnum (0);
+      ptrdiff_t count = SPECPDL_INDEX ();
+      specbind (Qinhibit_changing_match_data, Qt);
+      EMACS_INT n = to - from + 1;
+      EMACS_INT val
+	= search_buffer_non_re (regexp, from, pos_byte, to, lim_byte, n, 1,
+				trt, (NILP (trt) ? Qnil
+				      : BVAR (current_buffer, case_eqv_table)),
+				false);
+      eassert (val <= 0);
+      return unbind_to (count, make_int (n + val));
+    }
+
+  /* This is so set_image_of_range_1 in regex-emacs.c can find the EQV
+     table.  */
+  set_char_table_extras (BVAR (current_buffer, case_canon_table), 2,
+			 BVAR (current_buffer, case_eqv_table));
+
+  /* The matches are recorded in search_regs_1, which is not the
+     match data.  */
+  struct regexp_cache *cache_entry
+    = compile_pattern (regexp, &search_regs_1, trt, false, multibyte);
+  struct re_pattern_buffer *bufp = &cache_entry->buf;
+
+  maybe_quit ();
+
+  unsigned char *p1 = BEGV_ADDR;
+  ptrdiff_t s1 = GPT_BYTE - BEGV_BYTE;
+  unsigned char *p2 = GAP_END_ADDR;
+  ptrdiff_t s2 = ZV_BYTE - GPT_BYTE;
+  if (s1 < 0)
+    {
+      p2 = p1;
+      s2 = ZV_BYTE - BEGV_BYTE;
+      s1 = 0;
+    }
+  if (s2 < 0)
+    {
+      s1 = ZV_BYTE - BEGV_BYTE;
+      s2 = 0;
+    }
+
+  ptrdiff_t count = SPECPDL_INDEX ();
+  freeze_buffer_relocation ();
+  freeze_pattern (cache_entry);
+
+  while (pos_byte < lim_byte)
+    {
+      re_match_object = Qnil;
+      ptrdiff_t val = re_search_2 (bufp, (char *) p1, s1, (char *) p2, s2,
+				   pos_byte - BEGV_BYTE, lim_byte - pos_byte,
+				   &search_regs_1, lim_byte - BEGV_BYTE);
+      if (val == -2)
+	{
+	  unbind_to (count, Qnil);
+	  matcher_overflow ();
+	}
+      if (val < 0)
+	break;
+      matches++;
+      pos_byte = search_regs_1.end[0] + BEGV_BYTE;
+      /* Make progress after an empty match.  */
+      if (search_regs_1.start[0] == search_regs_1.end[0]
+	  && pos_byte < ZV_BYTE)
+	pos_byte += multibyte ? BYTES_BY_CHAR_HEAD (FETCH_BYTE (pos_byte)) : 1;
+      maybe_quit ();
+    }
+
+  unbind_to (count, Qnil);
+  return make_int (matches);
+}
+
 DEFUN ("replace-match", Freplace_match, Sreplace_match, 1, 5, 0,
        doc: /* Replace text matched by last search with NEWTEXT.
 Leave point at the end of the replacement text.
@@ -3340,19 +3942,37 @@ the buffer.  If the buffer doesn't have a cache, the value is nil.  */)
   return val;
 }
 
+DEFUN ("regexp-cache-statistics", Fregexp_cache_statistics,
+       Sregexp_cache_statistics, 0, 1, 0,
+       doc: /* Return statistics about the cache of compiled regexps.
+The value is an alist with these elements:
+
+  (hits . N)       N searches found their regexp already compiled.
+  (misses . N)     N searches had to compile their regexp.
+  (evictions . N)  N compiled regexps were discarded to make room.
+  (entries . N)    N regexps are in the cache now.
+  (size . N)       The cache can hold N regexps; see `regexp-cache-size'.
+
+If RESET is non-nil, reset the counts of hits, misses and evictions
+to zero after computing the value.  */)
+  (Lisp_Object reset)
+{
+  Lisp_Object val
+    = list5 (Fcons (Qhits, make_int (regexp_cache_hits)),
+	     Fcons (Qmisses, make_int (regexp_cache_misses)),
+	     Fcons (Qevictions, make_int (regexp_cache_evictions)),
+	     Fcons (Qentries, make_int (searchbuf_count)),
+	     Fcons (Qsize, make_int (regexp_cache_capacity ())));
+  if (!NILP (reset))
+    regexp_cache_hits = regexp_cache_misses = regexp_cache_evictions = 0;
+  return val;
+}
 
 static void syms_of_search_for_pdumper (void);
 
 void
 syms_of_search (void)
 {
-  for (int i = 0; i < REGEXP_CACHE_SIZE; ++i)
-    {
-      staticpro (&searchbufs[i].regexp);
-      staticpro (&searchbufs[i].f_whitespace_regexp);
-      staticpro (&searchbufs[i].syntax_table);
-    }
-
   /* Error condition used for failing searches.  */
   DEFSYM (Qsearch_failed, "search-failed");
 
@@ -3400,6 +4020,18 @@ do not set the match data.  The proper way to use this variable
 is to bind it with `let' around a small expression.  */);
   Vinhibit_changing_match_data = Qnil;
 
+  DEFVAR_INT ("regexp-cache-size", regexp_cache_size,
+    doc: /* Number of compiled regexps to keep for reuse.
+Searching for a regexp that is in the cache avoids compiling it
+again.  Modes that use many regexps, such as for fontification,
+can benefit from a larger value.  */);
+  regexp_cache_size = 128;
+
+  DEFSYM (Qhits, "hits");
+  DEFSYM (Qmisses, "misses");
+  DEFSYM (Qevictions, "evictions");
+  DEFSYM (Qentries, "entries");
+
   defsubr (&Slooking_at);
   defsubr (&Sposix_looking_at);
   defsubr (&Sstring_match);
@@ -3410,6 +4042,8 @@ is to bind it with `let' around a small expression.  */);
   defsubr (&Sre_search_backward);
   defsubr (&Sposix_search_forward);
   defsubr (&Sposix_search_backward);
+  defsubr (&Sre_search_forward_multi);
+  defsubr (&Scount_regexp_matches);
   defsubr (&Sreplace_match);
   defsubr (&Smatch_beginning);
   defsubr (&Smatch_end);
@@ -3418,6 +4052,7 @@ is to bind it with `let' around a small expression.  */);
   defsubr (&Smatch_data__translate);
   defsubr (&Sregexp_quote);
   defsubr (&Snewline_cache_check);
+  defsubr (&Sregexp_cache_statistics);
 
   pdumper_do_now_and_after_load (syms_of_search_for_pdumper);
 }
@@ -3425,16 +4060,8 @@ is to bind it with `let' around a small expression.  */);
 static void
 syms_of_search_for_pdumper (void)
 {
-  for (int i = 0; i < REGEXP_CACHE_SIZE; ++i)
-    {
-      searchbufs[i].buf.allocated = 100;
-      searchbufs[i].buf.buffer = xmalloc (100);
-      searchbufs[i].buf.fastmap = searchbufs[i].fastmap;
-      searchbufs[i].regexp = Qnil;
-      searchbufs[i].f_whitespace_regexp = Qnil;
-      searchbufs[i].busy = false;
-      searchbufs[i].syntax_table = Qnil;
-      searchbufs[i].next = (i == REGEXP_CACHE_SIZE-1 ? 0 : &searchbufs[i+1]);
-    }
-  searchbuf_head = &searchbufs[0];
+  searchbuf_head = searchbuf_tail = NULL;
+  searchbuf_count = 0;
+  regexp_cache_table = NULL;
+  regexp_cache_table_size = 0;
 }
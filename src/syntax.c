@@ -19,6 +19,8 @@ along with GNU Emacs.  If not, see <https://www.gnu.org/licenses/>.  */
 
 #include <config.h>
 
+#include <count-one-bits.h>
+
 #include "lisp.h"
 #include "character.h"
 #include "buffer.h"
@@ -161,6 +163,110 @@ struct lisp_parse_state
                         or Sescape, etc.  Smax otherwise. */
   };
 
+/* The number of characters between the checkpoints that
+   'internal--syntax-ppss' records.  */
+enum { SYNTAX_CHECKPOINT_INTERVAL = 4096 };
+
+/* The state of parsing from the beginning of a buffer to CHARPOS.  */
+struct syntax_checkpoint
+  {
+    ptrdiff_t charpos;
+    struct lisp_parse_state state;
+  };
+
+/* The states recorded for a buffer by 'internal--syntax-ppss'.  */
+struct syntax_checkpoints
+  {
+    /* The states at BEG and then every SYNTAX_CHECKPOINT_INTERVAL
+       characters, COUNT of them, in a vector of SIZE.  */
+    struct syntax_checkpoint *v;
+    ptrdiff_t count, size;
+
+    /* The state returned last, if its charpos is nonzero.  */
+    struct syntax_checkpoint last;
+
+    /* Incremented whenever checkpoints are discarded.  */
+    unsigned generation;
+  };
+
+/* The number of characters between the parse states that a bracket
+   index records, to resume parsing from after a change.  */
+enum { BRACKET_CHECKPOINT_INTERVAL = 16384 };
+
+/* The number of consecutive scans with another syntax table after
+   which a bracket index is rebuilt for that table.  */
+enum { BRACKET_INDEX_PATIENCE = 16 };
+
+/* The match of an open parenthesis that is not closed yet, and of a
+   close parenthesis that closes nothing.  */
+enum { BRACKET_UNCLOSED = -1, BRACKET_UNOPENED = -2 };
+
+/* A parenthesis outside strings and comments.  */
+struct bracket
+  {
+    ptrdiff_t charpos;
+    /* The index of the matching parenthesis, or one of
+       BRACKET_UNCLOSED and BRACKET_UNOPENED.  */
+    ptrdiff_t match;
+  };
+
+/* The state of parsing from the beginning of a buffer to CHARPOS,
+   which COUNT parentheses precede.  */
+struct bracket_checkpoint
+  {
+    ptrdiff_t charpos;
+    ptrdiff_t count;
+    struct lisp_parse_state state;
+  };
+
+/* The parentheses of a buffer found by parsing it from the beginning,
+   so that 'scan-lists' can skip from one to the one that matches it;
+   see 'parse-sexp-bracket-index'.  */
+struct bracket_index
+  {
+    /* What the parse depends on, besides the text and its
+       'syntax-table' properties.  */
+    Lisp_Object syntax_table;
+    EMACS_UINT syntax_table_modifications;
+    bool_bf lookup_properties : 1;
+    bool_bf escapable_comment_ends : 1;
+
+    /* Whether a paired delimiter like $ in TeX was found outside
+       strings and comments.  'scan-sexps' pairs those up too.  */
+    bool_bf has_math : 1;
+
+    /* The number of consecutive scans with another syntax table.  */
+    int mismatches;
+
+    /* The parentheses found, COUNT of them in a vector of SIZE.  */
+    struct bracket *v;
+    ptrdiff_t count, size;
+
+    /* The states at BEG and then every BRACKET_CHECKPOINT_INTERVAL
+       characters, N_CHECKPOINTS of them in a vector of
+       CHECKPOINTS_SIZE.  The parentheses after the last one are being
+       recorded, if any.  */
+    struct bracket_checkpoint *checkpoints;
+    ptrdiff_t n_checkpoints, checkpoints_size;
+
+    /* The indexes of the open parentheses not closed yet, outermost
+       first, STACK_COUNT of them in a vector of STACK_SIZE.  */
+    ptrdiff_t *stack;
+    ptrdiff_t stack_count, stack_size;
+
+    /* Incremented whenever parentheses are discarded.  */
+    unsigned generation;
+  };
+
+/* The bracket index that scan_sexps_forward records parentheses in,
+   if any, and whether it is recording them now.  */
+static struct bracket_index *bracket_recorder;
+static bool bracket_recorder_busy;
+
+/* Incremented by 'modify-syntax-entry', which changes syntax tables in
+   place.  */
+static EMACS_UINT syntax_table_modifications;
+
 /* These variables are a cache for finding the start of a defun.
    find_start_pos is the place for which the defun start was found.
    find_start_value is the defun start position found for it.
@@ -184,7 +290,8 @@ static void scan_sexps_forward (struct lisp_parse_state *,
                                 ptrdiff_t, ptrdiff_t, ptrdiff_t, EMACS_INT,
                                 bool, int);
 static void internalize_parse_state (Lisp_Object, struct lisp_parse_state *);
-static bool in_classes (int, Lisp_Object);
+static void record_bracket (ptrdiff_t, bool);
+static ptrdiff_t bracket_index_match (ptrdiff_t, bool);
 static void parse_sexp_propertize (ptrdiff_t charpos);
 
 /* This setter is used only in this file, so it can be private.  */
@@ -1283,6 +1390,8 @@ usage: (modify-syntax-entry CHAR NEWENTRY &optional SYNTAX-TABLE)  */)
   /* We clear the regexp cache, since character classes can now have
      different values from those in the compiled regexps.*/
   clear_regexp_cache ();
+  /* Likewise, bracket indexes may no longer be valid.  */
+  syntax_table_modifications++;
 
   return Qnil;
 }
@@ -1649,9 +1758,88 @@ of this is the distance traveled.  */)
   return skip_syntaxes (0, syntax, lim);
 }
 
-static Lisp_Object
-skip_chars (bool forwardp, Lisp_Object string, Lisp_Object lim,
-	    bool handle_iso_classes)
+/* A character set that is the argument of skip-chars-forward or
+   skip-chars-backward, compiled for a unibyte or multibyte region.  */
+
+enum { SKIP_CHARSET_MAX_STOPS = 3 };
+
+struct skip_charset
+{
+  /* A copy of the string the set was compiled from, and its size in
+     bytes.  */
+  unsigned char *spec;
+  ptrdiff_t spec_bytes;
+
+  /* Whether the string is multibyte, whether the set was compiled for
+     a multibyte region, and whether ISO classes like [:alpha:] were
+     recognized.  */
+  bool_bf spec_multibyte : 1;
+  bool_bf multibyte : 1;
+  bool_bf handle_iso_classes : 1;
+
+  /* Whether the string started with ^.  */
+  bool_bf negate : 1;
+
+  /* Whether every non-ASCII character, or every byte above 0177 in a
+     unibyte region, is skipped.  */
+  bool_bf nonascii_skipped : 1;
+
+  /* Whether ASCII_SKIP and STOPS are valid.  They are not if the set
+     has a class whose ASCII members depend on the syntax or case
+     table.  */
+  bool_bf ascii_known : 1;
+
+  /* The ISO classes in the set, as a mask of 1 << re_wctype_t.  */
+  unsigned int iso_classes;
+
+  /* Whether a byte can start a character in the set.  For a non-ASCII
+     character in a multibyte region, CHAR_RANGES must be checked too.  */
+  char fastmap[0400];
+
+  /* The ranges of non-ASCII characters in the set, as pairs of their
+     first and last characters.  */
+  int *char_ranges;
+  int n_char_ranges;
+
+  /* Whether each ASCII character is skipped.  */
+  char ascii_skip[0200];
+
+  /* The ASCII characters that are not skipped, if there are at most
+     SKIP_CHARSET_MAX_STOPS of them; otherwise N_STOPS is -1.  */
+  int n_stops;
+  unsigned char stops[SKIP_CHARSET_MAX_STOPS];
+};
+
+/* The character sets compiled most recently, most recent first.  Lisp
+   code calls skip-chars-forward in loops with a few constant strings,
+   which need not be parsed each time.  */
+enum { SKIP_CHARSET_CACHE_SIZE = 16 };
+static struct skip_charset *skip_charset_cache[SKIP_CHARSET_CACHE_SIZE];
+
+/* The ISO classes whose ASCII members depend on the syntax table or
+   the case table.  */
+#define CONTEXT_DEPENDENT_CLASSES \
+  ((1u << RECC_WORD) | (1u << RECC_SPACE) \
+   | (1u << RECC_LOWER) | (1u << RECC_UPPER))
+
+/* Return true if character C belongs to one of the ISO classes in
+   ISO_CLASSES, a mask of 1 << re_wctype_t.  */
+
+static bool
+in_classes (int c, unsigned int iso_classes)
+{
+  for (int cc = 0; iso_classes; cc++, iso_classes >>= 1)
+    if ((iso_classes & 1) && re_iswctype (c, cc))
+      return true;
+  return false;
+}
+
+/* Return the character set STRING compiled for a multibyte region if
+   MULTIBYTE, recognizing ISO classes if HANDLE_ISO_CLASSES.  */
+
+static struct skip_charset *
+compile_skip_charset (Lisp_Object string, bool multibyte,
+		      bool handle_iso_classes)
 {
   int c;
   char fastmap[0400];
@@ -1660,33 +1848,32 @@ skip_chars (bool forwardp, Lisp_Object string, Lisp_Object lim,
   int n_char_ranges = 0;
   bool negate = 0;
   ptrdiff_t i, i_byte;
-  /* True if the current buffer is multibyte and the region contains
-     non-ASCII chars.  */
-  bool multibyte;
   /* True if STRING is multibyte and it contains non-ASCII chars.  */
   bool string_multibyte;
   ptrdiff_t size_byte;
   const unsigned char *str;
   int len;
-  Lisp_Object iso_classes;
+  unsigned int iso_classes = 0;
+  struct skip_charset *cs;
   USE_SAFE_ALLOCA;
 
-  CHECK_STRING (string);
-  iso_classes = Qnil;
-
-  if (NILP (lim))
-    XSETINT (lim, forwardp ? ZV : BEGV);
-  else
-    CHECK_FIXNUM_COERCE_MARKER (lim);
-
-  /* In any case, don't allow scan outside bounds of buffer.  */
-  if (XFIXNUM (lim) > ZV)
-    XSETFASTINT (lim, ZV);
-  if (XFIXNUM (lim) < BEGV)
-    XSETFASTINT (lim, BEGV);
+  /* Use the set compiled last time, if it is in the cache.  */
+  for (i = 0; i < SKIP_CHARSET_CACHE_SIZE && skip_charset_cache[i]; i++)
+    {
+      cs = skip_charset_cache[i];
+      if (cs->spec_bytes == SBYTES (string)
+	  && cs->multibyte == multibyte
+	  && cs->handle_iso_classes == handle_iso_classes
+	  && cs->spec_multibyte == STRING_MULTIBYTE (string)
+	  && !memcmp (cs->spec, SDATA (string), cs->spec_bytes))
+	{
+	  memmove (skip_charset_cache + 1, skip_charset_cache,
+		   i * sizeof *skip_charset_cache);
+	  skip_charset_cache[0] = cs;
+	  return cs;
+	}
+    }
 
-  multibyte = (!NILP (BVAR (current_buffer, enable_multibyte_characters))
-	       && (XFIXNUM (lim) - PT != CHAR_TO_BYTE (XFIXNUM (lim)) - PT_BYTE));
   string_multibyte = SBYTES (string) > SCHARS (string);
 
   memset (fastmap, 0, sizeof fastmap);
@@ -1722,7 +1909,7 @@ skip_chars (bool forwardp, Lisp_Object string, Lisp_Object lim,
 		error ("Invalid ISO C character class");
 	      if (cc != -1)
 		{
-		  iso_classes = Fcons (make_fixnum (cc), iso_classes);
+		  iso_classes |= 1u << cc;
 		  i_byte = ch - str;
 		  continue;
 		}
@@ -1818,7 +2005,7 @@ skip_chars (bool forwardp, Lisp_Object string, Lisp_Object lim,
 		error ("Invalid ISO C character class");
 	      if (cc != -1)
 		{
-		  iso_classes = Fcons (make_fixnum (cc), iso_classes);
+		  iso_classes |= 1u << cc;
 		  i_byte = ch - str;
 		  continue;
 		}
@@ -1929,6 +2116,191 @@ skip_chars (bool forwardp, Lisp_Object string, Lisp_Object lim,
 	}
     }
 
+  /* Record the compiled set in the cache, replacing the least
+     recently used one.  */
+  cs = skip_charset_cache[SKIP_CHARSET_CACHE_SIZE - 1];
+  if (cs)
+    {
+      xfree (cs->spec);
+      xfree (cs->char_ranges);
+      xfree (cs);
+    }
+  memmove (skip_charset_cache + 1, skip_charset_cache,
+	   (SKIP_CHARSET_CACHE_SIZE - 1) * sizeof *skip_charset_cache);
+  cs = xzalloc (sizeof *cs);
+  skip_charset_cache[0] = cs;
+  cs->spec = xmalloc (size_byte);
+  memcpy (cs->spec, str, size_byte);
+  cs->spec_bytes = size_byte;
+  cs->spec_multibyte = STRING_MULTIBYTE (string);
+  cs->multibyte = multibyte;
+  cs->handle_iso_classes = handle_iso_classes;
+  cs->negate = negate;
+  cs->iso_classes = iso_classes;
+  memcpy (cs->fastmap, fastmap, sizeof fastmap);
+  if (n_char_ranges > 0)
+    {
+      cs->char_ranges = xnmalloc (n_char_ranges, sizeof *char_ranges);
+      memcpy (cs->char_ranges, char_ranges,
+	      n_char_ranges * sizeof *char_ranges);
+    }
+  cs->n_char_ranges = n_char_ranges;
+  SAFE_FREE ();
+
+  cs->nonascii_skipped
+    = (!iso_classes
+       && (multibyte
+	   ? negate && n_char_ranges == 0
+	   : !memchr (fastmap + 0200, 0, 0200)));
+  cs->ascii_known = !(iso_classes & CONTEXT_DEPENDENT_CLASSES);
+  cs->n_stops = -1;
+  if (cs->ascii_known)
+    {
+      cs->n_stops = 0;
+      for (c = 0; c < 0200; c++)
+	{
+	  /* An ISO class takes precedence over the fastmap; see
+	     skip_chars.  */
+	  cs->ascii_skip[c] = (iso_classes && in_classes (c, iso_classes)
+			       ? !negate : fastmap[c]);
+	  if (!cs->ascii_skip[c] && 0 <= cs->n_stops)
+	    {
+	      if (cs->n_stops < SKIP_CHARSET_MAX_STOPS)
+		cs->stops[cs->n_stops++] = c;
+	      else
+		cs->n_stops = -1;
+	    }
+	}
+    }
+
+  return cs;
+}
+
+/* Return the number of characters in the NBYTES bytes of multibyte
+   text at P.  */
+
+static ptrdiff_t
+count_multibyte_chars (unsigned char const *p, ptrdiff_t nbytes)
+{
+  uint64_t const highs = 0x8080808080808080;
+  ptrdiff_t i = 0, tails = 0;
+
+  /* A byte that is not the head of a character has its high bit set
+     and the next bit clear.  */
+  for (; i <= nbytes - 8; i += 8)
+    {
+      uint64_t w;
+      memcpy (&w, p + i, sizeof w);
+      tails += count_one_bits_ll (w & ~(w << 1) & highs);
+    }
+  for (; i < nbytes; i++)
+    tails += !CHAR_HEAD_P (p[i]);
+  return nbytes - tails;
+}
+
+/* Return true if the word W contains a byte that CS does not skip as
+   part of a run; see skip_charset_run.  */
+
+static bool
+skip_charset_word_stops (struct skip_charset const *cs, uint64_t w)
+{
+  uint64_t const ones = 0x0101010101010101;
+  uint64_t const highs = ones << 7;
+  uint64_t found = cs->nonascii_skipped ? 0 : w;
+
+  for (int j = 0; j < cs->n_stops; j++)
+    {
+      uint64_t v = w ^ (cs->stops[j] * ones);
+      found |= (v - ones) & ~v;
+    }
+  return (found & highs) != 0;
+}
+
+/* Return true if CS does not skip the byte B as part of a run.  */
+
+static bool
+skip_charset_byte_stops (struct skip_charset const *cs, unsigned char b)
+{
+  return (ASCII_CHAR_P (b) ? !cs->ascii_skip[b] : !cs->nonascii_skipped);
+}
+
+/* Return the number of bytes from P, up to LIMIT, that the character
+   set CS skips as a whole, looking at a word at a time as long as
+   possible.  These are the bytes other than those of CS->stops, and
+   other than non-ASCII bytes unless CS->nonascii_skipped.  If
+   FORWARDP, the bytes are those after P; otherwise, they are the
+   bytes before P, and LIMIT is less than P.  CS->n_stops must not be
+   negative.  */
+
+static ptrdiff_t
+skip_charset_run (struct skip_charset const *cs, bool forwardp,
+		  unsigned char const *p, unsigned char const *limit)
+{
+  ptrdiff_t len = forwardp ? limit - p : p - limit, i = 0;
+
+  eassume (0 <= cs->n_stops && cs->n_stops <= SKIP_CHARSET_MAX_STOPS);
+
+  /* A single stop byte, and nothing else to stop at: that is what
+     memchr is for.  */
+  if (cs->n_stops == 1 && cs->nonascii_skipped)
+    {
+      unsigned char const *q
+	= (forwardp ? memchr (p, cs->stops[0], len)
+	   : memrchr (limit, cs->stops[0], len));
+      return !q ? len : forwardp ? q - p : p - q - 1;
+    }
+
+  for (; i <= len - 8; i += 8)
+    {
+      uint64_t w;
+      memcpy (&w, forwardp ? p + i : p - i - 8, sizeof w);
+      if (skip_charset_word_stops (cs, w))
+	break;
+    }
+  for (; i < len; i++)
+    if (skip_charset_byte_stops (cs, forwardp ? p[i] : p[-i - 1]))
+      break;
+  return i;
+}
+
+static Lisp_Object
+skip_chars (bool forwardp, Lisp_Object string, Lisp_Object lim,
+	    bool handle_iso_classes)
+{
+  int c;
+  ptrdiff_t i;
+  /* True if the current buffer is multibyte and the region contains
+     non-ASCII chars.  */
+  bool multibyte;
+
+  CHECK_STRING (string);
+
+  if (NILP (lim))
+    XSETINT (lim, forwardp ? ZV : BEGV);
+  else
+    CHECK_FIXNUM_COERCE_MARKER (lim);
+
+  /* In any case, don't allow scan outside bounds of buffer.  */
+  if (XFIXNUM (lim) > ZV)
+    XSETFASTINT (lim, ZV);
+  if (XFIXNUM (lim) < BEGV)
+    XSETFASTINT (lim, BEGV);
+
+  multibyte = (!NILP (BVAR (current_buffer, enable_multibyte_characters))
+	       && (XFIXNUM (lim) - PT != CHAR_TO_BYTE (XFIXNUM (lim)) - PT_BYTE));
+
+  struct skip_charset const *cs
+    = compile_skip_charset (string, multibyte, handle_iso_classes);
+  char const *fastmap = cs->fastmap;
+  int const *char_ranges = cs->char_ranges;
+  int n_char_ranges = cs->n_char_ranges;
+  bool negate = cs->negate;
+  unsigned int iso_classes = cs->iso_classes;
+  /* Whether ASCII characters can be looked up in CS->ascii_skip, and
+     whether runs of bytes can be skipped as a whole.  */
+  bool ascii_known = cs->ascii_known;
+  bool runs = 0 <= cs->n_stops;
+
   {
     ptrdiff_t start_point = PT;
     ptrdiff_t pos = PT;
@@ -1966,8 +2338,28 @@ skip_chars (bool forwardp, Lisp_Object string, Lisp_Object lim,
 		  p = GAP_END_ADDR;
 		  stop = endp;
 		}
+	      if (runs)
+		{
+		  ptrdiff_t n = skip_charset_run (cs, true, p, stop);
+		  if (n > 0)
+		    {
+		      pos += (cs->nonascii_skipped
+			      ? count_multibyte_chars (p, n) : n);
+		      p += n, pos_byte += n;
+		      rarely_quit (pos);
+		      continue;
+		    }
+		}
+	      if (ascii_known && ASCII_CHAR_P (*p))
+		{
+		  if (! cs->ascii_skip[*p])
+		    break;
+		  p++, pos++, pos_byte++;
+		  rarely_quit (pos);
+		  continue;
+		}
 	      c = string_char_and_length (p, &nbytes);
-	      if (! NILP (iso_classes) && in_classes (c, iso_classes))
+	      if (iso_classes && in_classes (c, iso_classes))
 		{
 		  if (negate)
 		    break;
@@ -2008,7 +2400,24 @@ skip_chars (bool forwardp, Lisp_Object string, Lisp_Object lim,
 		  stop = endp;
 		}
 
-	      if (!NILP (iso_classes) && in_classes (*p, iso_classes))
+	      if (runs)
+		{
+		  ptrdiff_t n = skip_charset_run (cs, true, p, stop);
+		  if (n > 0)
+		    {
+		      p += n, pos += n, pos_byte += n;
+		      rarely_quit (pos);
+		      continue;
+		    }
+		}
+	      if (ascii_known && ASCII_CHAR_P (*p))
+		{
+		  if (! cs->ascii_skip[*p])
+		    break;
+		  goto fwd_unibyte_ok;
+		}
+
+	      if (iso_classes && in_classes (*p, iso_classes))
 		{
 		  if (negate)
 		    break;
@@ -2035,6 +2444,26 @@ skip_chars (bool forwardp, Lisp_Object string, Lisp_Object lim,
 		  p = GPT_ADDR;
 		  stop = endp;
 		}
+	      if (runs)
+		{
+		  ptrdiff_t n = skip_charset_run (cs, false, p, stop);
+		  if (n > 0)
+		    {
+		      pos -= (cs->nonascii_skipped
+			      ? count_multibyte_chars (p - n, n) : n);
+		      p -= n, pos_byte -= n;
+		      rarely_quit (pos);
+		      continue;
+		    }
+		}
+	      if (ascii_known && ASCII_CHAR_P (p[-1]))
+		{
+		  if (! cs->ascii_skip[p[-1]])
+		    break;
+		  p--, pos--, pos_byte--;
+		  rarely_quit (pos);
+		  continue;
+		}
 	      unsigned char *prev_p = p;
 	      do
 		p--;
@@ -2042,7 +2471,7 @@ skip_chars (bool forwardp, Lisp_Object string, Lisp_Object lim,
 
 	      c = STRING_CHAR (p);
 
-	      if (! NILP (iso_classes) && in_classes (c, iso_classes))
+	      if (iso_classes && in_classes (c, iso_classes))
 		{
 		  if (negate)
 		    break;
@@ -2076,7 +2505,24 @@ skip_chars (bool forwardp, Lisp_Object string, Lisp_Object lim,
 		  stop = endp;
 		}
 
-	      if (! NILP (iso_classes) && in_classes (p[-1], iso_classes))
+	      if (runs)
+		{
+		  ptrdiff_t n = skip_charset_run (cs, false, p, stop);
+		  if (n > 0)
+		    {
+		      p -= n, pos -= n, pos_byte -= n;
+		      rarely_quit (pos);
+		      continue;
+		    }
+		}
+	      if (ascii_known && ASCII_CHAR_P (p[-1]))
+		{
+		  if (! cs->ascii_skip[p[-1]])
+		    break;
+		  goto back_unibyte_ok;
+		}
+
+	      if (iso_classes && in_classes (p[-1], iso_classes))
 		{
 		  if (negate)
 		    break;
@@ -2094,12 +2540,32 @@ skip_chars (bool forwardp, Lisp_Object string, Lisp_Object lim,
 
     SET_PT_BOTH (pos, pos_byte);
 
-    SAFE_FREE ();
     return make_fixnum (PT - start_point);
   }
 }
 
 
+/* Return the syntax class of character C, like SYNTAX.  Remember the
+   classes of ASCII characters in MEMO, which is for the syntax table
+   *MEMO_TABLE; reset MEMO when the syntax table at hand is another.
+   Syntax tables can be changed in place, so MEMO must not outlive a
+   single scan.  */
+
+static enum syntaxcode
+memo_syntax (int c, signed char memo[0200], Lisp_Object *memo_table)
+{
+  if (! ASCII_CHAR_P (c) || gl_state.use_global)
+    return SYNTAX (c);
+  if (! EQ (*memo_table, gl_state.current_syntax_table))
+    {
+      memset (memo, -1, 0200);
+      *memo_table = gl_state.current_syntax_table;
+    }
+  if (memo[c] < 0)
+    memo[c] = SYNTAX (c);
+  return memo[c];
+}
+
 static Lisp_Object
 skip_syntaxes (bool forwardp, Lisp_Object string, Lisp_Object lim)
 {
@@ -2165,6 +2631,8 @@ skip_syntaxes (bool forwardp, Lisp_Object string, Lisp_Object lim)
     ptrdiff_t pos = PT;
     ptrdiff_t pos_byte = PT_BYTE;
     unsigned char *p, *endp, *stop;
+    signed char memo[0200];
+    Lisp_Object memo_table = Qnil;
 
     SETUP_SYNTAX_TABLE (pos, forwardp ? 1 : -1);
 
@@ -2187,11 +2655,11 @@ skip_syntaxes (bool forwardp, Lisp_Object string, Lisp_Object lim)
 		    p = GAP_END_ADDR;
 		    stop = endp;
 		  }
-		if (multibyte)
+		if (multibyte && ! ASCII_CHAR_P (*p))
 		  c = string_char_and_length (p, &nbytes);
 		else
 		  c = *p, nbytes = 1;
-		if (! fastmap[SYNTAX (c)])
+		if (! fastmap[memo_syntax (c, memo, &memo_table)])
 		  goto done;
 		p += nbytes, pos++, pos_byte += nbytes;
 		rarely_quit (pos);
@@ -2223,12 +2691,17 @@ skip_syntaxes (bool forwardp, Lisp_Object string, Lisp_Object lim)
 		UPDATE_SYNTAX_TABLE_BACKWARD (pos - 1);
 
 		unsigned char *prev_p = p;
-		do
-		  p--;
-		while (stop <= p && ! CHAR_HEAD_P (*p));
+		if (ASCII_CHAR_P (p[-1]))
+		  c = *--p;
+		else
+		  {
+		    do
+		      p--;
+		    while (stop <= p && ! CHAR_HEAD_P (*p));
 
-		c = STRING_CHAR (p);
-		if (! fastmap[SYNTAX (c)])
+		    c = STRING_CHAR (p);
+		  }
+		if (! fastmap[memo_syntax (c, memo, &memo_table)])
 		  break;
 		pos--, pos_byte -= prev_p - p;
 		rarely_quit (pos);
@@ -2246,7 +2719,7 @@ skip_syntaxes (bool forwardp, Lisp_Object string, Lisp_Object lim)
 		    stop = endp;
 		  }
 		UPDATE_SYNTAX_TABLE_BACKWARD (pos - 1);
-		if (! fastmap[SYNTAX (p[-1])])
+		if (! fastmap[memo_syntax (p[-1], memo, &memo_table)])
 		  break;
 		p--, pos--, pos_byte--;
 		rarely_quit (pos);
@@ -2261,28 +2734,6 @@ skip_syntaxes (bool forwardp, Lisp_Object string, Lisp_Object lim)
   }
 }
 
-/* Return true if character C belongs to one of the ISO classes
-   in the list ISO_CLASSES.  Each class is represented by an
-   integer which is its type according to re_wctype.  */
-
-static bool
-in_classes (int c, Lisp_Object iso_classes)
-{
-  bool fits_class = 0;
-
-  while (CONSP (iso_classes))
-    {
-      Lisp_Object elt;
-      elt = XCAR (iso_classes);
-      iso_classes = XCDR (iso_classes);
-
-      if (re_iswctype (c, XFIXNAT (elt)))
-	fits_class = 1;
-    }
-
-  return fits_class;
-}
-
 /* Jump over a comment, assuming we are at the beginning of one.
    FROM is the current position.
    FROM_BYTE is the bytepos corresponding to FROM.
@@ -2796,6 +3247,27 @@ scan_lists (EMACS_INT from0, EMACS_INT count, EMACS_INT depth, bool sexpflag)
 	      FALLTHROUGH;
 	    case Sopen:
 	      if (!++depth) goto done;
+	      /* Skip to the matching parenthesis, if the bracket index
+		 knows it.  Nothing in between can end the scan, since
+		 the depth stays positive there.  The index parses
+		 multibyte characters with their own syntax, so when
+		 they are symbols to us, it only tells about ASCII
+		 text.  */
+	      if (parse_sexp_bracket_index && code == Sopen && depth > 0)
+		{
+		  ptrdiff_t match = bracket_index_match (from - 1, sexpflag);
+		  if (from <= match && match < stop)
+		    {
+		      ptrdiff_t match_byte = CHAR_TO_BYTE (match);
+		      if (!multibyte_symbol_p
+			  || match_byte - from_byte == match - from)
+			{
+			  from = match;
+			  from_byte = match_byte;
+			}
+		    }
+		  SETUP_SYNTAX_TABLE (from, 1);
+		}
 	      break;
 
 	    case Sclose:
@@ -2948,6 +3420,23 @@ scan_lists (EMACS_INT from0, EMACS_INT count, EMACS_INT depth, bool sexpflag)
 	      FALLTHROUGH;
 	    case Sclose:
 	      if (!++depth) goto done2;
+	      /* Skip to just after the matching parenthesis, if the
+		 bracket index knows it.  */
+	      if (parse_sexp_bracket_index && code == Sclose && depth > 0)
+		{
+		  ptrdiff_t match = bracket_index_match (from, sexpflag);
+		  if (stop <= match && match < from)
+		    {
+		      ptrdiff_t match_byte = CHAR_TO_BYTE (match + 1);
+		      if (!multibyte_symbol_p
+			  || from_byte - match_byte == from - (match + 1))
+			{
+			  from = match + 1;
+			  from_byte = match_byte;
+			}
+		    }
+		  SETUP_SYNTAX_TABLE (from, -1);
+		}
 	      break;
 
 	    case Sopen:
@@ -3194,6 +3683,13 @@ scan_sexps_forward (struct lisp_parse_state *state,
   ptrdiff_t out_bytepos, out_charpos;
   int temp;
   unsigned short int quit_count = 0;
+  /* Whether to record parentheses in the bracket index being
+     extended.  Parsing that Lisp code does in the meantime, for
+     'syntax-propertize', must not record them.  */
+  bool record_brackets = bracket_recorder && !bracket_recorder_busy;
+
+  if (record_brackets)
+    bracket_recorder_busy = true;
 
   prev_from = from;
   prev_from_byte = from_byte;
@@ -3366,6 +3862,8 @@ do { prev_from = from;				\
 
 	case Sopen:
 	  if (stopbefore) goto stop;  /* this arg means stop at sexp start */
+	  if (record_brackets && bracket_recorder)
+	    record_bracket (prev_from, true);
 	  depth++;
 	  /* curlevel++->last ran into compiler bug on Apollo */
 	  curlevel->last = prev_from;
@@ -3377,6 +3875,8 @@ do { prev_from = from;				\
 	  break;
 
 	case Sclose:
+	  if (record_brackets && bracket_recorder)
+	    record_bracket (prev_from, false);
 	  depth--;
 	  if (depth < mindepth)
 	    mindepth = depth;
@@ -3443,6 +3943,8 @@ do { prev_from = from;				\
 
 	case Smath:
 	  /* FIXME: We should do something with it.  */
+	  if (record_brackets && bracket_recorder)
+	    bracket_recorder->has_math = true;
 	  break;
 	default:
 	  /* Ignore whitespace, punctuation, quote, endcomment.  */
@@ -3473,6 +3975,8 @@ do { prev_from = from;				\
                                 state->levelstarts);
   state->prev_syntax = (SYNTAX_FLAGS_COMSTARTEND_FIRST (prev_from_syntax)
                         || state->quoted) ? prev_from_syntax : Smax;
+  if (record_brackets)
+    bracket_recorder_busy = false;
 }
 
 /* Convert a (lisp) parse state to the internal form used in
@@ -3542,6 +4046,41 @@ internalize_parse_state (Lisp_Object external, struct lisp_parse_state *state)
     }
 }
 
+/* Convert the internal parse state STATE to the list that
+   'parse-partial-sexp' returns.  */
+static Lisp_Object
+externalize_parse_state (struct lisp_parse_state *state)
+{
+  return
+    Fcons (make_fixnum (state->depth),
+	   Fcons (state->prevlevelstart < 0
+		  ? Qnil : make_fixnum (state->prevlevelstart),
+	     Fcons (state->thislevelstart < 0
+		    ? Qnil : make_fixnum (state->thislevelstart),
+	       Fcons (state->instring >= 0
+		      ? (state->instring == ST_STRING_STYLE
+			 ? Qt : make_fixnum (state->instring)) : Qnil,
+		 Fcons (state->incomment < 0 ? Qt :
+			(state->incomment == 0 ? Qnil :
+			 make_fixnum (state->incomment)),
+		   Fcons (state->quoted ? Qt : Qnil,
+		     Fcons (make_fixnum (state->mindepth),
+		       Fcons ((state->comstyle
+			       ? (state->comstyle == ST_COMMENT_STYLE
+				  ? Qsyntax_table
+				  : make_fixnum (state->comstyle))
+			       : Qnil),
+		         Fcons (((state->incomment
+                                  || (state->instring >= 0))
+                                 ? make_fixnum (state->comstr_start)
+                                 : Qnil),
+			   Fcons (state->levelstarts,
+                             Fcons (state->prev_syntax == Smax
+                                    ? Qnil
+                                    : make_fixnum (state->prev_syntax),
+                                Qnil)))))))))));
+}
+
 DEFUN ("parse-partial-sexp", Fparse_partial_sexp, Sparse_partial_sexp, 2, 6, 0,
        doc: /* Parse Lisp syntax starting at FROM until TO; return status of parse at TO.
 Parsing stops at TO or when certain criteria are met;
@@ -3608,34 +4147,506 @@ Sixth arg COMMENTSTOP non-nil means stop after the start of a comment.
 
   SET_PT_BOTH (state.location, state.location_byte);
 
-  return
-    Fcons (make_fixnum (state.depth),
-	   Fcons (state.prevlevelstart < 0
-		  ? Qnil : make_fixnum (state.prevlevelstart),
-	     Fcons (state.thislevelstart < 0
-		    ? Qnil : make_fixnum (state.thislevelstart),
-	       Fcons (state.instring >= 0
-		      ? (state.instring == ST_STRING_STYLE
-			 ? Qt : make_fixnum (state.instring)) : Qnil,
-		 Fcons (state.incomment < 0 ? Qt :
-			(state.incomment == 0 ? Qnil :
-			 make_fixnum (state.incomment)),
-		   Fcons (state.quoted ? Qt : Qnil,
-		     Fcons (make_fixnum (state.mindepth),
-		       Fcons ((state.comstyle
-			       ? (state.comstyle == ST_COMMENT_STYLE
-				  ? Qsyntax_table
-				  : make_fixnum (state.comstyle))
-			       : Qnil),
-		         Fcons (((state.incomment
-                                  || (state.instring >= 0))
-                                 ? make_fixnum (state.comstr_start)
-                                 : Qnil),
-			   Fcons (state.levelstarts,
-                             Fcons (state.prev_syntax == Smax
-                                    ? Qnil
-                                    : make_fixnum (state.prev_syntax),
-                                Qnil)))))))))));
+  return externalize_parse_state (&state);
+}
+
+/* Return the number of checkpoints of C at or before CHARPOS.  */
+
+static ptrdiff_t
+syntax_checkpoints_upto (struct syntax_checkpoints *c, ptrdiff_t charpos)
+{
+  ptrdiff_t lo = 0, hi = c->count;
+  while (lo < hi)
+    {
+      ptrdiff_t mid = lo + (hi - lo) / 2;
+      if (c->v[mid].charpos <= charpos)
+	lo = mid + 1;
+      else
+	hi = mid;
+    }
+  return lo;
+}
+
+/* Discard the states of C that depend on the text at or after
+   CHARPOS.  */
+
+static void
+discard_syntax_checkpoints (struct syntax_checkpoints *c, ptrdiff_t charpos)
+{
+  ptrdiff_t count = max (1, syntax_checkpoints_upto (c, charpos));
+  bool last = c->last.charpos > charpos;
+  if (count < c->count || last)
+    {
+      c->count = min (c->count, count);
+      if (last)
+	c->last.charpos = 0;
+      c->generation++;
+    }
+}
+
+static void discard_brackets (struct bracket_index *, ptrdiff_t);
+
+/* Discard the states recorded by 'internal--syntax-ppss' for B, and
+   the parentheses of its bracket index, that depend on the text at or
+   after CHARPOS.  */
+
+static void
+discard_parse_caches (struct buffer *b, ptrdiff_t charpos)
+{
+  if (b->syntax_checkpoints)
+    discard_syntax_checkpoints (b->syntax_checkpoints, charpos);
+  if (b->bracket_index)
+    discard_brackets (b->bracket_index, charpos);
+}
+
+/* Discard the states recorded by 'internal--syntax-ppss', and the
+   parentheses of the bracket indexes, that depend on the text at or
+   after CHARPOS, for B and the other buffers that share its text.  */
+
+void
+invalidate_syntax_checkpoints (struct buffer *b, ptrdiff_t charpos)
+{
+  if (b->base_buffer || b->indirections > 0)
+    {
+      Lisp_Object tail, buf;
+      FOR_EACH_LIVE_BUFFER (tail, buf)
+	if (XBUFFER (buf)->text == b->text)
+	  discard_parse_caches (XBUFFER (buf), charpos);
+    }
+  else
+    discard_parse_caches (b, charpos);
+}
+
+void
+free_syntax_checkpoints (struct buffer *b)
+{
+  struct syntax_checkpoints *c = b->syntax_checkpoints;
+  if (c)
+    {
+      xfree (c->v);
+      xfree (c);
+      b->syntax_checkpoints = NULL;
+    }
+}
+
+void
+mark_syntax_checkpoints (struct buffer *b)
+{
+  struct syntax_checkpoints *c = b->syntax_checkpoints;
+  if (c)
+    {
+      for (ptrdiff_t i = 0; i < c->count; i++)
+	mark_object (c->v[i].state.levelstarts);
+      if (c->last.charpos)
+	mark_object (c->last.state.levelstarts);
+    }
+}
+
+/* Return the checkpoints of the current buffer, allocating them if
+   needed.  Like the cache of 'syntax-ppss', they are not discarded
+   when the syntax table changes; 'syntax-ppss' always parses with the
+   same one.  */
+
+static struct syntax_checkpoints *
+current_syntax_checkpoints (void)
+{
+  struct syntax_checkpoints *c = current_buffer->syntax_checkpoints;
+
+  if (c)
+    return c;
+
+  c = xzalloc (sizeof *c);
+  c->v = xpalloc (NULL, &c->size, 1, -1, sizeof *c->v);
+  current_buffer->syntax_checkpoints = c;
+  c->count = 1;
+  c->v[0].charpos = BEG;
+  internalize_parse_state (Qnil, &c->v[0].state);
+  return c;
+}
+
+DEFUN ("internal--syntax-ppss", Finternal__syntax_ppss,
+       Sinternal__syntax_ppss, 1, 1, 0,
+       doc: /* Return the state of parsing from the beginning of the buffer to POS.
+The value is like that of `parse-partial-sexp' from `point-min' to
+POS, except that elements 2 and 6 cannot be relied upon.  Point is
+set to POS.
+
+The states at regular intervals in the buffer are recorded, and the
+parse starts from the nearest one before POS.  They are discarded
+when the text of the buffer or its `syntax-table' or `category'
+properties change, and by `internal--syntax-ppss-flush'.
+
+This is an internal function used by `syntax-ppss'.  */)
+  (Lisp_Object pos)
+{
+  struct lisp_parse_state state;
+  EMACS_INT target = TYPE_MINIMUM (EMACS_INT);
+  ptrdiff_t to = fix_position (pos);
+  ptrdiff_t from;
+
+  if (! (BEGV <= to && to <= ZV))
+    args_out_of_range (make_fixnum (BEGV), pos);
+
+  if (BEGV != BEG)
+    {
+      /* The recorded states are for the whole buffer.  */
+      internalize_parse_state (Qnil, &state);
+      scan_sexps_forward (&state, BEGV, BEGV_BYTE, to, target, false, 0);
+      SET_PT_BOTH (state.location, state.location_byte);
+      return externalize_parse_state (&state);
+    }
+
+  struct syntax_checkpoints *c = current_syntax_checkpoints ();
+  ptrdiff_t k = syntax_checkpoints_upto (c, to) - 1;
+  bool extend = k == c->count - 1;
+
+  if (c->last.charpos && c->v[k].charpos < c->last.charpos
+      && c->last.charpos <= to)
+    {
+      from = c->last.charpos;
+      state = c->last.state;
+      extend = false;
+    }
+  else
+    {
+      from = c->v[k].charpos;
+      state = c->v[k].state;
+    }
+
+  /* Record a state every SYNTAX_CHECKPOINT_INTERVAL characters on
+     the way to TO, unless the checkpoints change while parsing, as
+     they can if parsing runs 'syntax-propertize'.  */
+  while (extend && to - from >= SYNTAX_CHECKPOINT_INTERVAL)
+    {
+      unsigned generation = c->generation;
+      ptrdiff_t next = from + SYNTAX_CHECKPOINT_INTERVAL;
+      scan_sexps_forward (&state, from, CHAR_TO_BYTE (from), next,
+			  target, false, 0);
+      c = current_buffer->syntax_checkpoints;
+      extend = (c && c->generation == generation
+		&& c->v[c->count - 1].charpos == from
+		&& state.location == next);
+      from = state.location;
+      if (extend)
+	{
+	  if (c->count == c->size)
+	    c->v = xpalloc (c->v, &c->size, 1, -1, sizeof *c->v);
+	  c->v[c->count].charpos = from;
+	  c->v[c->count].state = state;
+	  c->count++;
+	}
+    }
+
+  unsigned generation = c ? c->generation : 0;
+  scan_sexps_forward (&state, from, CHAR_TO_BYTE (from), to,
+		      target, false, 0);
+  c = current_buffer->syntax_checkpoints;
+  if (c && c->generation == generation && state.location == to)
+    {
+      c->last.charpos = to;
+      c->last.state = state;
+    }
+
+  SET_PT_BOTH (state.location, state.location_byte);
+  return externalize_parse_state (&state);
+}
+
+DEFUN ("internal--syntax-ppss-flush", Finternal__syntax_ppss_flush,
+       Sinternal__syntax_ppss_flush, 1, 1, 0,
+       doc: /* Discard the states recorded by `internal--syntax-ppss' after BEG.
+This is an internal function used by `syntax-ppss-flush-cache'.  */)
+  (Lisp_Object beg)
+{
+  CHECK_FIXNUM (beg);
+  invalidate_syntax_checkpoints (current_buffer, XFIXNUM (beg));
+  return Qnil;
+}
+
+/* Return the index of the parenthesis at CHARPOS in the bracket index
+   B, or -1 if there is none.  */
+
+static ptrdiff_t
+find_bracket (struct bracket_index *b, ptrdiff_t charpos)
+{
+  ptrdiff_t lo = 0, hi = b->count;
+  while (lo < hi)
+    {
+      ptrdiff_t mid = lo + (hi - lo) / 2;
+      if (b->v[mid].charpos < charpos)
+	lo = mid + 1;
+      else
+	hi = mid;
+    }
+  return lo < b->count && b->v[lo].charpos == charpos ? lo : -1;
+}
+
+/* Record a parenthesis at CHARPOS, open if OPEN, in the bracket index
+   being extended.  */
+
+static void
+record_bracket (ptrdiff_t charpos, bool open)
+{
+  struct bracket_index *b = bracket_recorder;
+  ptrdiff_t i = b->count;
+
+  if (i == b->size)
+    b->v = xpalloc (b->v, &b->size, 1, -1, sizeof *b->v);
+  b->v[i].charpos = charpos;
+  if (open)
+    {
+      b->v[i].match = BRACKET_UNCLOSED;
+      if (b->stack_count == b->stack_size)
+	b->stack = xpalloc (b->stack, &b->stack_size, 1, -1,
+			    sizeof *b->stack);
+      b->stack[b->stack_count++] = i;
+    }
+  else if (b->stack_count == 0)
+    b->v[i].match = BRACKET_UNOPENED;
+  else
+    {
+      ptrdiff_t j = b->stack[--b->stack_count];
+      b->v[j].match = i;
+      b->v[i].match = j;
+    }
+  b->count = i + 1;
+}
+
+/* Keep only the first COUNT parentheses of the bracket index B.  */
+
+static void
+truncate_brackets (struct bracket_index *b, ptrdiff_t count)
+{
+  ptrdiff_t i = count - 1;
+
+  b->count = count;
+  b->stack_count = 0;
+
+  /* The parentheses left open are those not closed by the ones that
+     are kept.  Find them from the last one, skipping over the pairs
+     that are closed, and stop at one that closes nothing, since
+     nothing is open before it.  */
+  while (0 <= i && b->v[i].match != BRACKET_UNOPENED)
+    if (0 <= b->v[i].match && b->v[i].match < i)
+      i = b->v[i].match - 1;
+    else
+      {
+	b->v[i].match = BRACKET_UNCLOSED;
+	if (b->stack_count == b->stack_size)
+	  b->stack = xpalloc (b->stack, &b->stack_size, 1, -1,
+			      sizeof *b->stack);
+	b->stack[b->stack_count++] = i--;
+      }
+
+  /* Put the outermost first.  */
+  for (ptrdiff_t j = 0, k = b->stack_count - 1; j < k; j++, k--)
+    {
+      ptrdiff_t t = b->stack[j];
+      b->stack[j] = b->stack[k];
+      b->stack[k] = t;
+    }
+}
+
+/* Discard the parentheses of the bracket index B that depend on the
+   text at or after CHARPOS.  Since a change can also affect how the
+   character before it is parsed, parsing resumes from a state before
+   CHARPOS.  */
+
+static void
+discard_brackets (struct bracket_index *b, ptrdiff_t charpos)
+{
+  ptrdiff_t lo = 1, hi = b->n_checkpoints;
+
+  if (b->checkpoints[hi - 1].charpos < charpos)
+    return;
+  while (lo < hi)
+    {
+      ptrdiff_t mid = lo + (hi - lo) / 2;
+      if (b->checkpoints[mid].charpos < charpos)
+	lo = mid + 1;
+      else
+	hi = mid;
+    }
+  b->n_checkpoints = lo;
+  truncate_brackets (b, b->checkpoints[lo - 1].count);
+  b->generation++;
+  if (bracket_recorder == b)
+    bracket_recorder = NULL;
+}
+
+/* Forget all the parentheses of the bracket index B, and make it
+   parse with the syntax table TABLE.  */
+
+static void
+reset_bracket_index (struct bracket_index *b, Lisp_Object table)
+{
+  b->syntax_table = table;
+  b->syntax_table_modifications = syntax_table_modifications;
+  b->lookup_properties = parse_sexp_lookup_properties;
+  b->escapable_comment_ends = comment_end_can_be_escaped;
+  b->has_math = false;
+  b->count = 0;
+  b->stack_count = 0;
+  b->n_checkpoints = 1;
+  b->checkpoints[0].charpos = BEG;
+  b->checkpoints[0].count = 0;
+  internalize_parse_state (Qnil, &b->checkpoints[0].state);
+  b->generation++;
+  if (bracket_recorder == b)
+    bracket_recorder = NULL;
+}
+
+void
+free_bracket_index (struct buffer *buf)
+{
+  struct bracket_index *b = buf->bracket_index;
+  if (b)
+    {
+      if (bracket_recorder == b)
+	bracket_recorder = NULL;
+      xfree (b->v);
+      xfree (b->checkpoints);
+      xfree (b->stack);
+      xfree (b);
+      buf->bracket_index = NULL;
+    }
+}
+
+void
+mark_bracket_index (struct buffer *buf)
+{
+  /* The recorded states have no levelstarts to mark.  */
+  if (buf->bracket_index)
+    mark_object (buf->bracket_index->syntax_table);
+}
+
+/* Return the bracket index of the current buffer, allocating it if
+   needed, or NULL if it is not to be used.  */
+
+static struct bracket_index *
+current_bracket_index (void)
+{
+  struct bracket_index *b = current_buffer->bracket_index;
+  Lisp_Object table = BVAR (current_buffer, syntax_table);
+
+  /* The parse of the index treats comments as comments.  Don't use
+     the index while it is being extended, from Lisp code that runs
+     for 'syntax-propertize'.  */
+  if (!parse_sexp_bracket_index || !parse_sexp_ignore_comments
+      || bracket_recorder)
+    return NULL;
+
+  if (!b)
+    {
+      b = xzalloc (sizeof *b);
+      b->syntax_table = Qnil;
+      b->checkpoints = xpalloc (NULL, &b->checkpoints_size, 1, -1,
+				sizeof *b->checkpoints);
+      current_buffer->bracket_index = b;
+    }
+  else if (!EQ (b->syntax_table, table)
+	   && ++b->mismatches < BRACKET_INDEX_PATIENCE)
+    /* Code like 'with-syntax-table' may scan with another table for
+       a while; don't rebuild the index for it right away.  */
+    return NULL;
+
+  if (!EQ (b->syntax_table, table)
+      || b->syntax_table_modifications != syntax_table_modifications
+      || b->lookup_properties != parse_sexp_lookup_properties
+      || b->escapable_comment_ends != comment_end_can_be_escaped)
+    reset_bracket_index (b, table);
+  b->mismatches = 0;
+  return b;
+}
+
+static void
+stop_recording_brackets (void)
+{
+  bracket_recorder = NULL;
+  bracket_recorder_busy = false;
+}
+
+/* Parse the current buffer for its bracket index B up to TO, or to
+   the end of the buffer, recording a state every
+   BRACKET_CHECKPOINT_INTERVAL characters.  Return false if this could
+   not be done, in which case B may no longer exist.  */
+
+static bool
+extend_bracket_index (struct bracket_index *b, ptrdiff_t to)
+{
+  ptrdiff_t count = SPECPDL_INDEX ();
+  bool ok = true;
+
+  /* The index is for the whole buffer.  */
+  if (BEGV != BEG || ZV != Z)
+    return false;
+
+  record_unwind_protect_void (stop_recording_brackets);
+  to = min (to, Z);
+  while (ok && b->checkpoints[b->n_checkpoints - 1].charpos < to)
+    {
+      struct bracket_checkpoint *c = &b->checkpoints[b->n_checkpoints - 1];
+      struct lisp_parse_state state = c->state;
+      ptrdiff_t from = c->charpos;
+      ptrdiff_t next = min (from + BRACKET_CHECKPOINT_INTERVAL, Z);
+      unsigned generation = b->generation;
+
+      bracket_recorder = b;
+      bracket_recorder_busy = false;
+      scan_sexps_forward (&state, from, CHAR_TO_BYTE (from), next,
+			  TYPE_MINIMUM (EMACS_INT), false, 0);
+
+      /* Like the states of 'internal--syntax-ppss', the parentheses
+	 are kept unless parsing changed what they depend on, as it
+	 can if it runs 'syntax-propertize'.  */
+      ok = (current_buffer->bracket_index == b && bracket_recorder == b
+	    && b->generation == generation && state.location == next);
+      bracket_recorder = NULL;
+      if (ok)
+	{
+	  if (b->n_checkpoints == b->checkpoints_size)
+	    b->checkpoints = xpalloc (b->checkpoints, &b->checkpoints_size,
+				      1, -1, sizeof *b->checkpoints);
+	  c = &b->checkpoints[b->n_checkpoints++];
+	  c->charpos = next;
+	  c->count = b->count;
+	  c->state = state;
+	  c->state.levelstarts = Qnil;
+	}
+      else if (current_buffer->bracket_index == b)
+	truncate_brackets (b, b->checkpoints[b->n_checkpoints - 1].count);
+    }
+
+  unbind_to (count, Qnil);
+  return ok;
+}
+
+/* Return the position of the parenthesis that matches the one at
+   CHARPOS in the current buffer, according to its bracket index, or
+   -1 if there is no index or the index does not tell.  SEXPFLAG is as
+   for scan_lists.  This may parse the buffer, so the caller must set
+   up the syntax table again afterwards.  */
+
+static ptrdiff_t
+bracket_index_match (ptrdiff_t charpos, bool sexpflag)
+{
+  struct bracket_index *b = current_bracket_index ();
+  ptrdiff_t i;
+
+  if (!b || !extend_bracket_index (b, charpos + 1))
+    return -1;
+
+  /* Parse on until the parenthesis is closed, if it is open.  */
+  while (0 <= (i = find_bracket (b, charpos))
+	 && b->v[i].match == BRACKET_UNCLOSED)
+    {
+      ptrdiff_t end = b->checkpoints[b->n_checkpoints - 1].charpos;
+      if (end == Z || !extend_bracket_index (b, end + 1))
+	return -1;
+    }
+
+  if (i < 0 || b->v[i].match < 0 || (sexpflag && b->has_math))
+    return -1;
+  return b->v[b->v[i].match].charpos;
 }
 
 void
@@ -3763,6 +4774,22 @@ See the info node `(elisp)Syntax Properties' for a description of the
   DEFVAR_BOOL ("words-include-escapes", words_include_escapes,
 	       doc: /* Non-nil means `forward-word', etc., should treat escape chars part of words.  */);
 
+  DEFVAR_BOOL ("parse-sexp-bracket-index", parse_sexp_bracket_index,
+	       doc: /* Non-nil means `scan-lists' and `scan-sexps' may use a bracket index.
+The index records the parentheses of the buffer outside strings and
+comments, and which ones match, as found by parsing the buffer from
+its beginning.  It lets `forward-sexp', `up-list', `show-paren-mode'
+and the like skip over a list without looking at its contents, which
+makes a difference in large buffers.  The index is built as needed,
+and a change to the text discards it from where the change happened.
+
+The index is used only if `parse-sexp-ignore-comments' is non-nil and
+the buffer is not narrowed when it needs to be extended.  When scanning
+backward over a list, the index agrees with `syntax-ppss' even where
+comments are ambiguous seen from their end.  The index does not notice
+changes made to a syntax table other than with `modify-syntax-entry'.  */);
+  parse_sexp_bracket_index = false;
+
   DEFVAR_BOOL ("multibyte-syntax-as-symbol", multibyte_syntax_as_symbol,
 	       doc: /* Non-nil means `scan-sexps' treats all multibyte characters as symbol.  */);
   multibyte_syntax_as_symbol = 0;
@@ -3821,4 +4848,6 @@ In both cases, LIMIT bounds the search. */);
   defsubr (&Sscan_sexps);
   defsubr (&Sbackward_prefix_chars);
   defsubr (&Sparse_partial_sexp);
+  defsubr (&Sinternal__syntax_ppss);
+  defsubr (&Sinternal__syntax_ppss_flush);
 }
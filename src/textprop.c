@@ -312,6 +312,18 @@ property_value (Lisp_Object plist, Lisp_Object prop)
   return Qunbound;
 }
 
+/* Note that the property PROP of the text of the buffer OBJECT at
+   POS is about to change.  The states recorded by
+   'internal--syntax-ppss' after POS depend on the 'syntax-table'
+   property, which can also come from a 'category' symbol.  */
+
+static void
+note_property_change (Lisp_Object object, ptrdiff_t pos, Lisp_Object prop)
+{
+  if (EQ (prop, Qsyntax_table) || EQ (prop, Qcategory))
+    invalidate_syntax_checkpoints (XBUFFER (object), pos);
+}
+
 /* Set the properties of INTERVAL to PROPERTIES,
    and record undo info for the previous values.
    OBJECT is the string or buffer that INTERVAL belongs to.  */
@@ -334,6 +346,7 @@ set_properties (Lisp_Object properties, INTERVAL interval, Lisp_Object object)
 	    record_property_change (interval->position, LENGTH (interval),
 				    XCAR (sym), XCAR (value),
 				    object);
+	    note_property_change (object, interval->position, XCAR (sym));
 	  }
 
       /* For each new property that has no value at all in the old plist,
@@ -346,6 +359,7 @@ set_properties (Lisp_Object properties, INTERVAL interval, Lisp_Object object)
 	    record_property_change (interval->position, LENGTH (interval),
 				    XCAR (sym), Qnil,
 				    object);
+	    note_property_change (object, interval->position, XCAR (sym));
 	  }
     }
 
@@ -403,6 +417,7 @@ add_properties (Lisp_Object plist, INTERVAL i, Lisp_Object object,
 	      {
 		record_property_change (i->position, LENGTH (i),
 					sym1, Fcar (this_cdr), object);
+		note_property_change (object, i->position, sym1);
 	      }
 
 	    /* I's property has a different value -- change it */
@@ -447,6 +462,7 @@ add_properties (Lisp_Object plist, INTERVAL i, Lisp_Object object,
 	    {
 	      record_property_change (i->position, LENGTH (i),
 				      sym1, Qnil, object);
+	      note_property_change (object, i->position, sym1);
 	    }
 	  set_interval_plist (i, Fcons (sym1, Fcons (val1, i->plist)));
 	  changed = true;
@@ -481,9 +497,12 @@ remove_properties (Lisp_Object plist, Lisp_Object list, INTERVAL i, Lisp_Object
       while (CONSP (current_plist) && EQ (sym, XCAR (current_plist)))
 	{
 	  if (BUFFERP (object))
-	    record_property_change (i->position, LENGTH (i),
-				    sym, XCAR (XCDR (current_plist)),
-				    object);
+	    {
+	      record_property_change (i->position, LENGTH (i),
+				      sym, XCAR (XCDR (current_plist)),
+				      object);
+	      note_property_change (object, i->position, sym);
+	    }
 
 	  current_plist = XCDR (XCDR (current_plist));
 	  changed = true;
@@ -497,8 +516,11 @@ remove_properties (Lisp_Object plist, Lisp_Object list, INTERVAL i, Lisp_Object
 	  if (CONSP (this) && EQ (sym, XCAR (this)))
 	    {
 	      if (BUFFERP (object))
-		record_property_change (i->position, LENGTH (i),
-					sym, XCAR (XCDR (this)), object);
+		{
+		  record_property_change (i->position, LENGTH (i),
+					  sym, XCAR (XCDR (this)), object);
+		  note_property_change (object, i->position, sym);
+		}
 
 	      Fsetcdr (XCDR (tail2), XCDR (XCDR (this)));
 	      changed = true;
@@ -3726,8 +3726,7 @@ run_window_change_functions_1 (Lisp_Object symbol, Lisp_Object buffer,
 
   if (NILP (buffer))
     funs = Fdefault_value (symbol);
-  else if (!NILP (Fassoc (symbol, BVAR (XBUFFER (buffer), local_var_alist),
-			  Qnil)))
+  else if (!NILP (buffer_local_binding (XBUFFER (buffer), symbol)))
     /* Don't run global value buffer-locally.  */
     funs = buffer_local_value (symbol, buffer);
 
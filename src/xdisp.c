@@ -27179,6 +27179,21 @@ display_count_lines (ptrdiff_t start_byte,
     = (!NILP (BVAR (current_buffer, selective_display))
        && !FIXNUMP (BVAR (current_buffer, selective_display)));
 
+  /* Count many lines with the line index, if it is worth it.  */
+  if (!selective_display)
+    {
+      ptrdiff_t counted;
+      if (find_newline_by_index (start_byte, limit_byte, count,
+				 &counted, byte_pos_ptr))
+	{
+	  if (counted != count)
+	    return count < 0 ? - counted : counted;
+	  /* When scanning backwards, we should not count the newline
+	     posterior to which we stop.  */
+	  return count < 0 ? - count - 1 : count;
+	}
+    }
+
   if (count > 0)
     {
       while (start_byte < limit_byte)
@@ -640,6 +640,37 @@ inner loops respectively."
            (f (list (lambda (x) (setq a x)))))
       (funcall (car f) 3)
       (list a b))
+
+    ;; Check predicates followed by conditional jumps, and references
+    ;; followed by `car', `cdr' or a jump, which the interpreter
+    ;; executes as one instruction.
+    (let ((r nil))
+      (dolist (x '(1 2.0 -3 nil a "s" (4 . 5) [6]) (nreverse r))
+        (push (list (and (consp x) 'cons)
+                    (or (stringp x) 'nonstring)
+                    (if (symbolp x) 'symbol 'nonsymbol)
+                    (and (listp x) (not x) 'null)
+                    (if (numberp x) (if (integerp x) 'integer 'float) 'nan)
+                    (and x (car-safe x))
+                    (or (eq x 'a) (cdr-safe x)))
+              r)))
+    (let ((a 1) (b 2.0) (c (expt 2 70)))
+      (list (< a b) (> a b) (<= a 1) (>= b a) (= a 1.0) (= c (1+ (1- c)))
+            (if (< a c) 'less 'not-less) (and (= a b) 'equal)
+            (or (< b a) (> a c) 'neither)))
+    (with-temp-buffer
+      (insert "abc")
+      (let ((m (point-marker)) (n 4))
+        (list (= m n) (< m 5) (>= 3 m) (+ m 1) (- n m))))
+    (let ((a most-positive-fixnum) (b most-negative-fixnum) (c 1))
+      (list (+ a c) (- b c) (+ b c) (- a b) (+ a 1.0) (- c 0.5)))
+    (let ((l (list 1 2 3)) (n 0))
+      (while l
+        (setq n (+ n (car l)))
+        (setq l (cdr l)))
+      n)
+    (let ((x 'a)) (car x))
+    (let ((x "b")) (cdr x))
     )
   "List of expressions for cross-testing interpreted and compiled code.")
 
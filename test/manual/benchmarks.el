@@ -0,0 +1,649 @@
+;;; benchmarks.el --- workloads to time Emacs builds -*- lexical-binding: t -*-
+
+;; Copyright (C) 2022 Free Software Foundation, Inc.
+
+;; This file is part of GNU Emacs.
+
+;; GNU Emacs is free software: you can redistribute it and/or modify
+;; it under the terms of the GNU General Public License as published by
+;; the Free Software Foundation, either version 3 of the License, or
+;; (at your option) any later version.
+
+;; GNU Emacs is distributed in the hope that it will be useful,
+;; but WITHOUT ANY WARRANTY; without even the implied warranty of
+;; MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+;; GNU General Public License for more details.
+
+;; You should have received a copy of the GNU General Public License
+;; along with GNU Emacs.  If not, see <https://www.gnu.org/licenses/>.
+
+;;; Commentary:
+
+;; Each workload in this file times a few operations on data large
+;; enough for their cost to show.  Run all of them with
+;;
+;;   emacs -Q --batch -l test/manual/benchmarks.el
+;;
+;; or only some of them, by naming them after the file:
+;;
+;;   emacs -Q --batch -l test/manual/benchmarks.el overlays
+;;
+;; and compare the times between Emacs builds.  The sizes of the data
+;; are multiplied by the environment variable BENCHMARKS_SCALE, if it
+;; is set.
+;;
+;; To add a workload, define it with `benchmarks-define' and time its
+;; operations with `benchmarks-time'.
+
+;;; Code:
+
+(require 'benchmark)
+(require 'cl-lib)
+
+(defvar benchmarks-workloads nil
+  "Alist of the workloads, (NAME . FUNCTION), latest first.")
+
+(defmacro benchmarks-define (name docstring &rest body)
+  "Define the workload NAME, which runs BODY.
+The function that runs it is called `benchmarks-NAME'."
+  (declare (indent 1) (doc-string 2))
+  (let ((function (intern (format "benchmarks-%s" name))))
+    `(progn
+       (defun ,function () ,docstring ,@body)
+       (setf (alist-get ',name benchmarks-workloads) #',function))))
+
+(defmacro benchmarks-time (label &rest body)
+  "Run BODY once with `benchmark-run' and print its time, labeled LABEL.
+The number of garbage collections and the time they took follow."
+  (declare (indent 1))
+  `(benchmarks--report ,label (benchmark-run 1 ,@body)))
+
+(defun benchmarks--report (label result)
+  (message "  %-48s %8.3f s %4d GCs %7.3f s"
+           label (nth 0 result) (nth 1 result) (nth 2 result)))
+
+(defun benchmarks-size (n)
+  "Return N multiplied by the environment variable BENCHMARKS_SCALE."
+  (let ((scale (getenv "BENCHMARKS_SCALE")))
+    (max 1 (round (* n (if scale (string-to-number scale) 1))))))
+
+(defun benchmarks-buffer (lines function)
+  "Return a new buffer of LINES lines.
+FUNCTION is called with the number of each line, from 0, and
+returns its text, newline included."
+  (let ((buffer (generate-new-buffer " *benchmarks*")))
+    (with-current-buffer buffer
+      (dotimes (i lines)
+        (insert (funcall function i))))
+    buffer))
+
+(defun benchmarks-run (&rest names)
+  "Run the workloads NAMES, or all of them if NAMES is nil.
+The workloads are byte-compiled first, so that the interpreter does
+not add to the times."
+  (dolist (workload (reverse benchmarks-workloads))
+    (when (or (null names) (memq (car workload) names))
+      (unless (byte-code-function-p (symbol-function (cdr workload)))
+        (byte-compile (cdr workload)))
+      (message "%s:" (car workload))
+      (garbage-collect)
+      (funcall (cdr workload)))))
+
+;;;; Overlays
+
+(defun benchmarks--overlays-scroll (screens recenter)
+  "Look up overlays in SCREENS screenfuls spread across the buffer.
+If RECENTER, recenter the overlays at each screenful first."
+  (let ((step (/ (point-max) screens)))
+    (dotimes (i screens)
+      (let* ((pos (max (point-min) (* i step)))
+             (limit (min (point-max) (+ pos 2000))))
+        (overlay-recenter (if recenter pos (point-min)))
+        (while (< pos limit)
+          (get-char-property pos 'face)
+          (setq pos (next-overlay-change pos)))))))
+
+(benchmarks-define overlays
+  "Time the overlay lookups of redisplay, with an overlay on each line.
+Redisplay cannot run in batch mode, so scrolling walks each
+screenful from overlay change to overlay change, asking for the
+face there, as redisplay would."
+  (let ((lines (benchmarks-size 100000)))
+    (with-current-buffer
+        (benchmarks-buffer lines
+                           (lambda (i) (format "Line %d of overlays\n" i)))
+      (goto-char (point-min))
+      (dotimes (_ lines)
+        (overlay-put (make-overlay (point) (+ (point) 4)) 'face 'bold)
+        (forward-line 1))
+      (benchmarks-time "scroll, overlays centered at the top"
+        (benchmarks--overlays-scroll 200 nil))
+      (benchmarks-time "scroll, overlays recentered"
+        (benchmarks--overlays-scroll 200 t))
+      (benchmarks-time "1000 overlays-in"
+        (dotimes (i 1000)
+          (let ((pos (* i (/ (point-max) 1000))))
+            (overlays-in pos (+ pos 2000)))))
+      (benchmarks-time "1000 previous-overlay-change"
+        (dotimes (i 1000)
+          (previous-overlay-change (* (1+ i) (/ (point-max) 1001)))))
+      (benchmarks-time "1000 insertions, each with a lookup"
+        (dotimes (i 1000)
+          (goto-char (* (1+ i) (/ (point-max) 1001)))
+          (insert "x")
+          (get-char-property (point) 'face)))
+      (kill-buffer))))
+
+;;;; Conservative stack scan
+
+(defvar benchmarks--gc-stack-heap nil
+  "Objects kept alive to make the heap grow.")
+
+(defun benchmarks--gc-stack-mark-time (repetitions)
+  "Return the least time spent marking in REPETITIONS collections."
+  (let (best)
+    (dotimes (_ repetitions)
+      (let ((before gc-mark-elapsed))
+        (garbage-collect)
+        (setq best (min (- gc-mark-elapsed before) (or best 1.0e+INF)))))
+    best))
+
+(defun benchmarks--gc-stack-deep (depth repetitions)
+  "Like `benchmarks--gc-stack-mark-time', with DEPTH more Lisp frames."
+  (if (> depth 0)
+      (car (list (benchmarks--gc-stack-deep (1- depth) repetitions)))
+    (benchmarks--gc-stack-mark-time repetitions)))
+
+(benchmarks-define gc-stack
+  "Time the conservative scan of the C stack as the heap grows.
+Every word on the C stack is looked up among the blocks of Lisp
+data.  The \"stack\" column is the difference between the marking
+times with a deep and a shallow stack, which is mostly the time
+taken by that lookup."
+  (let* ((depth 400)
+         (max-lisp-eval-depth (max max-lisp-eval-depth (* 10 depth)))
+         (max-specpdl-size (max max-specpdl-size (* 10 depth)))
+         (gc-cons-threshold most-positive-fixnum)
+         (size 0))
+    (message "  %10s %10s %10s %10s" "conses" "shallow" "deep" "stack")
+    (dotimes (step 6)
+      (let ((n (benchmarks-size (* 250000 (ash 1 step)))))
+        (while (< size n)
+          (push (make-vector 2 (cons nil nil)) benchmarks--gc-stack-heap)
+          (setq size (1+ size)))
+        (let* ((shallow (benchmarks--gc-stack-mark-time 10))
+               (deep (benchmarks--gc-stack-deep depth 10)))
+          (message "  %10d %10.6f %10.6f %10.6f"
+                   n shallow deep (- deep shallow)))))
+    (setq benchmarks--gc-stack-heap nil)))
+
+;;;; Character positions
+
+(benchmarks-define charpos
+  "Time conversions between character and byte positions.
+They are done when jumping to random places in a large multibyte
+buffer."
+  (let* ((line (concat "Line of the benchmark: αβγδε, 日本語, "
+                       "Ünïcödé and some ASCII text.\n"))
+         (lines (/ (* (benchmarks-size 200) 1024 1024) (string-bytes line)))
+         (state (cl-make-random-state 1)))
+    (with-current-buffer (benchmarks-buffer lines (lambda (_) line))
+      (message "  %d characters, %d bytes"
+               (buffer-size) (1- (position-bytes (point-max))))
+      (benchmarks-time "10000 random goto-char"
+        (dotimes (_ 10000)
+          (goto-char (1+ (cl-random (buffer-size) state)))))
+      (benchmarks-time "10000 random byte-to-position"
+        (dotimes (_ 10000)
+          (byte-to-position
+           (1+ (cl-random (1- (position-bytes (point-max))) state)))))
+      (benchmarks-time "1000 insertions, each with a goto-char"
+        (dotimes (_ 1000)
+          (goto-char (1+ (cl-random (buffer-size) state)))
+          (insert "é")
+          (goto-char (1+ (cl-random (buffer-size) state)))))
+      (kill-buffer))))
+
+;;;; Regexp search through text that cannot match
+
+(defun benchmarks--regexp-scan-1 (label regexp case-fold)
+  "Search the current buffer for REGEXP, and time it labeled LABEL.
+CASE-FOLD is bound to `case-fold-search'."
+  (goto-char (point-min))
+  (let ((case-fold-search case-fold))
+    (benchmarks-time label
+      (re-search-forward regexp nil t))))
+
+(benchmarks-define regexp-scan
+  "Time `re-search-forward' for regexps that match only at the end.
+Most of the time goes into skipping the text that cannot start a
+match, in ASCII and in mostly ASCII text."
+  (let ((megabytes (benchmarks-size 100)))
+    (dolist (multibyte '(nil t))
+      (let* ((line (concat "static int some_function (struct thing *p, int n)"
+                           (if multibyte " /* ÿ */" "")
+                           "\n"))
+             (lines (/ (* megabytes 1024 1024) (string-bytes line))))
+        (with-current-buffer (benchmarks-buffer lines (lambda (_) line))
+          (insert "XYZZY_42\n")
+          (message "  %d MB of %s text:"
+                   megabytes (if multibyte "mostly ASCII" "ASCII"))
+          (benchmarks--regexp-scan-1 "literal prefix" "XYZZY_[0-9]+" nil)
+          (benchmarks--regexp-scan-1 "literal prefix, case-folded"
+                                     "xyzzy_[0-9]+" t)
+          (benchmarks--regexp-scan-1 "alternatives"
+                                     "\\(?:XYZ\\|ZZY\\)_4" nil)
+          (benchmarks--regexp-scan-1 "character class" "[XQ]YZZY_4" nil)
+          (kill-buffer))))))
+
+;;;; Searching for many regexps
+
+(require 'compile)
+
+(defun benchmarks--regexp-multi-1 (label regexps)
+  "Find the matches for REGEXPS in the current buffer in two ways.
+Time them labeled LABEL: one regexp at a time with
+`re-search-forward', and all at once with `re-search-forward-multi'."
+  (let ((case-fold-search nil))
+    (benchmarks-time (concat label ", one at a time")
+      (dolist (regexp regexps)
+        (goto-char (point-min))
+        (while (and (re-search-forward regexp nil t) (not (eobp)))
+          (when (= (match-beginning 0) (match-end 0))
+            (forward-char 1)))))
+    (benchmarks-time (concat label ", all at once")
+      (goto-char (point-min))
+      (let ((regexps (vconcat regexps)))
+        (while (and (re-search-forward-multi regexps nil t) (not (eobp)))
+          (when (= (match-beginning 0) (match-end 0))
+            (forward-char 1)))))))
+
+(benchmarks-define regexp-multi
+  "Time searches for many regexps in the output of a compilation."
+  (let ((lines ["make[1]: Entering directory '/home/user/src/emacs'\n"
+                "  CC       some-file.o\n"
+                "gcc -c -O2 -Wall -I. -I../lib some-file.c -o some-file.o\n"
+                "some-file.c: In function 'frobnicate':\n"
+                "some-file.c:123:45: warning: unused variable 'x'\n"
+                "   123 |   int x;\n"]))
+    (with-current-buffer
+        (benchmarks-buffer (* (length lines) (benchmarks-size 10000))
+                           (lambda (i) (aref lines (% i (length lines)))))
+      (benchmarks--regexp-multi-1
+       "compilation-error-regexp-alist"
+       (delq nil (mapcar (lambda (elt)
+                           (and (stringp (nth 1 elt)) (nth 1 elt)))
+                         compilation-error-regexp-alist-alist)))
+      (benchmarks--regexp-multi-1
+       "rare keywords"
+       (mapcar (lambda (word) (concat "\\_<" word "_[0-9]+\\_>"))
+               '("XYZZY" "QUUX" "FROB" "ZORK" "GRAULT" "GARPLY" "WALDO"
+                 "FRED" "PLUGH" "THUD")))
+      (kill-buffer))))
+
+;;;; Line numbers
+
+(benchmarks-define line-index
+  "Time counting lines at random places in a buffer of many lines.
+This covers `line-number-at-pos', `forward-line' over many lines,
+and the line number of the mode line, which is what
+`display-line-numbers' computes too."
+  (let ((lines (benchmarks-size 2000000))
+        (state (cl-make-random-state 1)))
+    (with-current-buffer
+        (benchmarks-buffer
+         lines (lambda (i) (format "Line %d of the benchmark.\n" i)))
+      (message "  %d lines, %d bytes" lines (buffer-size))
+      (benchmarks-time "1000 random line-number-at-pos"
+        (dotimes (_ 1000)
+          (line-number-at-pos (1+ (cl-random (buffer-size) state)))))
+      (benchmarks-time "1000 random forward-line"
+        (dotimes (_ 1000)
+          (goto-char (point-min))
+          (forward-line (cl-random lines state))))
+      (benchmarks-time "1000 mode line %l, with an insertion"
+        (set-window-buffer nil (current-buffer))
+        (let ((line-number-display-limit nil)
+              (line-number-display-limit-width most-positive-fixnum))
+          (dotimes (_ 1000)
+            (goto-char (1+ (cl-random (buffer-size) state)))
+            (insert "x\n")
+            (format-mode-line "%l" nil (selected-window)))))
+      (kill-buffer))))
+
+;;;; Counting matches
+
+(benchmarks-define count-matches
+  "Time `how-many' and `occur' over a buffer that looks like a log.
+The regexps are anchored at the start of a line, literal strings,
+and regexps with many matches."
+  (let ((lines (benchmarks-size 1000000)))
+    (with-current-buffer
+        (benchmarks-buffer
+         lines
+         (lambda (i)
+           (format "%s 2022-01-%02d 12:%02d:%02d worker-%d: %s\n"
+                   (if (zerop (% i 97)) "ERROR" "INFO")
+                   (1+ (% i 28)) (% i 60) (% (* i 7) 60) (% i 13)
+                   (if (zerop (% i 97))
+                       "request failed, connection reset by peer"
+                     "request served in 12 ms"))))
+      (message "  %d lines, %d bytes" lines (buffer-size))
+      (dolist (regexp '("^ERROR" "connection reset" "^INFO.*served"
+                        "worker" "[0-9]+"))
+        (goto-char (point-min))
+        (benchmarks-time (format "how-many %S" regexp)
+          (how-many regexp)))
+      (benchmarks-time "occur \"^ERROR\""
+        (occur "^ERROR"))
+      (kill-buffer))))
+
+;;;; Skipping characters
+
+(benchmarks-define skip-chars
+  "Time loops over `skip-chars-forward' and `skip-syntax-forward'.
+They run over a multibyte buffer of Lisp code with some non-ASCII
+comments, as Lisp code typically does."
+  (let ((lines (benchmarks-size 200000)))
+    (with-current-buffer
+        (benchmarks-buffer
+         lines
+         (lambda (i)
+           (if (zerop (% i 5))
+               (format ";; Commentaire numéro %d, très « utile ».\n" i)
+             (format "  (setq skip-chars-variable-%d (+ %d \t foo-bar))\n"
+                     i i))))
+      (emacs-lisp-mode)
+      (message "  %d lines, %d bytes" lines (buffer-size))
+      (benchmarks-time "skip-chars-forward \"^\\n\" by line"
+        (goto-char (point-min))
+        (while (not (eobp))
+          (skip-chars-forward "^\n")
+          (forward-char 1)))
+      (benchmarks-time "skip-chars-backward \"^\\n\" by line"
+        (goto-char (point-max))
+        (while (not (bobp))
+          (skip-chars-backward "^\n")
+          (unless (bobp)
+            (backward-char 1))))
+      (benchmarks-time "skip-chars-forward \" \\t\" by word"
+        (goto-char (point-min))
+        (while (not (eobp))
+          (skip-chars-forward " \t")
+          (skip-chars-forward "^ \t\n")
+          (skip-chars-forward "\n")))
+      (benchmarks-time "skip-chars-forward \"[:alnum:]-\""
+        (goto-char (point-min))
+        (while (not (eobp))
+          (skip-chars-forward "[:alnum:]-")
+          (skip-chars-forward "^[:alnum:]-")))
+      (benchmarks-time "skip-syntax-forward \"w_\" by symbol"
+        (goto-char (point-min))
+        (while (not (eobp))
+          (skip-syntax-forward "w_")
+          (skip-syntax-forward "^w_")))
+      (benchmarks-time "skip-syntax-backward \" \" by line"
+        (goto-char (point-max))
+        (while (not (bobp))
+          (skip-syntax-backward " ")
+          (skip-syntax-backward "^ ")))
+      (kill-buffer))))
+
+;;;; Bracket index
+
+(defun benchmarks--bracket-index-1 ()
+  "Time list scans in the current buffer."
+  (benchmarks-time "20 forward-sexp over the whole buffer"
+    (dotimes (_ 20)
+      (goto-char (point-min))
+      (forward-sexp)))
+  (benchmarks-time "20 backward-sexp over the whole buffer"
+    (dotimes (_ 20)
+      (goto-char (point-max))
+      (backward-sexp)))
+  (let ((state (cl-make-random-state 1)))
+    (benchmarks-time "200 insertions, each with 2 paren matches"
+      (dotimes (_ 200)
+        (goto-char (1+ (cl-random (buffer-size) state)))
+        (end-of-line)
+        (insert " ")
+        ;; Match the parentheses around point, as `show-paren-mode'
+        ;; does with the innermost list and the top-level one.
+        (ignore-errors (scan-lists (point) 1 1))
+        (ignore-errors (scan-lists (point-min) 1 0))))))
+
+(benchmarks-define bracket-index
+  "Time scanning large lists, with and without the bracket index.
+This covers `forward-sexp' and `backward-sexp' over a list of
+deeply nested Lisp data, and the parenthesis matching that
+`show-paren-mode' does after each change."
+  (let ((entries (benchmarks-size 20000)))
+    (with-current-buffer
+        (benchmarks-buffer
+         entries
+         (lambda (i)
+           (concat (format "  (entry %d \"name (%d)\" ; comment )\n" i i)
+                   "   (fields (a . 1) (b . [2 3 (4 5)]) (c \"s]\" ?\\())\n"
+                   "   ((((nested (deeply (in (lists))))))))\n")))
+      (lisp-data-mode)
+      (goto-char (point-min))
+      (insert "(\n")
+      (goto-char (point-max))
+      (insert ")\n")
+      (message "  %d entries, %d bytes" entries (buffer-size))
+      (dolist (index '(nil t))
+        (message "  parse-sexp-bracket-index: %s" index)
+        (setq-local parse-sexp-bracket-index index)
+        (benchmarks--bracket-index-1))
+      (kill-buffer))))
+
+;;;; Byte-code interpreter
+
+(defun benchmarks--bytecode-fibn (n)
+  (if (< n 2)
+      n
+    (+ (benchmarks--bytecode-fibn (- n 1))
+       (benchmarks--bytecode-fibn (- n 2)))))
+
+(defun benchmarks--bytecode-bubble (list)
+  "Sort LIST of numbers in place, exchanging neighbors."
+  (let ((i (length list)))
+    (while (> i 1)
+      (let ((b list))
+        (while (cdr b)
+          (when (< (cadr b) (car b))
+            (let ((tmp (car b)))
+              (setcar b (cadr b))
+              (setcar (cdr b) tmp)))
+          (setq b (cdr b))))
+      (setq i (1- i)))
+    list))
+
+(cl-defstruct (benchmarks--bytecode-body
+               (:constructor benchmarks--bytecode-body-create)
+               (:conc-name benchmarks--bytecode-body-))
+  x y z vx vy vz mass)
+
+(defun benchmarks--bytecode-advance (bodies dt)
+  "Move BODIES according to their gravity for a time DT."
+  (let ((rest bodies))
+    (while rest
+      (let ((a (car rest)))
+        (dolist (b (cdr rest))
+          (let* ((dx (- (benchmarks--bytecode-body-x a)
+                        (benchmarks--bytecode-body-x b)))
+                 (dy (- (benchmarks--bytecode-body-y a)
+                        (benchmarks--bytecode-body-y b)))
+                 (dz (- (benchmarks--bytecode-body-z a)
+                        (benchmarks--bytecode-body-z b)))
+                 (d2 (+ (* dx dx) (* dy dy) (* dz dz)))
+                 (mag (/ dt (* d2 (sqrt d2))))
+                 (ma (* (benchmarks--bytecode-body-mass a) mag))
+                 (mb (* (benchmarks--bytecode-body-mass b) mag)))
+            (cl-decf (benchmarks--bytecode-body-vx a) (* dx mb))
+            (cl-decf (benchmarks--bytecode-body-vy a) (* dy mb))
+            (cl-decf (benchmarks--bytecode-body-vz a) (* dz mb))
+            (cl-incf (benchmarks--bytecode-body-vx b) (* dx ma))
+            (cl-incf (benchmarks--bytecode-body-vy b) (* dy ma))
+            (cl-incf (benchmarks--bytecode-body-vz b) (* dz ma)))))
+      (setq rest (cdr rest)))
+    (dolist (a bodies)
+      (cl-incf (benchmarks--bytecode-body-x a)
+               (* dt (benchmarks--bytecode-body-vx a)))
+      (cl-incf (benchmarks--bytecode-body-y a)
+               (* dt (benchmarks--bytecode-body-vy a)))
+      (cl-incf (benchmarks--bytecode-body-z a)
+               (* dt (benchmarks--bytecode-body-vz a))))))
+
+(defun benchmarks--bytecode-nbody (steps)
+  "Simulate five bodies for STEPS steps."
+  (let ((bodies
+         (cl-loop for i from 0 below 5
+                  collect (benchmarks--bytecode-body-create
+                           :x (float i) :y (* 0.5 i) :z (- 1.0 i)
+                           :vx 0.01 :vy (* 0.02 i) :vz 0.0
+                           :mass (+ 1.0 (* 0.1 i))))))
+    (dotimes (_ steps)
+      (benchmarks--bytecode-advance bodies 0.01))
+    bodies))
+
+(defun benchmarks--bytecode-identity (x)
+  x)
+
+(defalias 'benchmarks--bytecode-alias #'benchmarks--bytecode-identity)
+
+(defvar benchmarks--bytecode-variable 1)
+
+(defun benchmarks--bytecode-calls (n)
+  "Call a compiled function N times."
+  (let ((s 0))
+    (dotimes (i n)
+      (setq s (benchmarks--bytecode-identity i)))
+    s))
+
+(defun benchmarks--bytecode-alias-calls (n)
+  "Call a compiled function through an alias N times."
+  (let ((s 0))
+    (dotimes (i n)
+      (setq s (benchmarks--bytecode-alias i)))
+    s))
+
+(defun benchmarks--bytecode-closure-calls (n)
+  "Call a closure with `funcall' N times."
+  (let ((f (lambda (x) (+ x n)))
+        (s 0))
+    (dotimes (i n)
+      (setq s (funcall f i)))
+    s))
+
+(defun benchmarks--bytecode-subr-calls (n)
+  "Call a primitive without its own byte-code N times."
+  (let ((s 0))
+    (dotimes (i n)
+      (setq s (logand i 7)))
+    s))
+
+(defun benchmarks--bytecode-varrefs (n)
+  "Read a global variable N times."
+  (let ((s 0))
+    (dotimes (_ n)
+      (setq s (+ s benchmarks--bytecode-variable)))
+    s))
+
+(benchmarks-define bytecode
+  "Time byte-compiled versions of small programs.
+They are in the style of the elisp-benchmarks package: a recursive
+Fibonacci function, a bubble sort of a list, an n-body simulation
+with floats, and loops that call functions and read global
+variables.  Garbage collection is inhibited, so that the times are
+of the interpreter alone."
+  (dolist (f '(benchmarks--bytecode-fibn benchmarks--bytecode-bubble
+               benchmarks--bytecode-advance benchmarks--bytecode-nbody
+               benchmarks--bytecode-identity benchmarks--bytecode-calls
+               benchmarks--bytecode-alias-calls
+               benchmarks--bytecode-closure-calls
+               benchmarks--bytecode-subr-calls
+               benchmarks--bytecode-varrefs))
+    (unless (byte-code-function-p (symbol-function f))
+      (byte-compile f)))
+  (let ((gc-cons-threshold most-positive-fixnum)
+        (n (benchmarks-size 10000000)))
+    (benchmarks-time "fibn 30"
+      (benchmarks--bytecode-fibn 30))
+    (benchmarks-time "bubble sort of 1000 numbers, 5 times"
+      (dotimes (_ 5)
+        (benchmarks--bytecode-bubble (number-sequence 1000 1 -1))))
+    (benchmarks-time "nbody, 20000 steps"
+      (benchmarks--bytecode-nbody 20000))
+    (benchmarks-time (format "%d calls" n)
+      (benchmarks--bytecode-calls n))
+    (benchmarks-time (format "%d calls through an alias" n)
+      (benchmarks--bytecode-alias-calls n))
+    (benchmarks-time (format "%d calls of a closure" n)
+      (benchmarks--bytecode-closure-calls n))
+    (benchmarks-time (format "%d calls of logand" n)
+      (benchmarks--bytecode-subr-calls n))
+    (benchmarks-time (format "%d reads of a global variable" n)
+      (benchmarks--bytecode-varrefs n))))
+
+;;;; Buffer-local variables
+
+(defun benchmarks--local-variables-buffer (name vars)
+  "Return a new buffer NAME in which each of VARS is local."
+  (let ((buffer (generate-new-buffer name)))
+    (with-current-buffer buffer
+      (dolist (var vars)
+        (set (make-local-variable var) 0))
+      ;; Also some variables that forward into C variables.
+      (setq-local indent-tabs-mode nil)
+      (setq-local last-coding-system-used 'utf-8))
+    buffer))
+
+(benchmarks-define local-variables
+  "Time switching between buffers with 300 buffer-local variables.
+Buffers in large major modes have that many, and the variables are
+also read after each switch."
+  (let* ((vars (mapcar (lambda (i)
+                         (intern (format "benchmarks--local-variable-%d" i)))
+                       (number-sequence 1 300)))
+         (a (benchmarks--local-variables-buffer " *a*" vars))
+         (b (benchmarks--local-variables-buffer " *b*" vars))
+         (first (car vars))
+         (last (car (last vars)))
+         (gc-cons-threshold most-positive-fixnum)
+         ;; Keep the compiler from discarding the reads.
+         value)
+    (benchmarks-time "100000 switches"
+      (dotimes (_ 50000)
+        (set-buffer a)
+        (set-buffer b)))
+    (benchmarks-time "100000 switches and reads"
+      (dotimes (_ 50000)
+        (set-buffer a)
+        (setq value (symbol-value first))
+        (set-buffer b)
+        (setq value (symbol-value last))))
+    (benchmarks-time "100000 reads with buffer-local-value"
+      (dotimes (_ 50000)
+        (setq value (buffer-local-value first a))
+        (setq value (buffer-local-value last b))))
+    (benchmarks-time "100000 local-variable-p"
+      (dotimes (_ 50000)
+        (setq value (local-variable-p first a))
+        (setq value (local-variable-p last b))))
+    (benchmarks-time "10000 make and kill local variable"
+      (with-current-buffer a
+        (dotimes (_ 10000)
+          (kill-local-variable last)
+          (set (make-local-variable last) 0))))
+    (kill-buffer a)
+    (kill-buffer b)
+    value))
+
+;;;; Running
+
+(when noninteractive
+  (apply #'benchmarks-run (mapcar #'intern command-line-args-left))
+  (setq command-line-args-left nil))
+
+;;; benchmarks.el ends here
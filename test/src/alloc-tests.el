@@ -59,4 +59,125 @@
       (aset s 0 c)
       (should (equal s (make-string 1 c))))))
 
+(ert-deftest garbage-collect-generation-statistics ()
+  (garbage-collect)
+  (let ((keep (make-list 10000 nil)))
+    (dotimes (_ 1000)
+      (cons nil nil))
+    (garbage-collect)
+    ;; KEEP was consed since the previous GC, so it is young.
+    (let* ((stats (garbage-collect-generation-statistics))
+           (conses (assq 'conses stats)))
+      (should (assq 'floats stats))
+      (should (= (length conses) 5))
+      (should (>= (nth 2 conses) (length keep)))
+      (should (>= (nth 3 conses) 1000)))
+    (garbage-collect)
+    ;; Now KEEP has survived a GC, so it is old.
+    (let ((conses (assq 'conses (garbage-collect-generation-statistics))))
+      (should (< (nth 2 conses) (length keep)))
+      (should (>= (nth 4 conses) (length keep))))))
+
+(defun alloc-tests--wait-for-file (process file contents)
+  "Wait up to ten seconds for PROCESS to write CONTENTS to FILE."
+  (let ((deadline (+ (float-time) 10)))
+    (while (and (not (equal (with-temp-buffer
+                              (insert-file-contents file)
+                              (buffer-string))
+                            contents))
+                (process-live-p process)
+                (< (float-time) deadline))
+      (accept-process-output process 0.1))))
+
+(ert-deftest gc-cons-idle-fraction ()
+  "Check that Emacs collects garbage after waiting briefly for input."
+  ;; Emacs only collects when idle on a terminal, not in batch mode,
+  ;; so run it on a pseudoterminal.
+  (skip-unless (not (memq system-type '(windows-nt ms-dos))))
+  (let* ((output (make-temp-file "alloc-tests-output"))
+         (process-environment (cons "TERM=xterm" process-environment))
+         (process
+          (make-process
+           :name "alloc-tests" :buffer nil
+           :connection-type 'pty :noquery t
+           :command
+           (list (expand-file-name invocation-name invocation-directory)
+                 "-nw" "-Q" "--eval"
+                 (prin1-to-string
+                  `(progn
+                     (garbage-collect)
+                     (setq gc-cons-idle-fraction 0.01)
+                     (let ((gcs gcs-done) idle)
+                       (make-list 2000 nil)
+                       (write-region "first" nil ,output nil 0)
+                       (read-event)
+                       (setq idle (- gcs-done gcs))
+                       (setq gc-cons-idle-fraction nil
+                             gcs gcs-done)
+                       (make-list 2000 nil)
+                       (write-region "second" nil ,output nil 0)
+                       (read-event)
+                       (write-region (format "%d %d" idle (- gcs-done gcs))
+                                     nil ,output nil 0)
+                       (kill-emacs 0))))))))
+    (unwind-protect
+        (progn
+          (skip-unless (process-tty-name process))
+          ;; Let the process wait for input for longer than the tenth
+          ;; of a second after which it collects.
+          (alloc-tests--wait-for-file process output "first")
+          (sleep-for 0.5)
+          (process-send-string process "x")
+          (alloc-tests--wait-for-file process output "second")
+          (sleep-for 0.5)
+          (process-send-string process "y")
+          (alloc-tests--wait-for-file process output "1 0")
+          (should (equal (with-temp-buffer
+                           (insert-file-contents output)
+                           (buffer-string))
+                         "1 0")))
+      (delete-process process)
+      (delete-file output))))
+
+(ert-deftest garbage-collect-pause-histogram ()
+  (let* ((before (garbage-collect-pause-histogram))
+         (after (progn (garbage-collect)
+                       (garbage-collect-pause-histogram 'reset))))
+    (should (= (length after) 12))
+    (should (= (apply #'+ (append after nil))
+               (1+ (apply #'+ (append before nil)))))
+    (should (= (apply #'+ (append (garbage-collect-pause-histogram) nil))
+               0))))
+
+(ert-deftest memory-fragmentation-report ()
+  (let ((small (mapcar (lambda (_) (make-vector 4 nil))
+                      (make-list 10000 nil))))
+    (garbage-collect)
+    (let ((report (memory-fragmentation-report)))
+      (dolist (entry report)
+        (should (= (length entry) 4))
+        (should (<= 0 (nth 3 entry) (nth 2 entry))))
+      (should (assq 'conses report))
+      (should-not (assq 'large-vectors report))
+      ;; Each vector holds at least 4 words of 4 bytes.
+      (should (>= (nth 3 (assq 'vectors report)) (* (length small) 4 4))))
+    (should (vectorp (car small)))))
+
+;; Conses and floats freed by a GC are only reused once their block
+;; has been swept lazily; objects that survived must stay intact.
+(ert-deftest alloc-lazy-sweep-preserves-live-objects ()
+  (let ((keep (mapcar (lambda (i) (cons i (* 0.5 i))) (number-sequence 0 9999))))
+    (dotimes (_ 3)
+      (dotimes (i 20000)
+        (cons i (* 1.0 i)))
+      (garbage-collect)
+      (let ((fresh (mapcar (lambda (i) (cons (- i) (* 2.0 i)))
+                           (number-sequence 0 9999))))
+        (should (equal (car (nth 9999 fresh)) -9999))
+        (should (= (cdr (nth 9999 fresh)) 19998.0))))
+    (let ((i 0))
+      (dolist (c keep)
+        (should (equal c (cons i (* 0.5 i))))
+        (setq i (1+ i))))))
+
 ;;; alloc-tests.el ends here
@@ -1483,4 +1483,77 @@ with parameters from the *Messages* buffer modification."
         (when auto-save
           (ignore-errors (delete-file auto-save)))))))
 
+;; Buffers with many overlays look them up through an index once
+;; scanning the overlay lists gets expensive; check that both ways
+;; agree with the definitions.
+(defun buffer-tests--check-overlays (overlays)
+  "Check overlay lookups in the current buffer against OVERLAYS."
+  (let ((bounds nil))
+    (dolist (ov overlays)
+      (push (overlay-start ov) bounds)
+      (push (overlay-end ov) bounds))
+    (dotimes (i (1+ (- (point-max) (point-min))))
+      (let* ((pos (+ (point-min) i))
+             (at (cl-remove-if-not (lambda (ov)
+                                     (and (<= (overlay-start ov) pos)
+                                          (< pos (overlay-end ov))))
+                                   overlays))
+             (in (cl-remove-if-not
+                  (lambda (ov)
+                    (let ((start (overlay-start ov))
+                          (end (overlay-end ov)))
+                      (or (and (< pos end) (< start (+ pos 3)))
+                          (and (= start end)
+                               (or (= end pos)
+                                   (and (= (+ pos 3) (point-max))
+                                        (= end (point-max))))))))
+                  overlays)))
+        (should (equal (length (overlays-at pos)) (length at)))
+        (should (cl-every (lambda (ov) (memq ov at)) (overlays-at pos)))
+        (when (<= (+ pos 3) (point-max))
+          (should (equal (length (overlays-in pos (+ pos 3))) (length in)))
+          (should (cl-every (lambda (ov) (memq ov in))
+                            (overlays-in pos (+ pos 3)))))
+        (should (= (next-overlay-change pos)
+                   (apply #'min (point-max)
+                          (cl-remove-if-not (lambda (b) (> b pos))
+                                            bounds))))
+        (should (= (previous-overlay-change pos)
+                   (apply #'max (point-min)
+                          (cl-remove-if-not (lambda (b) (< b pos))
+                                            bounds))))))))
+
+(ert-deftest buffer-tests-overlay-index ()
+  (with-temp-buffer
+    (insert (make-string 300 ?x))
+    (let ((overlays nil)
+          (state (cl-make-random-state 42)))
+      (dotimes (_ 600)
+        (let ((start (1+ (cl-random 300 state))))
+          (push (make-overlay start
+                              (min (point-max)
+                                   (+ start (cl-random 10 state))))
+                overlays)))
+      ;; Far from the overlay center, the first lookups scan the
+      ;; lists and the following ones use the index.
+      (overlay-recenter (point-min))
+      (buffer-tests--check-overlays overlays)
+      (buffer-tests--check-overlays overlays)
+      ;; Changing the text or the overlays must not leave the index
+      ;; stale.
+      (goto-char 150)
+      (insert "yyyy")
+      (buffer-tests--check-overlays overlays)
+      (delete-region 50 70)
+      (buffer-tests--check-overlays overlays)
+      (dotimes (i 100)
+        (let ((ov (nth i overlays)))
+          (if (cl-oddp i)
+              (delete-overlay ov)
+            (move-overlay ov 10 (+ 10 i)))))
+      (setq overlays (cl-remove-if-not #'overlay-buffer overlays))
+      (buffer-tests--check-overlays overlays)
+      (narrow-to-region 100 200)
+      (buffer-tests--check-overlays overlays))))
+
 ;;; buffer-tests.el ends here
@@ -28,13 +28,13 @@
 (require 'ert)
 (require 'ert-x)
 (require 'cl-lib)
+(require 'comp)
 
 (defconst comp-test-src (ert-resource-file "comp-test-funcs.el"))
 
 (defconst comp-test-dyn-src (ert-resource-file "comp-test-funcs-dyn.el"))
 
 (when (featurep 'native-compile)
-  (require 'comp)
   (message "Compiling tests...")
   (load (native-compile comp-test-src))
   (load (native-compile comp-test-dyn-src)))
@@ -1447,4 +1447,108 @@ folded."
           (equal (comp-mvar-typeset mvar)
                  comp-tests-cond-rw-expected-type))))))))
 
+;;; Profile guided optimization.
+
+(ert-deftest comp-tests-profile ()
+  "Check writing a profile and marking functions hot and cold with it."
+  (let ((file (make-temp-file "comp-tests-profile"))
+        (log (make-hash-table :test #'equal))
+        (native-comp-hot-speed 3)
+        (native-comp-hot-threshold 0.2))
+    (unwind-protect
+        (progn
+          ;; The innermost frame comes first.
+          (puthash [comp-tests-leaf comp-tests-caller nil] 90 log)
+          (puthash [comp-tests-caller comp-tests-caller nil] 10 log)
+          (delete-file file)
+          (native-comp-write-profile file log)
+          (native-comp-write-profile file log)
+          (pcase-let ((`(,samples . ,table) (comp-read-profile file)))
+            (should (= samples 200))
+            (should (equal (gethash 'comp-tests-leaf table) '(180 . 180)))
+            (should (equal (gethash 'comp-tests-caller table) '(20 . 200))))
+          (let ((native-comp-profile-file file)
+                (comp-ctxt (make-comp-ctxt)))
+            (dolist (name '(comp-tests-leaf comp-tests-caller comp-tests-unseen))
+              (puthash (symbol-name name)
+                       (make-comp-func-d :name name :c-name (symbol-name name)
+                                         :speed 2)
+                       (comp-ctxt-funcs-h comp-ctxt)))
+            (comp-apply-profile)
+            (let ((funcs (comp-ctxt-funcs-h comp-ctxt)))
+              (should (= (comp-func-speed (gethash "comp-tests-leaf" funcs)) 3))
+              (should (= (comp-func-speed (gethash "comp-tests-caller" funcs)) 2))
+              (should-not (comp-func-cold (gethash "comp-tests-caller" funcs)))
+              (should (comp-func-cold (gethash "comp-tests-unseen" funcs))))))
+      (delete-file file))))
+
+;;; Asynchronous compilation.
+
+(ert-deftest comp-tests-async-order ()
+  "Check that files are compiled after the files they require."
+  (let* ((dir (make-temp-file "comp-tests-async-order" t))
+         (a (expand-file-name "comp-tests-a.el" dir))
+         (b (expand-file-name "comp-tests-b.el" dir))
+         (c (expand-file-name "comp-tests-c.el" dir))
+         (comp-file-features-h (make-hash-table :test #'equal))
+         (comp-async-compilations (make-hash-table :test #'equal)))
+    (unwind-protect
+        (progn
+          (with-temp-file a
+            (insert ";; (require 'comp-tests-b)\n"
+                    "(require 'comp-tests-b)\n(provide 'comp-tests-a)\n"))
+          (with-temp-file b
+            (insert "(eval-when-compile (require 'comp-tests-c))\n"
+                    "(defvar comp-tests-b \"(require 'comp-tests-a)\")\n"
+                    "(provide 'comp-tests-b)\n"))
+          (with-temp-file c
+            (insert "(require 'cl-lib)\n(provide 'comp-tests-c)\n"))
+          (should (equal (comp-file-features a)
+                         '((comp-tests-a) . (comp-tests-b))))
+          (should (equal (comp-file-features b)
+                         '((comp-tests-b) . (comp-tests-c))))
+          (let ((comp-files-queue (list (cons a nil) (cons b t) (cons c nil))))
+            (should (equal (comp-async-next-file) (cons c nil)))
+            ;; B waits for C, which is still being compiled.
+            (puthash c t comp-async-compilations)
+            (should-not (comp-async-next-file))
+            (remhash c comp-async-compilations)
+            (should (equal (comp-async-next-file) (cons b t)))
+            (should (equal (comp-async-next-file) (cons a nil)))
+            (should-not comp-files-queue))
+          ;; Dependency cycles do not block the queue.
+          (with-temp-file c
+            (insert "(require 'comp-tests-a)\n(provide 'comp-tests-c)\n"))
+          (clrhash comp-file-features-h)
+          (let ((comp-files-queue (list (cons a nil) (cons b nil) (cons c nil))))
+            (should (equal (comp-async-next-file) (cons a nil)))
+            (should (equal (comp-async-next-file) (cons c nil)))))
+      (delete-directory dir t))))
+
+(ert-deftest comp-tests-async-worker-loop ()
+  "Check that a persistent worker runs jobs until the end of its input."
+  (let ((jobs (list (make-temp-file "comp-tests-job" nil ".el"
+                                    "(message \"job one\")\n")
+                    (make-temp-file "comp-tests-job" nil ".el"
+                                    "(message \"job two\")\n")))
+        (input (make-temp-file "comp-tests-input")))
+    (unwind-protect
+        (with-temp-buffer
+          (with-temp-file input
+            (dolist (job jobs)
+              (insert job "\n")))
+          (should (zerop (call-process
+                          (expand-file-name invocation-name
+                                            invocation-directory)
+                          input t nil "--batch" "-l" "comp"
+                          "-f" "comp-async-worker-loop")))
+          (goto-char (point-min))
+          (dolist (job '("job one" "job two"))
+            (should (re-search-forward
+                     (concat "^" job "\n"
+                             (regexp-quote comp-async-worker-done-marker)
+                             "$")
+                     nil t))))
+      (mapc #'delete-file (cons input jobs)))))
+
 ;;; comp-tests.el ends here
@@ -598,6 +598,65 @@ comparing the subr with a much slower Lisp implementation."
                        (bound-and-true-p data-tests-foo2)
                        (bound-and-true-p data-tests-foo3)))))))
 
+(ert-deftest data-tests-many-local-variables ()
+  ;; Buffers with many local variables look up their bindings in a
+  ;; hash table rather than the alist; exercise the ways it changes.
+  (let ((vars (mapcar (lambda (i) (intern (format "data-tests--local-%d" i)))
+                      (number-sequence 0 199)))
+        (a (generate-new-buffer " *data-tests-a*"))
+        (b (generate-new-buffer " *data-tests-b*")))
+    (unwind-protect
+        (progn
+          (put 'data-tests--local-7 'permanent-local t)
+          (dolist (buf (list a b))
+            (with-current-buffer buf
+              (dolist (var vars)
+                (set (make-local-variable var) (list var buf)))
+              (setq-local indent-tabs-mode (eq buf a))
+              (setq-local tab-width 4)))
+          (dolist (var vars)
+            (should (equal (buffer-local-value var a) (list var a)))
+            (should (equal (buffer-local-value var b) (list var b))))
+          (with-current-buffer a
+            (kill-local-variable 'data-tests--local-42)
+            (should-not (local-variable-p 'data-tests--local-42))
+            (should (local-variable-p 'data-tests--local-42 b))
+            (should-not (boundp 'data-tests--local-42))
+            (set (make-local-variable 'data-tests--local-42) 'again)
+            (should (eq (buffer-local-value 'data-tests--local-42 a) 'again)))
+          ;; Switching buffers loads the values of forwarded variables.
+          (dolist (buf (list a b a b))
+            (with-current-buffer buf
+              (erase-buffer)
+              (indent-to 8)
+              (should (equal (buffer-string) (if (eq buf a) "\t\t" "        ")))))
+          (let ((c (with-current-buffer a (clone-buffer))))
+            (unwind-protect
+                (with-current-buffer c
+                  (should (equal data-tests--local-99 (list 'data-tests--local-99 a)))
+                  (setq data-tests--local-99 'c)
+                  (should (equal (buffer-local-value 'data-tests--local-99 a)
+                                 (list 'data-tests--local-99 a))))
+              (kill-buffer c)))
+          (with-current-buffer b
+            (defvar data-tests--local-5)
+            (let ((data-tests--local-5 'let-bound))
+              (with-current-buffer a
+                (should (equal data-tests--local-5 (list 'data-tests--local-5 a))))
+              (should (eq data-tests--local-5 'let-bound)))
+            (should (equal data-tests--local-5 (list 'data-tests--local-5 b)))
+            (kill-all-local-variables)
+            (should (local-variable-p 'data-tests--local-7))
+            (should-not (local-variable-p 'data-tests--local-8))
+            (should-not (boundp 'data-tests--local-8))
+            (setq-local data-tests--local-8 'new)
+            (should (eq data-tests--local-8 'new)))
+          (should (equal (buffer-local-value 'data-tests--local-8 a)
+                         (list 'data-tests--local-8 a))))
+      (put 'data-tests--local-7 'permanent-local nil)
+      (kill-buffer a)
+      (kill-buffer b))))
+
 (ert-deftest data-tests-bignum ()
   (should (bignump (+ most-positive-fixnum 1)))
   (let ((f0 (+ (float most-positive-fixnum) 1))
@@ -235,4 +235,41 @@ expressions works for identifiers starting with period."
       (should (equal (string-trim (buffer-string))
                      "Error: (error \"Boo\")")))))
 
+;; Functions of every kind, for byte-code to call.
+(defun eval-tests--calls-lexical (a &optional b &rest c)
+  (list a b c))
+(defalias 'eval-tests--calls-alias #'eval-tests--calls-lexical)
+(defun eval-tests--calls-frame (x)
+  (ignore x)
+  (backtrace-frame 0 #'eval-tests--calls-frame))
+
+(defun eval-tests--calls-call (f &rest args)
+  "Call F with ARGS from byte-code, which has one op for each length."
+  (pcase (length args)
+    (0 (funcall f))
+    (1 (funcall f (nth 0 args)))
+    (2 (funcall f (nth 0 args) (nth 1 args)))
+    (_ (funcall f (nth 0 args) (nth 1 args) (nth 2 args)))))
+
+(ert-deftest eval-tests-byte-code-calls ()
+  "Check that byte-code calls each kind of function as `funcall' does."
+  (dolist (f '(eval-tests--calls-lexical eval-tests--calls-frame
+               eval-tests--calls-call))
+    (byte-compile f))
+  (let ((dynamic (let ((lexical-binding nil))
+                   (byte-compile '(lambda (a &optional b) (list a b)))))
+        (interpreted (eval '(lambda (a &optional b) (list a b)) t)))
+    (dolist (f (list (symbol-function 'eval-tests--calls-lexical)
+                     'eval-tests--calls-lexical 'eval-tests--calls-alias
+                     dynamic interpreted #'logand 'max 'no-such-function))
+      (dolist (args '(() (1) (1 2) (1 2 3)))
+        (should (equal (condition-case err
+                           (apply #'eval-tests--calls-call f args)
+                         (error err))
+                       (condition-case err (apply f args)
+                         (error err)))))))
+  ;; The backtrace shows the arguments of a compiled function.
+  (should (equal (eval-tests--calls-call #'eval-tests--calls-frame 7)
+                 '(t eval-tests--calls-frame 7))))
+
 ;;; eval-tests.el ends here
@@ -20,6 +20,7 @@
 ;;; Code:
 
 (require 'ert)
+(require 'cl-lib)
 
 ;; The following three tests assert that Emacs survives operations
 ;; copying a marker whose character position differs from its byte
@@ -57,4 +58,50 @@
     (set-marker marker-2 marker-1)
     (should (goto-char marker-2))))
 
+;; Check the conversions between character and byte positions in
+;; a large multibyte buffer, where they go through the checkpoints
+;; kept in marker.c, as the text changes.
+(ert-deftest marker-charpos-bytepos-index ()
+  (let ((state (cl-make-random-state 7))
+        (chars [?a ?\n ?é ?ß ?中 ?😀 #x3fff80]))
+    (cl-flet* ((random-text (n)
+                 (let (text)
+                   (dotimes (_ n)
+                     (push (aref chars (cl-random (length chars) state)) text))
+                   (apply #'string text)))
+               (check ()
+                 ;; Count the bytes in a string, to avoid the
+                 ;; conversions being tested.
+                 (let ((text (buffer-string)))
+                   (dotimes (_ 20)
+                     (let* ((pos (1+ (cl-random (buffer-size) state)))
+                            (byte (1+ (string-bytes
+                                       (substring text 0 (1- pos))))))
+                       (should (= (position-bytes pos) byte))
+                       (should (= (byte-to-position byte) pos)))))))
+      (with-temp-buffer
+        (insert (random-text 30000))
+        (check)
+        (dotimes (_ 20)
+          (goto-char (1+ (cl-random (buffer-size) state)))
+          (insert (random-text (cl-random 100 state)))
+          (check)
+          (let ((beg (1+ (cl-random (buffer-size) state))))
+            (delete-region beg (min (point-max)
+                                    (+ beg (cl-random 100 state)))))
+          (check)
+          (let* ((a (1+ (cl-random (- (buffer-size) 300) state)))
+                 (b (+ a 100 (cl-random 100 state))))
+            (transpose-regions a (+ a (cl-random 100 state))
+                               b (+ b (cl-random 100 state))))
+          (check))
+        (goto-char (/ (point-max) 2))
+        (insert (random-text 20000))
+        (check)
+        (delete-region 1000 25000)
+        (check)
+        (set-buffer-multibyte nil)
+        (set-buffer-multibyte t)
+        (check)))))
+
 ;;; marker-tests.el ends here
@@ -867,4 +867,80 @@ This evaluates the TESTS test cases from glibc."
     (should (equal (string-match "[[:lower:]]" "ẞ") 0))
     (should (equal (string-match "[[:upper:]]" "ẞ") 0))))
 
+;; The following patterns take exponential time, or too much stack, in
+;; the backtracking matcher, which then gives up and lets the pattern
+;; be matched without backtracking.
+
+(ert-deftest regexp-pathological-backtracking ()
+  (let ((s (make-string 40 ?a)))
+    (should-not (string-match "\\(a\\|aa\\)*c" s))
+    (should (equal (string-match "\\(a\\|aa\\)*c" (concat s "c")) 0))
+    (should (equal (match-data) '(0 41 39 40)))
+    (should-not (string-match "x\\(a\\|aa\\)*c" (concat "x" s "x")))
+    (should (equal (string-match "\\(?:a*\\)*b" (concat s "b")) 0))
+    (should (equal (match-end 0) 41))))
+
+(ert-deftest regexp-pathological-stack ()
+  (let ((s (make-string 200000 ?a)))
+    (should (equal (string-match "\\`\\(?:a\\|b\\)*\\'" s) 0))
+    (should (equal (match-end 0) 200000))
+    (should (equal (string-match "\\(a\\|b\\)*c" (concat s "c")) 0))
+    (should (equal (match-data) '(0 200001 199999 200000)))))
+
+(ert-deftest regexp-pathological-buffer ()
+  (with-temp-buffer
+    (insert (make-string 30 ?a) "xyz" (make-string 30 ?a) "c")
+    ;; Put the gap in the middle of the text to match.
+    (goto-char 20)
+    (insert "b")
+    (delete-char -1)
+    (goto-char (point-min))
+    (should (equal (re-search-forward "\\(a\\|aa\\)*c" nil t) 65))
+    (should (equal (match-beginning 0) 34))
+    (should (equal (match-beginning 1) 63))
+    (goto-char (point-min))
+    (should-not (re-search-forward "\\(a\\|aa\\)*y" 30 t))
+    (goto-char (point-max))
+    (should (equal (re-search-backward "z\\(a\\|aa\\)*c" nil t) 33))
+    (goto-char 10)
+    (should-not (looking-at "\\(a\\|aa\\)*z"))
+    (should (looking-at "\\(a\\|aa\\)*x"))
+    (should (equal (match-end 0) 32))))
+
+;; re_search_2 skips ASCII text that cannot start a match a word at a
+;; time; check that it stops in the right place.
+
+(ert-deftest regexp-search-skip-ascii ()
+  (dotimes (i 20)
+    (let ((s (concat (make-string i ?-) "xYz" (make-string 10 ?-))))
+      (let ((case-fold-search nil))
+        (should (equal (string-match "xY[a-z]" s) i))
+        (should-not (string-match "xy[a-z]" s))
+        (should (equal (string-match "[Yq]z" s) (1+ i)))
+        (should (equal (string-match "x\\|Y\\|z" s) i))
+        (should (equal (string-match "xY[a-z]" (string-to-unibyte s)) i))
+        (should (equal (string-match "xY[a-z]" (concat "é" s)) (1+ i))))
+      (let ((case-fold-search t))
+        (should (equal (string-match "xy[a-z]" s) i))
+        (should (equal (string-match "XY[A-Z]" s) i))
+        (should (equal (string-match "xy[a-z]" (string-to-unibyte s)) i))
+        (should (equal (string-match "[yq]z" (concat "ÿ" s "é")) (+ i 2)))))
+    (let ((s (concat (make-string i ?-) "é" (make-string i ?-) "ü")))
+      (should (equal (string-match "ü" s) (1+ (* 2 i))))
+      (should (equal (string-match "[éü]" s (1+ i)) (1+ (* 2 i))))
+      (should (equal (string-match "\\(?:é\\|ü\\)" s) i))))
+  (with-temp-buffer
+    (insert (make-string 100 ?-) "abc" (make-string 100 ?-) "ABC\n")
+    ;; Put the gap just before the second match.
+    (goto-char 205)
+    (insert "x")
+    (delete-char -1)
+    (goto-char (point-min))
+    (let ((case-fold-search nil))
+      (should (equal (re-search-forward "A[B-C]+" nil t) 207)))
+    (goto-char (point-min))
+    (let ((case-fold-search t))
+      (should (equal (re-search-forward "a[b-c]+" nil t) 104))
+      (should (equal (re-search-forward "a[b-c]+" nil t) 207)))))
+
 ;;; regex-emacs-tests.el ends here
@@ -20,6 +20,7 @@
 ;;; Code:
 
 (require 'ert)
+(require 'cl-lib)
 
 (ert-deftest test-replace-match-modification-hooks ()
   (let ((ov-set nil))
@@ -39,4 +40,176 @@
 	  (replace-match "bcd"))
       (should (= (point) 10)))))
 
+;; Return the counts of events in `regexp-cache-statistics'.
+(defun search-tests--cache-counts ()
+  (let ((stats (regexp-cache-statistics)))
+    (list (alist-get 'hits stats) (alist-get 'misses stats)
+          (alist-get 'evictions stats))))
+
+(ert-deftest regexp-cache-statistics ()
+  (let* ((regexp (format "cache-test-%d" (random 1000000000)))
+         (before (search-tests--cache-counts)))
+    (should (string-match regexp regexp))
+    (pcase-let ((`(,hits ,misses ,_) (search-tests--cache-counts)))
+      (should (= misses (1+ (nth 1 before))))
+      (should (string-match regexp regexp))
+      (should (equal (search-tests--cache-counts)
+                     (list (1+ hits) misses (nth 2 before))))))
+  (regexp-cache-statistics t)
+  (should (equal (search-tests--cache-counts) '(0 0 0))))
+
+(ert-deftest regexp-cache-size ()
+  (let ((regexp-cache-size 4))
+    (regexp-cache-statistics t)
+    (dotimes (i 10)
+      (should (= (string-match (format "a\\(b\\)%d" i)
+                               (format "xab%d" i))
+                 1))
+      (should (equal (match-string 1 (format "xab%d" i)) "b")))
+    (let ((stats (regexp-cache-statistics)))
+      (should (= (alist-get 'size stats) 4))
+      (should (<= (alist-get 'entries stats) 4))
+      (should (= (alist-get 'misses stats) 10))
+      (should (>= (alist-get 'evictions stats) 6)))
+    ;; A cache of one regexp is enough for alternating searches.
+    (let ((regexp-cache-size 1)
+          (count 0))
+      (with-temp-buffer
+        (insert "foo bar foo")
+        (goto-char (point-min))
+        (while (re-search-forward "foo" nil t)
+          (save-match-data
+            (when (string-match "o+" (match-string 0))
+              (setq count (1+ count))))))
+      (should (= count 2)))))
+
+;;; re-search-forward-multi
+
+(ert-deftest re-search-forward-multi ()
+  (with-temp-buffer
+    (insert "foo bar\nbaz Foo quux\n")
+    (setq case-fold-search nil)
+    (goto-char (point-min))
+    ;; The leftmost match wins, whichever regexp it is for.
+    (should (= (re-search-forward-multi '("ba\\(r\\)" "o+") nil t) 1))
+    (should (= (point) 4))
+    (should (equal (match-data t) (list 2 4 (current-buffer))))
+    (should (= (re-search-forward-multi ["ba\\(r\\)" "o+"]) 0))
+    (should (= (point) 8))
+    (should (equal (match-data t) (list 5 8 7 8 (current-buffer))))
+    ;; At the same place, the regexp that comes first wins.
+    (should (= (re-search-forward-multi '("z+" "ba\\(.\\)" "baz")) 1))
+    (should (equal (match-string 1) "z"))
+    ;; Anchored regexps only match where they can.
+    (goto-char (point-min))
+    (should (= (re-search-forward-multi '("^ba" "\\`f") nil t) 1))
+    (should (= (re-search-forward-multi '("^ba" "\\`f") nil t) 0))
+    (should (= (point) 11))
+    (should-not (re-search-forward-multi '("^ba" "\\`f") nil t))
+    ;; Bounds, errors and case folding.
+    (goto-char (point-min))
+    (should-not (re-search-forward-multi '("quux" "Foo") 12 t))
+    (should (= (point) 1))
+    (should-not (re-search-forward-multi '("quux" "Foo") 12 'move))
+    (should (= (point) 12))
+    (should-error (re-search-forward-multi '("nope")) :type 'search-failed)
+    (should-not (re-search-forward-multi '() nil t))
+    (goto-char (point-min))
+    (let ((case-fold-search t))
+      (should (= (re-search-forward-multi '("QUUX" "BAZ")) 1))
+      (should (= (re-search-forward-multi '("QUUX" "FOO")) 1))
+      (should (equal (match-string 0) "Foo")))
+    (should (= (re-search-forward-multi '("QUUX" "foo" "q")) 2))))
+
+;; Large buffers keep an index of newline positions; check that it
+;; stays in sync with the text as the buffer is modified.
+(ert-deftest search-tests--line-index ()
+  (with-temp-buffer
+    (let ((state (cl-make-random-state 42)))
+      (dotimes (i 20000)
+        (insert (make-string (% i 17) ?a) "\n"))
+      (dotimes (_ 200)
+        (let ((pos (1+ (cl-random (buffer-size) state))))
+          (pcase (cl-random 4 state)
+            (0 (goto-char pos) (insert "b\nc\n\n"))
+            (1 (delete-region pos (min (point-max) (+ pos (cl-random 300 state)))))
+            (2 (subst-char-in-region pos (min (point-max) (+ pos 50)) ?a ?\n))
+            (3 (subst-char-in-region pos (min (point-max) (+ pos 50)) ?\n ?a))))
+        (let ((pos (1+ (cl-random (buffer-size) state))))
+          (should (= (line-number-at-pos pos)
+                     (1+ (cl-count ?\n (buffer-substring-no-properties
+                                        (point-min) pos)))))))
+      (dolist (n '(5000 -5000 100000 -100000))
+        (let ((pos (1+ (cl-random (buffer-size) state)))
+              expected-point expected-left)
+          (goto-char pos)
+          (setq expected-left
+                (let ((left (abs n)) (step (if (< n 0) -1 1)))
+                  (while (and (> left 0) (= (forward-line step) 0))
+                    (setq left (1- left)))
+                  (if (< n 0) (- left) left)))
+          (setq expected-point (point))
+          (goto-char pos)
+          (should (= (forward-line n) expected-left))
+          (should (= (point) expected-point)))))))
+
+;; Case-folded searches look up ASCII and Latin-1 characters in a copy
+;; of the standard canonicalize table; check that it follows
+;; `set-standard-case-table'.
+(ert-deftest search-tests--standard-case-table ()
+  (let ((old (standard-case-table))
+        (case-fold-search t))
+    (with-temp-buffer
+      (insert "Ça VA tRÈs Bien, À ÿ")
+      (dolist (search '(search-forward re-search-forward))
+        (dolist (string '("ça va très" "bien" "ÇA" "à" "Ÿ"))
+          (goto-char (point-min))
+          (should (funcall search string nil t))))
+      (goto-char (point-min))
+      (should (re-search-forward "très\\s-+\\(bien\\)" nil t))
+      (should (equal (match-string 1) "Bien"))
+      (goto-char (point-min))
+      (should-not (search-forward "æ" nil t)))
+    (unwind-protect
+        (let ((table (copy-case-table old)))
+          (set-case-syntax-pair ?À ?æ table)
+          (set-standard-case-table table)
+          (with-temp-buffer
+            (insert "Ça va, À")
+            (dolist (search '(search-forward re-search-forward))
+              (goto-char (point-min))
+              (should (funcall search "æ" nil t))
+              (should (= (point) (point-max)))
+              (goto-char (point-min))
+              (should (funcall search "ç" nil t)))))
+      (set-standard-case-table old))
+    (with-temp-buffer
+      (insert "À")
+      (goto-char (point-min))
+      (should-not (search-forward "æ" nil t)))))
+
+(ert-deftest search-tests--count-regexp-matches ()
+  (with-temp-buffer
+    (insert "foo bar\nbaz foo\n\nfoofoo\nqux")
+    (goto-char 5)
+    (set-match-data '(1 2))
+    (should (= (count-regexp-matches "foo" (point-min)) 4))
+    (should (= (count-regexp-matches "foo") 3))
+    (should (= (count-regexp-matches "fo+\\|ba" 1 11) 3))
+    (should (= (count-regexp-matches "^" 1 (point-max)) 5))
+    (should (= (count-regexp-matches "^$" 1) 1))
+    (should (= (count-regexp-matches "o*" 1 4) 2))
+    (should (= (count-regexp-matches "^f" 2) 1))
+    (should (= (count-regexp-matches "" 3 8) 5))
+    (should (= (count-regexp-matches "x" 1 (+ 10 (point-max))) 1))
+    (let ((case-fold-search t))
+      (should (= (count-regexp-matches "FOO" 1) 4))
+      (should (= (count-regexp-matches "^F" 1) 2)))
+    (let ((case-fold-search nil))
+      (should (= (count-regexp-matches "FOO" 1) 0)))
+    (narrow-to-region 9 21)
+    (should (= (count-regexp-matches "foo" 1) 2))
+    (should (= (point) 9))
+    (should (equal (match-data) '(1 2)))))
+
 ;;; search-tests.el ends here
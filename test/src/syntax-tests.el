@@ -506,4 +506,195 @@ the `parse-partial-sexp's are expected to stop.  See
     (should (parse-partial-sexp 1 1))
     (should-error (parse-partial-sexp 2 1))))
 
+(defun syntax-tests--ppss-equal (pos)
+  "Check `internal--syntax-ppss' at POS against `parse-partial-sexp'."
+  (let ((ppss (internal--syntax-ppss pos))
+        (pps (parse-partial-sexp (point-min) pos)))
+    ;; Elements 2 and 6 depend on where the parse started.
+    (dolist (i '(2 6))
+      (setf (nth i ppss) nil (nth i pps) nil))
+    (should (equal ppss pps))
+    (should (= (point) pos))))
+
+(ert-deftest syntax-ppss-checkpoints ()
+  (with-temp-buffer
+    (emacs-lisp-mode)
+    (let ((state (cl-make-random-state 42))
+          (text "(defun f (x) \"str (\\\" ing\" ; comment (\n  ?\\( #| b |# [x])\n"))
+      (dotimes (_ 500)
+        (insert text))
+      (dotimes (_ 300)
+        (let ((pos (1+ (cl-random (buffer-size) state))))
+          (pcase (cl-random 4 state)
+            (0 (goto-char pos)
+               (insert (substring text 0 (cl-random (length text) state))))
+            (1 (delete-region pos (min (point-max) (+ pos 3))))
+            (_ (syntax-tests--ppss-equal pos)))))
+      (dotimes (_ 20)
+        (syntax-tests--ppss-equal (1+ (cl-random (buffer-size) state))))
+      ;; Changes to text properties also discard the states after them.
+      (syntax-tests--ppss-equal (point-max))
+      (put-text-property 2 3 'syntax-table (string-to-syntax "\""))
+      (let ((parse-sexp-lookup-properties t))
+        (syntax-tests--ppss-equal (point-max)))
+      ;; Parsing a narrowed buffer starts at its beginning.
+      (narrow-to-region 50 (point-max))
+      (syntax-tests--ppss-equal (point-max)))))
+
+;; Sets of characters for `skip-chars-forward', with predicates for
+;; the characters in them.
+(defconst syntax-tests--skip-chars-sets
+  `(("^\n" . ,(lambda (c) (/= c ?\n)))
+    ("^a" . ,(lambda (c) (/= c ?a)))
+    ("^ \t\n" . ,(lambda (c) (not (memq c '(?\s ?\t ?\n)))))
+    (" \t" . ,(lambda (c) (memq c '(?\s ?\t))))
+    ("a-z" . ,(lambda (c) (<= ?a c ?z)))
+    ("^a-z" . ,(lambda (c) (not (<= ?a c ?z))))
+    ("[:alnum:]-" . ,(lambda (c) (or (= c ?-) (string-match-p
+                                                "[[:alnum:]]"
+                                                (string c)))))
+    ("^[:digit:]" . ,(lambda (c) (not (<= ?0 c ?9))))
+    ("^é\n" . ,(lambda (c) (not (memq c '(?é ?\n)))))
+    ("a-zé-ü" . ,(lambda (c) (or (<= ?a c ?z) (<= ?é c ?ü))))
+    ("^\\^x-" . ,(lambda (c) (not (memq c '(?^ ?x ?-)))))))
+
+(defun syntax-tests--skip-chars-expected (pred from to)
+  "Return where `skip-chars-forward' should stop from FROM.
+PRED tells the characters to skip, and TO is the limit."
+  (let ((step (if (< from to) 1 -1)))
+    (while (and (/= from to)
+                (funcall pred (char-after (if (< step 0) (1- from) from))))
+      (setq from (+ from step)))
+    from))
+
+(ert-deftest syntax-tests--skip-chars ()
+  "Test `skip-chars-forward' and `skip-chars-backward' on many sets."
+  (with-temp-buffer
+    (dotimes (i 40)
+      (insert (make-string i ?x) " \t" (make-string (% i 7) ?é)
+              "-abc123^ü\n"))
+    (dolist (multibyte '(t nil))
+      (set-buffer-multibyte multibyte)
+      ;; Put the gap in the middle, so that scans cross it.
+      (goto-char (/ (point-max) 2))
+      (insert "z")
+      (delete-char -1)
+      (dolist (set syntax-tests--skip-chars-sets)
+        (let ((pred (cdr set)))
+          (unless multibyte
+            ;; Unibyte buffers hold bytes, not characters, but ISO
+            ;; classes look at the bytes as if they were characters.
+            (unless (string-search "[:" (car set))
+              (setq pred (lambda (c)
+                           (funcall (cdr set)
+                                    (if (< c #x80) c
+                                      (unibyte-char-to-multibyte c)))))))
+          (dolist (from (number-sequence (point-min) (point-max) 7))
+            ;; Skip each set twice, to use the cached compiled set.
+            (dotimes (_ 2)
+              (dolist (to (list (point-min) (point-max) (+ from 20)
+                                (- from 20)))
+                (setq to (max (point-min) (min to (point-max))))
+                (goto-char from)
+                (if (< from to)
+                    (skip-chars-forward (car set) to)
+                  (skip-chars-backward (car set) to))
+                (should (equal (list (car set) multibyte from to (point))
+                               (list (car set) multibyte from to
+                                     (syntax-tests--skip-chars-expected
+                                      pred from to))))))))))))
+
+(ert-deftest syntax-tests--skip-chars-changed-string ()
+  "Test that `skip-chars-forward' uses the current contents of its string."
+  (with-temp-buffer
+    (insert "aaaabbbbccccdddd")
+    (let ((set (copy-sequence "ab")))
+      (goto-char (point-min))
+      (should (= (skip-chars-forward set) 8))
+      (aset set 1 ?c)
+      (goto-char (point-min))
+      (should (= (skip-chars-forward set) 4))
+      (aset set 0 ?^)
+      (goto-char (point-min))
+      (should (= (skip-chars-forward set) 8)))
+    ;; [:space:] depends on the syntax table.
+    (erase-buffer)
+    (insert "  x  y")
+    (goto-char (point-min))
+    (should (= (skip-chars-forward "[:space:]") 2))
+    (with-syntax-table (make-syntax-table)
+      (modify-syntax-entry ?x " ")
+      (goto-char (point-min))
+      (should (= (skip-chars-forward "[:space:]") 5)))))
+
+(ert-deftest syntax-tests--skip-syntax ()
+  "Test `skip-syntax-forward' and `skip-syntax-backward'."
+  (with-temp-buffer
+    (insert "foo_bar  \t baz-é∀ quux")
+    (goto-char (point-min))
+    (should (= (skip-syntax-forward "w_") 7))
+    (should (= (skip-syntax-forward " ") 4))
+    (should (= (skip-syntax-forward "^ ") 6))
+    (should (= (skip-syntax-backward "^ ") -6))
+    (should (= (skip-syntax-backward " ") -4))
+    (let ((table (make-syntax-table)))
+      (modify-syntax-entry ?a "." table)
+      (with-syntax-table table
+        (goto-char (point-min))
+        (should (= (skip-syntax-forward "w_") 5))))
+    ;; A `syntax-table' property overrides the syntax table.
+    (let ((parse-sexp-lookup-properties t))
+      (put-text-property 3 4 'syntax-table (string-to-syntax " "))
+      (goto-char (point-min))
+      (should (= (skip-syntax-forward "w_") 2))
+      (goto-char 8)
+      (should (= (skip-syntax-backward "w_") -4)))))
+
+(defun syntax-tests--scan (pos count depth sexpflag)
+  "Return what `scan-lists' or `scan-sexps' gives from POS, or the error."
+  (condition-case err
+      (if sexpflag
+          (scan-sexps pos count)
+        (scan-lists pos count depth))
+    (scan-error (cddr err))))
+
+(defun syntax-tests--bracket-index-equal (pos)
+  "Check that the bracket index does not change scans from POS."
+  (dolist (args '((1 0 nil) (-1 0 nil) (1 1 nil) (-1 1 nil) (1 0 t) (-1 0 t)))
+    (should (equal (cons pos (let ((parse-sexp-bracket-index t))
+                               (apply #'syntax-tests--scan pos args)))
+                   (cons pos (let ((parse-sexp-bracket-index nil))
+                               (apply #'syntax-tests--scan pos args)))))))
+
+(ert-deftest syntax-tests--bracket-index ()
+  (dolist (multibyte-as-symbol '(nil t))
+    (with-temp-buffer
+      (emacs-lisp-mode)
+      ;; The index only tells about ASCII text when multibyte
+      ;; characters are symbols for `scan-sexps'.
+      (setq-local multibyte-syntax-as-symbol multibyte-as-symbol)
+      (let ((state (cl-make-random-state 42))
+            (text "(defun f (x) \"str (\\\" ing\" ; comment (\n  ?\\( «[é]» #| b |# [x])\n"))
+        ;; Enough text for the index to be parsed in several pieces.
+        (insert "(\n")
+        (dotimes (_ 1000)
+          (insert text))
+        (insert ")\n")
+        (dotimes (_ 200)
+          (let ((pos (1+ (cl-random (buffer-size) state))))
+            (pcase (cl-random 4 state)
+              (0 (goto-char pos)
+                 (insert (substring text 0 (cl-random (length text) state))))
+              (1 (delete-region pos (min (point-max) (+ pos 3))))
+              (_ (syntax-tests--bracket-index-equal pos)))))
+        (syntax-tests--bracket-index-equal (point-min))
+        (syntax-tests--bracket-index-equal (point-max))
+        ;; The index follows changes to the syntax table.
+        (let ((table (copy-syntax-table)))
+          (set-syntax-table table)
+          (syntax-tests--bracket-index-equal (point-min))
+          (modify-syntax-entry ?\; "." table)
+          (syntax-tests--bracket-index-equal (point-min))
+          (syntax-tests--bracket-index-equal (point-max)))))))
+
 ;;; syntax-tests.el ends here